@@ -27,6 +27,19 @@
 .equ LPT_STATUS_nACK,  0x10
 .equ IO_EXTERNAL_MUTE, 0x80
 
+/* LPT control lines, on digital input 1. nAUTOFEED (HostBusy in nibble mode) is inverted on the PCB and wired to the test input. */
+.equ IO_DIGITAL_IN_1,       (IO_BASE+0x11)
+.equ LPT_CONTROL_nSTROBE,   0
+.equ LPT_CONTROL_HOSTBUSY,  1
+
+/* Replies for framed transfers, sent in nibble mode */
+.equ REPLY_ACK, 0x06
+.equ REPLY_NAK, 0x15
+
+/* Largest block accepted by the framed upload, and the size of the RAM we can upload to */
+.equ BLOCK_MAX_SIZE,  0x100
+.equ UPLOAD_RAM_SIZE, 0x8000
+
 /* Generic watchdog clear macro */
 .macro WATCHDOG_CLEAR
   tst.w IO_WATCHDOG
@@ -49,6 +62,51 @@
   jmp (%A7)
 .endm
 
+/* Updates the running CRC32 in %D3 with the byte in %D0, using the table in %A2. Modifies %D4. */
+.macro CRC32_UPDATE
+  eor.b   %D0, %D3
+  moveq   #0, %D4
+  move.b  %D3, %D4
+  add.w   %D4, %D4
+  add.w   %D4, %D4
+  lsr.l   #8, %D3
+  move.l  (%A2,%D4.w), %D4
+  eor.l   %D4, %D3
+.endm
+
+/*
+   Sends the low nibble of %D2 in nibble mode. Modifies %D1 and %D2.
+   Nibble bits 0..3 map to digital output bits 0..3 once the host has swizzled the status lines.
+*/
+.macro SEND_NIBBLE
+  andi.b  #0xf, %D2
+  ori.b   #0x90, %D2 /* Keep the external mute and PtrClk (nACK) high */
+
+  /* Wait for the host to assert HostBusy (nAUTOFEED) */
+_send_nibble_wait_hostbusy_low\@:
+  WATCHDOG_CLEAR
+  btst.b  #LPT_CONTROL_HOSTBUSY, IO_DIGITAL_IN_1
+  bne     _send_nibble_wait_hostbusy_low\@
+
+  /* Put the nibble on the status lines and give them some time to settle, ~50 microseconds */
+  move.b  %D2, IO_DIGITAL_OUT
+  move.w  #50, %D1
+_send_nibble_settle\@:
+  dbra    %D1, _send_nibble_settle\@
+
+  /* Pull PtrClk (nACK) low; the host will now read the nibble */
+  bclr    #4, %D2
+  move.b  %D2, IO_DIGITAL_OUT
+
+  /* Wait for the host to release HostBusy again, then release PtrClk */
+_send_nibble_wait_hostbusy_high\@:
+  WATCHDOG_CLEAR
+  btst.b  #LPT_CONTROL_HOSTBUSY, IO_DIGITAL_IN_1
+  beq     _send_nibble_wait_hostbusy_high\@
+  bset    #4, %D2
+  move.b  %D2, IO_DIGITAL_OUT
+.endm
+
 /*
    Entry point.
 */
@@ -191,6 +249,8 @@ _msg_end:
 
 /*
    Main command loop.
+   Commands don't wait before they return here: _readchar pulling BUSY low tells the host that the
+   previous command is done, so it can go on right away.
 */
 _mainloop:
 
@@ -199,6 +259,7 @@ _mainloop:
   move.w #0x400, %D0 /* Yellow */
   CALL _print_status
 
+_mainloop_nextcommand: /* Keeps the status of the previous command on screen */
   WATCHDOG_CLEAR
 
   /* Read a single command byte into %D0 */
@@ -224,12 +285,38 @@ _mainloop:
   cmp.b #0x4, %D0
   beq _uploadsubram
 
-  /* Invalid command */
+  /* Framed block upload to main or sub RAM */
+  cmp.b #0x5, %D0
+  beq _uploadblock
+
+  /* Compressed upload to main or sub RAM */
+  cmp.b #0x6, %D0
+  beq _uploadcompressed
+
+  /* CRC of a range of main or sub RAM */
+  cmp.b #0x7, %D0
+  beq _checkrange
+
+  /* Framed upload to any writable address */
+  cmp.b #0x8, %D0
+  beq _uploadaddress
+
+  /* Send a range of memory */
+  cmp.b #0x9, %D0
+  beq _readrange
+
+  /* CRC of a range of memory */
+  cmp.b #0xa, %D0
+  beq _checkaddress
+
+  /* Fill a range of memory with a byte */
+  cmp.b #0xb, %D0
+  beq _fillregion
+
+  /* Invalid command. The message stays up until the next command. */
   movea.l #_status_invalid, %A0
   move.w #0x200, %D0 /* Red */
-  CALL _print_status
-  move.l #500, %D0
-  CALL_RETURN _sleep, _mainloop
+  CALL_RETURN _print_status, _mainloop_nextcommand
 
 
 /* 
@@ -272,6 +359,21 @@ _readchar_wait_strobe_high_end:
   RETURN
 
 
+/*
+   Sends a single byte in nibble mode, low nibble first. Byte in the low byte of %D0.
+   Leaves BUSY and nACK high afterwards, like _readchar.
+   Return address in %A7. Modifies %D1 and %D2.
+*/
+_sendchar:
+  move.b %D0, %D2
+  SEND_NIBBLE
+  move.b %D0, %D2
+  lsr.b  #4, %D2
+  SEND_NIBBLE
+  move.b #0x98, IO_DIGITAL_OUT
+  RETURN
+
+
 /*
    Reads a single word, high byte first. Result in %D0
    Modifies %A6.
@@ -286,28 +388,14 @@ _readword:
   RETURN
 
 
-/* 
-   Sleep function; D0 = amount of milliseconds (approximately); A7 = return address.
-   Modifies D0 and D1
-*/
-_sleep:
-  move.w #833, %D1 /* dbra is ~12 cycles, so this should be one millisecond */
-_sleep_one_ms:
-  dbra %D1, _sleep_one_ms
-  WATCHDOG_CLEAR
-  dbra %D0, _sleep
-  RETURN
-
-
 /*
-   Reboots to the image in RAM.
+   Reboots to the image in RAM. The host is done with the command byte once _readchar has seen STROBE
+   go high again, so there's nothing to wait for.
 */
 _rebootram:
   movea.l #_status_rebootram, %A0
   move.w #0x400, %D0 /* Yellow */
   CALL _print_status
-  move.l #500, %D0 /* 500ms */
-  CALL _sleep
 
   bclr #5, IO_PPI_PORT_C /* Blank screen */
   reset
@@ -323,8 +411,6 @@ _rebootrom:
   movea.l #_status_rebootrom, %A0
   move.w  #0x400, %D0 /* Yellow */
   CALL    _print_status
-  move.l  #500, %D0 /* 500ms */
-  CALL    _sleep
 
   bclr    #5, IO_PPI_PORT_C /* Blank screen */
 
@@ -379,8 +465,618 @@ _upload_loop:
   dbra    %D1, _upload_loop  
 
 _upload_done:
-  move.l  #500, %D0
-  CALL_RETURN _sleep, _mainloop
+  bra     _mainloop
+
+/*
+   Framed upload of a single block to main or sub RAM. The block starts with a 6 byte header:
+     target (0 = main RAM, 1 = sub RAM), offset (word), length (word), xor of the previous 5 bytes.
+   The header is answered with ACK or NAK in nibble mode, since a damaged offset or length would
+   make us write to the wrong place or lose track of the data. After a NAK nothing else follows.
+   After an ACK we receive the block data, followed by the CRC32 of header and data in high-low order.
+   The block is then answered with ACK or NAK, and the host resends the whole command on a NAK.
+   Registers: A0 = destination, A2 = CRC table, D3 = CRC, D5 = header check, D6 = target, D7 = offset/length.
+*/
+_uploadblock:
+  movea.l #_status_uploadblock, %A0
+  move.w  #0x400, %D0 /* Yellow */
+  CALL    _print_status
+
+  movea.l #_crc32_table, %A2
+  move.l  #0xffffffff, %D3
+
+  /* Target byte */
+  CALL    _readchar
+  move.b  %D0, %D6
+  move.b  %D0, %D5
+  CRC32_UPDATE
+
+  /* Offset and length, into the high and low word of D7 */
+  moveq   #3, %D1
+_uploadblock_header_loop:
+  CALL    _readchar
+  lsl.l   #8, %D7
+  move.b  %D0, %D7
+  eor.b   %D0, %D5
+  CRC32_UPDATE
+  dbra    %D1, _uploadblock_header_loop
+
+  /* Header check byte */
+  CALL    _readchar
+  cmp.b   %D0, %D5
+  bne     _reply_nak
+
+  /* Validate the target */
+  movea.l #0x60000, %A0
+  tst.b   %D6
+  beq     _uploadblock_target_ok
+  movea.l #SUBRAM_BASE, %A0
+  cmp.b   #1, %D6
+  bne     _reply_nak
+_uploadblock_target_ok:
+
+  /* Validate the length (1..BLOCK_MAX_SIZE) and make sure the block fits */
+  clr.l   %D2
+  move.w  %D7, %D2
+  beq     _reply_nak
+  cmp.w   #BLOCK_MAX_SIZE, %D2
+  bhi     _reply_nak
+  move.l  %D7, %D1
+  clr.w   %D1
+  swap    %D1
+  adda.l  %D1, %A0
+  add.l   %D2, %D1
+  cmp.l   #UPLOAD_RAM_SIZE, %D1
+  bhi     _reply_nak
+
+  /* Header is fine, tell the host to continue with the data */
+  move.b  #REPLY_ACK, %D0
+  CALL    _sendchar
+
+  /* Receive the data. _sendchar trashed D2, so reload the length */
+  move.w  %D7, %D2
+  subq.w  #1, %D2
+_uploadblock_data_loop:
+  CALL    _readchar
+  move.b  %D0, (%A0)+
+  CRC32_UPDATE
+  dbra    %D2, _uploadblock_data_loop
+  not.l   %D3
+
+  /* Receive the CRC, high byte first */
+  moveq   #3, %D2
+_uploadblock_crc_loop:
+  CALL    _readchar
+  lsl.l   #8, %D7
+  move.b  %D0, %D7
+  dbra    %D2, _uploadblock_crc_loop
+
+  cmp.l   %D3, %D7
+  bne     _reply_nak
+
+  /* Fall through */
+
+/*
+   Replies to a framed transfer with ACK or NAK, and goes back to the main loop.
+*/
+_reply_ack:
+  move.b  #REPLY_ACK, %D0
+  CALL_RETURN _sendchar, _mainloop
+
+_reply_nak:
+  move.b  #REPLY_NAK, %D0
+  CALL_RETURN _sendchar, _mainloop
+
+/*
+   Compressed upload to main or sub RAM, decompressed while it is received.
+   Starts with a 6 byte header like _uploadblock, answered with ACK or NAK:
+     target (0 = main RAM, 1 = sub RAM), compressed length (word), decompressed length (word), xor of the previous 5 bytes.
+   Then follow the compressed bytes, and the CRC32 of the decompressed data in high-low order.
+   The stream is a sequence of tokens:
+     0x00..0x7f: literal run, (token+1) bytes follow.
+     0x80..0xff: match, followed by a back reference offset (word). Copies (token&0x7f)+3 bytes from output-offset.
+   A damaged stream is still consumed up to the compressed length, so we stay in sync with the host.
+   The result is answered with ACK or NAK.
+   Registers: A0 = destination, A1 = start of the destination, A3 = end of the destination, A4 = match source,
+              A2 = CRC table, D3 = CRC, D1 = run length, D2 = match offset, D5 = header check / error flag,
+              D6 = target, D7 = lengths, then the compressed bytes left.
+*/
+_uploadcompressed:
+  movea.l #_status_uploadcompressed, %A0
+  move.w  #0x400, %D0 /* Yellow */
+  CALL    _print_status
+
+  movea.l #_crc32_table, %A2
+
+  /* Target byte */
+  CALL    _readchar
+  move.b  %D0, %D6
+  move.b  %D0, %D5
+
+  /* Compressed and decompressed length, into the high and low word of D7 */
+  moveq   #3, %D1
+_uploadcompressed_header_loop:
+  CALL    _readchar
+  lsl.l   #8, %D7
+  move.b  %D0, %D7
+  eor.b   %D0, %D5
+  dbra    %D1, _uploadcompressed_header_loop
+
+  /* Header check byte */
+  CALL    _readchar
+  cmp.b   %D0, %D5
+  bne     _reply_nak
+
+  /* Validate the target */
+  movea.l #0x60000, %A0
+  tst.b   %D6
+  beq     _uploadcompressed_target_ok
+  movea.l #SUBRAM_BASE, %A0
+  cmp.b   #1, %D6
+  bne     _reply_nak
+_uploadcompressed_target_ok:
+  movea.l %A0, %A1
+
+  /* Validate the decompressed length (1..UPLOAD_RAM_SIZE) */
+  clr.l   %D1
+  move.w  %D7, %D1
+  beq     _reply_nak
+  cmp.l   #UPLOAD_RAM_SIZE, %D1
+  bhi     _reply_nak
+  lea     (%A0,%D1.l), %A3
+
+  /* The compressed length can't be zero either */
+  clr.w   %D7
+  swap    %D7
+  beq     _reply_nak
+
+  /* Header is fine, tell the host to continue with the data */
+  move.b  #REPLY_ACK, %D0
+  CALL    _sendchar
+
+  move.l  #0xffffffff, %D3
+  clr.b   %D5
+
+_uploadcompressed_token:
+  tst.l   %D7
+  beq     _uploadcompressed_end
+  CALL    _readchar
+  subq.l  #1, %D7
+  moveq   #0, %D1
+  move.b  %D0, %D1
+  bmi     _uploadcompressed_match
+
+  /* Literal run */
+_uploadcompressed_literal_loop:
+  tst.l   %D7
+  beq     _uploadcompressed_error
+  CALL    _readchar
+  subq.l  #1, %D7
+  cmpa.l  %A3, %A0
+  bcc     _uploadcompressed_error
+  move.b  %D0, (%A0)+
+  CRC32_UPDATE
+  dbra    %D1, _uploadcompressed_literal_loop
+  bra     _uploadcompressed_token
+
+  /* Match; read the offset and make sure it points into what we wrote so far */
+_uploadcompressed_match:
+  andi.w  #0x7f, %D1
+  addq.w  #2, %D1 /* Length-1 for dbra */
+  cmp.l   #2, %D7
+  bcs     _uploadcompressed_error
+  moveq   #0, %D2
+  CALL    _readchar
+  move.b  %D0, %D2
+  lsl.w   #8, %D2
+  CALL    _readchar
+  move.b  %D0, %D2
+  subq.l  #2, %D7
+  tst.w   %D2
+  beq     _uploadcompressed_error
+  movea.l %A0, %A4
+  suba.l  %D2, %A4
+  cmpa.l  %A1, %A4
+  bcs     _uploadcompressed_error
+
+  /* Byte by byte, since the match may overlap the output */
+_uploadcompressed_match_loop:
+  cmpa.l  %A3, %A0
+  bcc     _uploadcompressed_error
+  move.b  (%A4)+, %D0
+  move.b  %D0, (%A0)+
+  CRC32_UPDATE
+  dbra    %D1, _uploadcompressed_match_loop
+  bra     _uploadcompressed_token
+
+  /* Damaged stream; read whatever is left of it and fail */
+_uploadcompressed_error:
+  st      %D5
+_uploadcompressed_drain:
+  tst.l   %D7
+  beq     _uploadcompressed_end
+  CALL    _readchar
+  subq.l  #1, %D7
+  bra     _uploadcompressed_drain
+
+_uploadcompressed_end:
+  cmpa.l  %A3, %A0
+  beq     _uploadcompressed_size_ok
+  st      %D5
+_uploadcompressed_size_ok:
+  not.l   %D3
+
+  /* Receive the CRC, high byte first */
+  moveq   #3, %D2
+_uploadcompressed_crc_loop:
+  CALL    _readchar
+  lsl.l   #8, %D7
+  move.b  %D0, %D7
+  dbra    %D2, _uploadcompressed_crc_loop
+
+  tst.b   %D5
+  bne     _reply_nak
+  cmp.l   %D3, %D7
+  bne     _reply_nak
+  bra     _reply_ack
+
+/*
+   Sends the CRC32 of a range of main or sub RAM, so the host can check what is in there.
+   Starts with a 6 byte header like _uploadblock, answered with ACK or NAK:
+     target (0 = main RAM, 1 = sub RAM), offset (word), length (word), xor of the previous 5 bytes.
+   After an ACK the CRC follows in nibble mode, high byte first.
+   Registers: A0 = source, A2 = CRC table, D3 = CRC, D5 = header check / counter, D6 = target, D7 = offset/length.
+*/
+_checkrange:
+  movea.l #_status_checkrange, %A0
+  move.w  #0x400, %D0 /* Yellow */
+  CALL    _print_status
+
+  /* Target byte */
+  CALL    _readchar
+  move.b  %D0, %D6
+  move.b  %D0, %D5
+
+  /* Offset and length, into the high and low word of D7 */
+  moveq   #3, %D1
+_checkrange_header_loop:
+  CALL    _readchar
+  lsl.l   #8, %D7
+  move.b  %D0, %D7
+  eor.b   %D0, %D5
+  dbra    %D1, _checkrange_header_loop
+
+  /* Header check byte */
+  CALL    _readchar
+  cmp.b   %D0, %D5
+  bne     _reply_nak
+
+  /* Validate the target */
+  movea.l #0x60000, %A0
+  tst.b   %D6
+  beq     _checkrange_target_ok
+  movea.l #SUBRAM_BASE, %A0
+  cmp.b   #1, %D6
+  bne     _reply_nak
+_checkrange_target_ok:
+
+  /* Validate the length (1..UPLOAD_RAM_SIZE) and make sure the range fits */
+  clr.l   %D2
+  move.w  %D7, %D2
+  beq     _reply_nak
+  move.l  %D7, %D1
+  clr.w   %D1
+  swap    %D1
+  adda.l  %D1, %A0
+  add.l   %D2, %D1
+  cmp.l   #UPLOAD_RAM_SIZE, %D1
+  bhi     _reply_nak
+
+  move.b  #REPLY_ACK, %D0
+  CALL    _sendchar
+
+  movea.l #_crc32_table, %A2
+  andi.l  #0xffff, %D7 /* Length */
+  CALL    _crc32_range
+
+  /* Send the CRC, high byte first. Also used by _checkaddress */
+_checkrange_send:
+  moveq   #3, %D5
+_checkrange_send_loop:
+  rol.l   #8, %D3
+  move.b  %D3, %D0
+  CALL    _sendchar
+  dbra    %D5, _checkrange_send_loop
+  bra     _mainloop
+
+/*
+   Framed upload to any writable address, e.g. tile, palette or sprite RAM. Starts with a 9 byte header,
+   answered with ACK or NAK like _uploadblock:
+     address (long), length (long), xor of the previous 8 bytes.
+   The range has to lie within one of the regions in _upload_regions. After an ACK the data follows,
+   then the CRC32 of header and data in high-low order, and the whole is answered with ACK or NAK.
+   There is no size limit, but the host keeps the chunks small so a resend doesn't cost much.
+   Registers: A0 = destination, A2 = CRC table, A3 = region table, D3 = CRC, D5 = header check,
+              D6 = address, D7 = length.
+*/
+_uploadaddress:
+  movea.l #_status_uploadaddress, %A0
+  move.w  #0x400, %D0 /* Yellow */
+  CALL    _print_status
+
+  movea.l #_crc32_table, %A2
+  move.l  #0xffffffff, %D3
+  clr.b   %D5
+
+  /* Address, high byte first */
+  moveq   #3, %D1
+_uploadaddress_address_loop:
+  CALL    _readchar
+  lsl.l   #8, %D6
+  move.b  %D0, %D6
+  eor.b   %D0, %D5
+  CRC32_UPDATE
+  dbra    %D1, _uploadaddress_address_loop
+
+  /* Length, high byte first */
+  moveq   #3, %D1
+_uploadaddress_length_loop:
+  CALL    _readchar
+  lsl.l   #8, %D7
+  move.b  %D0, %D7
+  eor.b   %D0, %D5
+  CRC32_UPDATE
+  dbra    %D1, _uploadaddress_length_loop
+
+  /* Header check byte */
+  CALL    _readchar
+  cmp.b   %D0, %D5
+  bne     _reply_nak
+
+  /* Validate the length, and find a region that holds the whole range. D1 = end of the range */
+  tst.l   %D7
+  beq     _reply_nak
+  move.l  %D6, %D1
+  add.l   %D7, %D1
+  bcs     _reply_nak
+  movea.l #_upload_regions, %A3
+  CALL    _findregion
+  beq     _reply_nak
+
+  /* Header is fine, tell the host to continue with the data */
+  movea.l %D6, %A0
+  move.b  #REPLY_ACK, %D0
+  CALL    _sendchar
+
+  /* Receive the data */
+_uploadaddress_data_loop:
+  CALL    _readchar
+  move.b  %D0, (%A0)+
+  CRC32_UPDATE
+  subq.l  #1, %D7
+  bne     _uploadaddress_data_loop
+  not.l   %D3
+
+  /* Receive the CRC, high byte first */
+  moveq   #3, %D2
+_uploadaddress_crc_loop:
+  CALL    _readchar
+  lsl.l   #8, %D7
+  move.b  %D0, %D7
+  dbra    %D2, _uploadaddress_crc_loop
+
+  cmp.l   %D3, %D7
+  bne     _reply_nak
+  bra     _reply_ack
+
+/*
+   Sends a range of memory, e.g. to take a snapshot of ram. Starts with a 9 byte header like _uploadaddress,
+   answered with ACK or NAK:
+     address (long), length (long), xor of the previous 8 bytes.
+   The range has to lie within one of the regions in _read_regions, so we never touch I/O or unmapped space.
+   After an ACK the data follows in nibble mode, then the CRC32 of the data, high byte first.
+   _checkaddress shares the header, but only sends the CRC.
+   Registers: A0 = source, A2 = CRC table, A3 = region table, A4 = what to do after the ACK, D3 = CRC,
+              D5 = header check / counter, D6 = address, D7 = length.
+*/
+_readrange:
+  movea.l #_status_readrange, %A0
+  movea.l #_readrange_send, %A4
+  bra     _readrange_header
+
+_checkaddress:
+  movea.l #_status_checkaddress, %A0
+  movea.l #_checkaddress_crc, %A4
+
+_readrange_header:
+  move.w  #0x400, %D0 /* Yellow */
+  CALL    _print_status
+
+  clr.b   %D5
+
+  /* Address, high byte first */
+  moveq   #3, %D1
+_readrange_address_loop:
+  CALL    _readchar
+  lsl.l   #8, %D6
+  move.b  %D0, %D6
+  eor.b   %D0, %D5
+  dbra    %D1, _readrange_address_loop
+
+  /* Length, high byte first */
+  moveq   #3, %D1
+_readrange_length_loop:
+  CALL    _readchar
+  lsl.l   #8, %D7
+  move.b  %D0, %D7
+  eor.b   %D0, %D5
+  dbra    %D1, _readrange_length_loop
+
+  /* Header check byte */
+  CALL    _readchar
+  cmp.b   %D0, %D5
+  bne     _reply_nak
+
+  /* Validate the length, and find a region that holds the whole range. D1 = end of the range */
+  tst.l   %D7
+  beq     _reply_nak
+  move.l  %D6, %D1
+  add.l   %D7, %D1
+  bcs     _reply_nak
+  movea.l #_read_regions, %A3
+  CALL    _findregion
+  beq     _reply_nak
+
+  movea.l %D6, %A0
+  move.b  #REPLY_ACK, %D0
+  CALL    _sendchar
+  jmp     (%A4)
+
+  /* Send the data. _sendchar leaves D0 alone */
+_readrange_send:
+  movea.l #_crc32_table, %A2
+  move.l  #0xffffffff, %D3
+_readrange_loop:
+  move.b  (%A0)+, %D0
+  CRC32_UPDATE
+  CALL    _sendchar
+  subq.l  #1, %D7
+  bne     _readrange_loop
+  not.l   %D3
+
+  /* Send the CRC, high byte first */
+  moveq   #3, %D5
+_readrange_crc_loop:
+  rol.l   #8, %D3
+  move.b  %D3, %D0
+  CALL    _sendchar
+  dbra    %D5, _readrange_crc_loop
+  bra     _mainloop
+
+  /* Only the CRC, which takes about 9 microseconds per byte */
+_checkaddress_crc:
+  movea.l #_crc32_table, %A2
+  CALL    _crc32_range
+  bra     _checkrange_send
+
+/*
+   Fills a range of memory with a single byte, so zeros (like .bss) don't have to go over the wire.
+   Starts with a 10 byte header, answered with ACK once the range is filled, or NAK:
+     address (long), length (long), fill byte, xor of the previous 9 bytes.
+   The range has to lie within one of the regions in _upload_regions, like _uploadaddress.
+   Registers: A0 = destination, A3 = region table, D3 = fill byte, D5 = header check, D6 = address,
+              D7 = length.
+*/
+_fillregion:
+  movea.l #_status_fillregion, %A0
+  move.w  #0x400, %D0 /* Yellow */
+  CALL    _print_status
+
+  clr.b   %D5
+
+  /* Address, high byte first */
+  moveq   #3, %D1
+_fillregion_address_loop:
+  CALL    _readchar
+  lsl.l   #8, %D6
+  move.b  %D0, %D6
+  eor.b   %D0, %D5
+  dbra    %D1, _fillregion_address_loop
+
+  /* Length, high byte first */
+  moveq   #3, %D1
+_fillregion_length_loop:
+  CALL    _readchar
+  lsl.l   #8, %D7
+  move.b  %D0, %D7
+  eor.b   %D0, %D5
+  dbra    %D1, _fillregion_length_loop
+
+  /* Fill byte and header check byte */
+  CALL    _readchar
+  move.b  %D0, %D3
+  eor.b   %D0, %D5
+  CALL    _readchar
+  cmp.b   %D0, %D5
+  bne     _reply_nak
+
+  /* Validate the length, and find a region that holds the whole range. D1 = end of the range */
+  tst.l   %D7
+  beq     _reply_nak
+  move.l  %D6, %D1
+  add.l   %D7, %D1
+  bcs     _reply_nak
+  movea.l #_upload_regions, %A3
+  CALL    _findregion
+  beq     _reply_nak
+
+  /* Four bytes per iteration, like _crc32_range */
+  movea.l %D6, %A0
+  move.w  %D7, %D2
+  andi.w  #3, %D2
+  lsr.l   #2, %D7
+  beq     _fillregion_tail
+_fillregion_loop:
+  WATCHDOG_CLEAR
+  move.b  %D3, (%A0)+
+  move.b  %D3, (%A0)+
+  move.b  %D3, (%A0)+
+  move.b  %D3, (%A0)+
+  subq.l  #1, %D7
+  bne     _fillregion_loop
+  bra     _fillregion_tail
+_fillregion_tail_loop:
+  move.b  %D3, (%A0)+
+_fillregion_tail:
+  dbra    %D2, _fillregion_tail_loop
+  bra     _reply_ack
+
+/*
+   CRC32 of D7 bytes (at least one) from A0, four bytes per iteration. Result in D3.
+   A7 = Return address, A2 = CRC table. Modifies D0, D2, D3, D4, D7 and A0.
+*/
+_crc32_range:
+  move.l  #0xffffffff, %D3
+  move.w  %D7, %D2
+  andi.w  #3, %D2 /* What's left after the unrolled loop */
+  lsr.l   #2, %D7
+  beq     _crc32_range_tail
+_crc32_range_loop:
+  WATCHDOG_CLEAR
+  move.b  (%A0)+, %D0
+  CRC32_UPDATE
+  move.b  (%A0)+, %D0
+  CRC32_UPDATE
+  move.b  (%A0)+, %D0
+  CRC32_UPDATE
+  move.b  (%A0)+, %D0
+  CRC32_UPDATE
+  subq.l  #1, %D7
+  bne     _crc32_range_loop
+  bra     _crc32_range_tail
+_crc32_range_tail_loop:
+  move.b  (%A0)+, %D0
+  CRC32_UPDATE
+_crc32_range_tail:
+  dbra    %D2, _crc32_range_tail_loop
+  not.l   %D3
+  RETURN
+
+/*
+   Checks whether the range from D6 up to D1 (exclusive) lies within one of the regions in the table at A3.
+   The Z flag is set when it doesn't, so follow up with a beq.
+   A7 = Return address. Modifies D2, D4 and A3.
+*/
+_findregion:
+  move.l  (%A3)+, %D2 /* Region start */
+  move.l  (%A3)+, %D4 /* Region end; zero ends the table */
+  beq     _findregion_end
+  cmp.l   %D2, %D6
+  bcs     _findregion
+  cmp.l   %D4, %D1
+  bhi     _findregion
+_findregion_end:
+  tst.l   %D4
+  RETURN
 
 /*
    Prints a status message.
@@ -494,7 +1190,7 @@ _trap_f_ram: .skip 4
 .section .rodata
 
 _titlemessage:
-.asciz "  OUTRUN BOOTLOADER V0.9B EFC 2015 "
+.asciz "  OUTRUN BOOTLOADER V0.9E EFC 2015 "
 
 # Status messages
 _status_idle:
@@ -507,6 +1203,20 @@ _status_uploadram:
 .asciz "      UPLOADING TO MAIN RAM..."
 _status_uploadsub:
 .asciz "       UPLOADING TO SUB RAM..."
+_status_uploadblock:
+.asciz "        UPLOADING BLOCKS...   "
+_status_uploadcompressed:
+.asciz "   UPLOADING COMPRESSED...    "
+_status_checkrange:
+.asciz "        CHECKING RAM...       "
+_status_uploadaddress:
+.asciz "      UPLOADING SEGMENTS...   "
+_status_readrange:
+.asciz "       READING MEMORY...      "
+_status_checkaddress:
+.asciz "      CHECKING MEMORY...      "
+_status_fillregion:
+.asciz "       FILLING MEMORY...      "
 _status_invalid:
 .asciz "          INVALID COMMAND     "
 
@@ -518,3 +1228,94 @@ _textpalette:
 
 _hexlookup:
 .ascii "0123456789ABCDEF"
+
+/* Regions _uploadaddress and _fillregion may write to, for _findregion: start, end (exclusive). A zero end ends the table. */
+.align 2
+_upload_regions:
+.long 0x060000,       0x068000                 /* Main RAM */
+.long TILERAM_BASE,   TILERAM_BASE+0x10000     /* Tile RAM */
+.long TEXTRAM_BASE,   TEXTRAM_BASE+0x1000      /* Text RAM */
+.long PALETTE_BASE,   PALETTE_BASE+0x2000      /* Palette RAM */
+.long SPRITE_BASE,    SPRITE_BASE+0x1000       /* Sprite RAM */
+.long SUBRAM_BASE,    SUBRAM_BASE+0x8000       /* Sub RAM */
+.long 0, 0
+
+/* Regions _readrange may read from: all of the above, and both ROMs. */
+_read_regions:
+.long 0x000000,       0x060000                 /* Main ROM */
+.long 0x060000,       0x068000                 /* Main RAM */
+.long TILERAM_BASE,   TILERAM_BASE+0x10000     /* Tile RAM */
+.long TEXTRAM_BASE,   TEXTRAM_BASE+0x1000      /* Text RAM */
+.long PALETTE_BASE,   PALETTE_BASE+0x2000      /* Palette RAM */
+.long SPRITE_BASE,    SPRITE_BASE+0x1000       /* Sprite RAM */
+.long 0x200000,       SUBRAM_BASE              /* Sub ROM */
+.long SUBRAM_BASE,    SUBRAM_BASE+0x8000       /* Sub RAM */
+.long 0, 0
+
+/* CRC32 lookup table, polynomial 0xedb88320 */
+.align 2
+_crc32_table:
+.long 0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA
+.long 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3
+.long 0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988
+.long 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91
+.long 0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE
+.long 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7
+.long 0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC
+.long 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5
+.long 0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172
+.long 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B
+.long 0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940
+.long 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59
+.long 0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116
+.long 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F
+.long 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924
+.long 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D
+.long 0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A
+.long 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433
+.long 0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818
+.long 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01
+.long 0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E
+.long 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457
+.long 0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C
+.long 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65
+.long 0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2
+.long 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB
+.long 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0
+.long 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9
+.long 0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086
+.long 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F
+.long 0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4
+.long 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD
+.long 0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A
+.long 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683
+.long 0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8
+.long 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1
+.long 0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE
+.long 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7
+.long 0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC
+.long 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5
+.long 0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252
+.long 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B
+.long 0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60
+.long 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79
+.long 0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236
+.long 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F
+.long 0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04
+.long 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D
+.long 0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A
+.long 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713
+.long 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38
+.long 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21
+.long 0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E
+.long 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777
+.long 0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C
+.long 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45
+.long 0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2
+.long 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB
+.long 0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0
+.long 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9
+.long 0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6
+.long 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF
+.long 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94
+.long 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
@@ -0,0 +1,82 @@
+#ifndef __PLATFORM_H__
+#define __PLATFORM_H__
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <stddef.h>
+#include <strings.h>
+#endif
+#include <assert.h>
+
+// Types.
+typedef signed char int8;
+typedef unsigned char uint8;
+typedef short int16;
+typedef unsigned short uint16;
+typedef int int32;
+typedef unsigned int uint32;
+#ifdef _WIN32
+typedef unsigned __int64 uint64;
+#define FMT_U64 "%I64u"
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define snprintf _snprintf
+#endif
+#else
+typedef unsigned long long uint64;
+#define FMT_U64 "%llu"
+#define stricmp strcasecmp
+#define strnicmp strncasecmp
+#endif
+
+#define DEBUG_ASSERT assert
+
+// Thread local storage, for plain types and pointers.
+#ifdef _WIN32
+#define PLATFORM_THREAD_LOCAL __declspec(thread)
+#else
+#define PLATFORM_THREAD_LOCAL __thread
+#endif
+
+// Timing and thread helpers. Implemented per platform in platform.cpp.
+
+// Monotonic time in nanoseconds, as accurate as the platform allows.
+uint64 PLATFORM_GetTimeNS ();
+
+// Monotonic tick count in milliseconds. Wraps around, so only use differences.
+uint32 PLATFORM_GetTickCountMS ();
+
+void PLATFORM_SleepMS (uint32 milliseconds);
+
+// Identifies the calling thread.
+uint64 PLATFORM_GetCurrentThreadID ();
+
+// Pins the calling thread to a CPU (the first one by default), so our busy waits aren't disturbed by migrations.
+void PLATFORM_PinCurrentThread (uint32 cpu = 0);
+
+// Number of CPUs we can run on.
+uint32 PLATFORM_GetNumCPUs ();
+
+// Lowers the priority of the calling thread.
+void PLATFORM_SetLowPriority ();
+
+// Full memory barrier, for data shared between threads without locks.
+#ifdef _WIN32
+#define PLATFORM_MemoryBarrier() MemoryBarrier()
+#else
+#define PLATFORM_MemoryBarrier() __sync_synchronize()
+#endif
+
+// Starts a thread running pFunc (pParam).
+struct PlatformThread;
+typedef void (*PlatformThreadFunc) (void* pParam);
+PlatformThread* PLATFORM_StartThread (PlatformThreadFunc pFunc, void* pParam);
+
+// Waits for the thread to finish, and frees it.
+void PLATFORM_JoinThread (PlatformThread* pThread);
+
+// Maps a file read-only. Returns NULL on failure. Empty files give a valid pointer and zero bytes.
+const uint8* PLATFORM_MapFile (const char* fileName, uint32& nBytes);
+void PLATFORM_UnmapFile (const uint8* pData, uint32 nBytes);
+
+#endif // __PLATFORM_H__
@@ -0,0 +1,331 @@
+#include <Platform.h>
+#include "comm.h"
+#include "crc32.h"
+#include "bootcmd.h"
+
+bool Nop ()       { return COMM_SendByte (COMMAND_NOP); }
+bool RebootRAM () { return COMM_SendByte (COMMAND_REBOOTRAM); }
+bool RebootROM () { return COMM_SendByte (COMMAND_REBOOTROM); }
+
+static bool UploadInternal (const uint8* pData, uint16 nBytes)
+{
+	// Command has been sent.
+	if (!COMM_SendWord (nBytes))
+		return false;
+
+	// Now send out all the data.
+	for (uint32 i=0; i<nBytes; i++)
+		if (!COMM_SendByte(pData[i]))
+			return false;
+
+	// The data is in ram once the bootloader is back in the main loop. Bootloaders before V0.9E take
+	// another 500ms for that.
+	return COMM_WaitReady ();
+}
+
+bool UploadMainRam (const void* pData, uint16 nBytes)
+{
+	DEBUG_ASSERT(pData);
+	DEBUG_ASSERT(nBytes <= 32768);
+	if (!COMM_SendByte (COMMAND_UPLOADMAIN))
+		return false;
+
+	return UploadInternal ((const uint8*)pData, nBytes);
+}
+
+bool UploadSubRam (const void* pData, uint16 nBytes)
+{
+	DEBUG_ASSERT(pData);
+	DEBUG_ASSERT(nBytes <= 32768);
+	if (!COMM_SendByte (COMMAND_UPLOADSUB))
+		return false;
+
+	return UploadInternal ((const uint8*)pData, nBytes);
+}
+
+// Headers for the framed commands: a target, two words and a check byte.
+static void BuildHeader (uint8* pHeader, uint8 target, uint16 word0, uint16 word1)
+{
+	pHeader[0] = target;
+	pHeader[1] = (uint8)(word0 >> 8);
+	pHeader[2] = (uint8)(word0 & 0xff);
+	pHeader[3] = (uint8)(word1 >> 8);
+	pHeader[4] = (uint8)(word1 & 0xff);
+	pHeader[5] = pHeader[0] ^ pHeader[1] ^ pHeader[2] ^ pHeader[3] ^ pHeader[4];
+}
+
+// Sends the data and its CRC, at dataDelayNS if that's set.
+static bool SendFrameData (const uint8* pData, uint32 nBytes, uint32 crc, uint64 dataDelayNS)
+{
+	const uint64 txDelayNS = COMM_GetTXDelayNS ();
+	if (dataDelayNS)
+		COMM_SetTXDelayNS (dataDelayNS);
+
+	bool bSent = true;
+	for (uint32 i=0; i<nBytes && bSent; i++)
+		bSent = COMM_SendByte (pData[i]);
+	bSent = bSent && COMM_SendWord ((uint16)(crc >> 16)) && COMM_SendWord ((uint16)(crc & 0xffff));
+
+	COMM_SetTXDelayNS (txDelayNS);
+	return bSent;
+}
+
+// Time the bootloader gets to answer a frame of NOPs. Unpacking one for a compressed upload takes longest.
+static const uint32 kResyncReplyMS = 1000;
+
+// After a reply to the header that was neither ACK nor NAK, we can't tell whether the bootloader took the
+// header. NOPs fill in the data and CRC it may be waiting for, or are taken as NOP commands if it isn't.
+// Only in the first case does it answer them, and that answer is dropped. Returns false on a timeout.
+static bool ResyncFrame (uint32 nBytes)
+{
+	for (uint32 i=0; i<nBytes+4; i++)
+		if (!Nop ())
+			return false;
+
+	const uint32 rxTimeOut = COMM_GetRXTimeOutMS ();
+	COMM_SetRXTimeOutMS (kResyncReplyMS);
+	if (COMM_RecvByte () == -1)
+		COMM_Reset ();
+	COMM_SetRXTimeOutMS (rxTimeOut);
+	return true;
+}
+
+// Sends a framed command and its data, and resends it until the bootloader acknowledges both.
+// A refused header means the bootloader went back to waiting for a command, so we start over.
+static bool SendFramed (uint8 command, const uint8* pHeader, uint32 nHeaderBytes, const uint8* pData, uint32 nBytes, uint32 crc, uint32& nRetries, uint32 maxRetries, uint64 dataDelayNS = 0)
+{
+	for (uint32 attempt=0; attempt<=maxRetries; attempt++)
+	{
+		if (attempt)
+			nRetries++;
+
+		if (!COMM_SendByte (command))
+			return false;
+
+		for (uint32 i=0; i<nHeaderBytes; i++)
+			if (!COMM_SendByte (pHeader[i]))
+				return false;
+
+		int16 reply = COMM_RecvByte ();
+		if (reply == -1)
+			return false;
+		if (reply == REPLY_NAK)
+			continue;
+		if (reply != REPLY_ACK)
+		{
+			if (!ResyncFrame (nBytes))
+				return false;
+			continue;
+		}
+
+		if (!SendFrameData (pData, nBytes, crc, dataDelayNS))
+			return false;
+
+		reply = COMM_RecvByte ();
+		if (reply == -1)
+			return false;
+		if (reply == REPLY_ACK)
+			return true;
+	}
+
+	return false;
+}
+
+bool UploadBlock (uint8 target, uint16 offset, const void* pBlockData, uint16 nBytes, uint32& nRetries, uint32 maxRetries, uint64 dataDelayNS)
+{
+	DEBUG_ASSERT(nBytes && nBytes <= kBlockSize);
+	const uint8* pData = (const uint8*)pBlockData;
+	uint8 header[6];
+	BuildHeader (header, target, offset, nBytes);
+
+	// The CRC covers the header as well, minus the check byte.
+	uint32 crc = CRC32_Calc (header, 5);
+	crc = CRC32_Calc (pData, nBytes, crc);
+
+	return SendFramed (COMMAND_UPLOADBLOCK, header, sizeof(header), pData, nBytes, crc, nRetries, maxRetries, dataDelayNS);
+}
+
+bool UploadFramed (uint8 target, const void* pData, uint16 nBytes, uint32& nRetries)
+{
+	DEBUG_ASSERT(pData);
+	DEBUG_ASSERT(nBytes <= 32768);
+	const uint8* pByteData = (const uint8*)pData;
+	for (uint32 offset=0; offset<nBytes; offset+=kBlockSize)
+	{
+		uint32 blockSize = nBytes - offset;
+		if (blockSize > kBlockSize)
+			blockSize = kBlockSize;
+
+		if (!UploadBlock (target, (uint16)offset, pByteData + offset, (uint16)blockSize, nRetries, kMaxBlockRetries))
+			return false;
+	}
+
+	return true;
+}
+
+bool UploadCompressedData (uint8 target, const void* pCompressed, uint16 nCompressedBytes, uint16 nBytes, uint32 crc, uint32& nRetries)
+{
+	DEBUG_ASSERT(pCompressed && nCompressedBytes);
+	uint8 header[6];
+	BuildHeader (header, target, nCompressedBytes, nBytes);
+
+	// Unlike framed blocks, the CRC covers the decompressed image only.
+	return SendFramed (COMMAND_UPLOADCOMPRESSED, header, sizeof(header), (const uint8*)pCompressed, nCompressedBytes, crc, nRetries, kMaxBlockRetries);
+}
+
+// Sends a command that is answered with ACK and a CRC, and retries it as long as it's refused.
+static bool RequestCRC (uint8 command, const uint8* pHeader, uint32 nHeaderBytes, uint32& crc)
+{
+	for (uint32 attempt=0; attempt<=kMaxBlockRetries; attempt++)
+	{
+		if (!COMM_SendByte (command))
+			return false;
+
+		for (uint32 i=0; i<nHeaderBytes; i++)
+			if (!COMM_SendByte (pHeader[i]))
+				return false;
+
+		int16 reply = COMM_RecvByte ();
+		if (reply == -1)
+			return false;
+		if (reply != REPLY_ACK)
+			continue;
+
+		// The CRC follows in high-low order.
+		uint8 crcBytes[4];
+		if (COMM_RecvBytes (crcBytes, sizeof(crcBytes)) != sizeof(crcBytes))
+			return false;
+
+		crc = (crcBytes[0] << 24) | (crcBytes[1] << 16) | (crcBytes[2] << 8) | crcBytes[3];
+		return true;
+	}
+
+	return false;
+}
+
+bool CheckRange (uint8 target, uint16 offset, uint16 nBytes, uint32& crc)
+{
+	DEBUG_ASSERT(nBytes);
+	uint8 header[6];
+	BuildHeader (header, target, offset, nBytes);
+	return RequestCRC (COMMAND_CHECKRANGE, header, sizeof(header), crc);
+}
+
+// Headers for the commands with an address: address and length as longs, and a check byte.
+static void BuildAddressHeader (uint8* pHeader, uint32 address, uint32 nBytes)
+{
+	for (uint32 i=0; i<4; i++)
+	{
+		pHeader[i] = (uint8)(address >> (24 - i*8));
+		pHeader[4+i] = (uint8)(nBytes >> (24 - i*8));
+	}
+	pHeader[8] = 0;
+	for (uint32 i=0; i<8; i++)
+		pHeader[8] ^= pHeader[i];
+}
+
+bool CheckAddress (uint32 address, uint32 nBytes, uint32& crc)
+{
+	DEBUG_ASSERT(nBytes);
+	uint8 header[9];
+	BuildAddressHeader (header, address, nBytes);
+	return RequestCRC (COMMAND_CHECKADDRESS, header, sizeof(header), crc);
+}
+
+bool FillRegion (uint32 address, uint32 nBytes, uint8 value, uint32& nRetries)
+{
+	DEBUG_ASSERT(nBytes);
+	uint8 header[10];
+	BuildAddressHeader (header, address, nBytes);
+	header[8] = value;
+	header[9] = header[8];
+	for (uint32 i=0; i<8; i++)
+		header[9] ^= header[i];
+
+	for (uint32 attempt=0; attempt<=kMaxBlockRetries; attempt++)
+	{
+		if (attempt)
+			nRetries++;
+
+		if (!COMM_SendByte (COMMAND_FILLREGION))
+			return false;
+
+		for (uint32 i=0; i<sizeof(header); i++)
+			if (!COMM_SendByte (header[i]))
+				return false;
+
+		int16 reply = COMM_RecvByte ();
+		if (reply == -1)
+			return false;
+		if (reply == REPLY_ACK)
+			return true;
+	}
+
+	return false;
+}
+
+bool UploadAddressBlock (uint32 address, const void* pBlockData, uint32 nBytes, uint32& nRetries, uint32 maxRetries)
+{
+	DEBUG_ASSERT(nBytes);
+	const uint8* pData = (const uint8*)pBlockData;
+	uint8 header[9];
+	BuildAddressHeader (header, address, nBytes);
+
+	uint32 crc = CRC32_Calc (header, 8);
+	crc = CRC32_Calc (pData, nBytes, crc);
+
+	return SendFramed (COMMAND_UPLOADADDRESS, header, sizeof(header), pData, nBytes, crc, nRetries, maxRetries);
+}
+
+static bool ReadRangeBlock (uint32 address, uint8* pBuffer, uint32 nBytes, uint32& nRetries)
+{
+	uint8 header[9];
+	BuildAddressHeader (header, address, nBytes);
+
+	for (uint32 attempt=0; attempt<=kMaxBlockRetries; attempt++)
+	{
+		if (attempt)
+			nRetries++;
+
+		if (!COMM_SendByte (COMMAND_READRANGE))
+			return false;
+
+		for (uint32 i=0; i<sizeof(header); i++)
+			if (!COMM_SendByte (header[i]))
+				return false;
+
+		int16 reply = COMM_RecvByte ();
+		if (reply == -1)
+			return false;
+		if (reply != REPLY_ACK)
+			continue;
+
+		// The data, then its CRC in high-low order.
+		uint8 crcBytes[4];
+		if (COMM_RecvBytes (pBuffer, nBytes) != nBytes || COMM_RecvBytes (crcBytes, sizeof(crcBytes)) != sizeof(crcBytes))
+			return false;
+
+		uint32 crc = (crcBytes[0] << 24) | (crcBytes[1] << 16) | (crcBytes[2] << 8) | crcBytes[3];
+		if (CRC32_Calc (pBuffer, nBytes) == crc)
+			return true;
+	}
+
+	return false;
+}
+
+bool ReadRange (uint32 address, void* pBuffer, uint32 nBytes, uint32& nRetries)
+{
+	DEBUG_ASSERT(pBuffer);
+	uint8* pByteBuffer = (uint8*)pBuffer;
+	for (uint32 offset=0; offset<nBytes; offset+=kReadBlockSize)
+	{
+		uint32 blockSize = nBytes - offset;
+		if (blockSize > kReadBlockSize)
+			blockSize = kReadBlockSize;
+
+		if (!ReadRangeBlock (address + offset, pByteBuffer + offset, blockSize, nRetries))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,94 @@
+#ifndef __BOOTCMD_H__
+#define __BOOTCMD_H__
+
+#include <Platform.h>
+
+// Commands understood by the bootloader (see _mainloop in boot.s).
+// All of these are sent through the comm layer, so call them from the comm thread.
+enum
+{
+	COMMAND_NOP        = 0,
+	COMMAND_REBOOTRAM  = 1,
+	COMMAND_REBOOTROM  = 2,
+	COMMAND_UPLOADMAIN = 3,
+	COMMAND_UPLOADSUB  = 4,
+	COMMAND_UPLOADBLOCK = 5,
+	COMMAND_UPLOADCOMPRESSED = 6,
+	COMMAND_CHECKRANGE = 7,
+	COMMAND_UPLOADADDRESS = 8,
+	COMMAND_READRANGE = 9,
+	COMMAND_CHECKADDRESS = 10,
+	COMMAND_FILLREGION = 11,
+};
+
+// Framed uploads. Every block header and block is answered by the bootloader in nibble mode.
+enum
+{
+	BLOCK_TARGET_MAIN = 0,
+	BLOCK_TARGET_SUB  = 1,
+};
+
+enum
+{
+	REPLY_ACK = 0x06,
+	REPLY_NAK = 0x15,
+};
+
+static const uint16 kBlockSize = 256;     // Should not exceed BLOCK_MAX_SIZE in boot.s.
+static const uint32 kMaxBlockRetries = 8; // Per block. A cable that's worse than this needs fixing instead.
+static const uint32 kSegmentBlockSize = 1024; // COMMAND_UPLOADADDRESS has no limit, but a resend shouldn't cost much.
+static const uint32 kReadBlockSize = 4096;    // Same for COMMAND_READRANGE.
+
+// Where the plain, framed and compressed uploads go.
+static const uint32 kMainRamAddress = 0x060000;
+static const uint32 kSubRamAddress = 0x260000;
+
+// The reboots return as soon as the command is sent. Since V0.9E the bootloader doesn't wait before it
+// reboots anymore.
+bool Nop ();
+bool RebootRAM ();
+bool RebootROM ();
+
+// Plain uploads of up to 32KB to the start of main or sub RAM. Nothing is checked, but they do wait until
+// the bootloader is ready for the next command.
+bool UploadMainRam (const void* pData, uint16 nBytes);
+bool UploadSubRam (const void* pData, uint16 nBytes);
+
+// Sends a single block of up to kBlockSize bytes with its header and CRC, and resends it until the
+// bootloader acknowledges it. Resends are added to nRetries. A nonzero dataDelayNS is used as the TX delay
+// for the data and CRC only, e.g. to try out a delay without risking the command and header.
+// Returns false on a timeout, or when the block was refused more than maxRetries times.
+bool UploadBlock (uint8 target, uint16 offset, const void* pBlockData, uint16 nBytes, uint32& nRetries, uint32 maxRetries, uint64 dataDelayNS = 0);
+
+// Uploads an image in blocks of kBlockSize, only resending the blocks that arrived damaged.
+bool UploadFramed (uint8 target, const void* pData, uint16 nBytes, uint32& nRetries);
+
+// Uploads data that was already compressed with LZ_Compress. crc is the CRC32 of the decompressed data.
+bool UploadCompressedData (uint8 target, const void* pCompressed, uint16 nCompressedBytes, uint16 nBytes, uint32 crc, uint32& nRetries);
+
+// Asks the bootloader for the CRC32 of nBytes of main or sub ram, starting at offset. Also see CRC32_Calc.
+// Returns false on a timeout, or when the request was refused more than kMaxBlockRetries times.
+bool CheckRange (uint8 target, uint16 offset, uint16 nBytes, uint32& crc);
+
+// Sends nBytes to any address the bootloader allows writing to (see _upload_regions in boot.s and manifest.h),
+// with a CRC, and resends it until the bootloader acknowledges it. Needs bootloader V0.9D.
+// Returns false on a timeout, or when the data was refused more than maxRetries times.
+bool UploadAddressBlock (uint32 address, const void* pBlockData, uint32 nBytes, uint32& nRetries, uint32 maxRetries);
+
+// Reads nBytes from any address the bootloader lets us read (see _read_regions in boot.s), in blocks of
+// kReadBlockSize. Every block is checked against the CRC the bootloader sends after it, and read again
+// when it arrived damaged. Needs bootloader V0.9D.
+// Returns false on a timeout, or when a block was refused or damaged more than kMaxBlockRetries times.
+bool ReadRange (uint32 address, void* pBuffer, uint32 nBytes, uint32& nRetries);
+
+// Asks the bootloader for the CRC32 of nBytes at any address it lets us read, like CheckRange. This takes
+// about 9 microseconds per byte, so checking a whole 32KB image costs less than 0.3 seconds. Needs bootloader V0.9E.
+// Returns false on a timeout, or when the request was refused more than kMaxBlockRetries times.
+bool CheckAddress (uint32 address, uint32 nBytes, uint32& crc);
+
+// Has the bootloader set nBytes at any writable address to value, e.g. to clear .bss without sending the zeros.
+// It answers once the range is filled, which takes about 2 microseconds per byte. Needs bootloader V0.9E.
+// Returns false on a timeout, or when the request was refused more than kMaxBlockRetries times.
+bool FillRegion (uint32 address, uint32 nBytes, uint8 value, uint32& nRetries);
+
+#endif // __BOOTCMD_H__
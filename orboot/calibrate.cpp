@@ -0,0 +1,153 @@
+#include <Platform.h>
+#include <stdio.h>
+#include "comm.h"
+#include "bootcmd.h"
+#include "calibrate.h"
+
+static const uint32 kNumPatterns = 8;
+static const uint32 kConfirmRounds = 4;       // Final check runs all patterns this many times.
+static const uint64 kResolutionNS = 1000;     // Stop searching when good and bad are this close.
+static const uint64 kMinMarginNS = 5000;      // Safety margin on top of the smallest good delay,
+static const uint32 kMarginPercent = 25;      // or this percentage of it if that's larger.
+static const uint32 kResyncBytes = 1 + 6 + kBlockSize + 4; // Enough to finish any block the bootloader is in.
+
+static uint8 s_patterns[kNumPatterns][kBlockSize];
+
+// Patterns that stress the data lines: walking ones and zeros, alternating bits,
+// all lines toggling at once, a counter and pseudo-random data.
+static void BuildPatterns ()
+{
+	uint32 seed = 0x1234567;
+	for (uint32 i=0; i<kBlockSize; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		s_patterns[0][i] = (uint8)(1 << (i & 7));
+		s_patterns[1][i] = (uint8)~(1 << (i & 7));
+		s_patterns[2][i] = (i & 1) ? 0xaa : 0x55;
+		s_patterns[3][i] = (i & 1) ? 0xff : 0x00;
+		s_patterns[4][i] = (uint8)i;
+		s_patterns[5][i] = (uint8)~i;
+		s_patterns[6][i] = (uint8)(seed >> 16);
+		s_patterns[7][i] = (uint8)(seed >> 24) ^ (uint8)i;
+	}
+}
+
+enum TrialResult
+{
+	TRIAL_PASSED,
+	TRIAL_DAMAGED,
+	TRIAL_TIMEDOUT,
+};
+
+// Uploads every pattern, with the data at delayNS and the command and header at goodDelayNS, so a misread
+// byte only damages the block and the bootloader stays in step. Any block that's refused fails the trial.
+// Only a missing reply counts as a timeout; the comm layer counts those for us.
+static TrialResult RunTrial (uint64 delayNS, uint64 goodDelayNS, uint32 rounds)
+{
+	COMM_SetTXDelayNS (goodDelayNS);
+	uint32 nRetries = 0;
+	for (uint32 round=0; round<rounds; round++)
+	{
+		for (uint32 i=0; i<kNumPatterns; i++)
+		{
+			const uint32 nTimeOuts = COMM_GetTelemetry ().nTimeOuts;
+			if (!UploadBlock (BLOCK_TARGET_MAIN, (uint16)(i * kBlockSize), s_patterns[i], kBlockSize, nRetries, 0, delayNS))
+				return COMM_GetTelemetry ().nTimeOuts != nTimeOuts ? TRIAL_TIMEDOUT : TRIAL_DAMAGED;
+		}
+	}
+
+	return TRIAL_PASSED;
+}
+
+// A timeout means a strobe got lost, and the bootloader may still be waiting for part of a block. NOPs at a
+// good delay fill up whatever it expects, the reply to that is read and dropped, and the rest are taken as
+// NOP commands. Returns false if it doesn't take them.
+static bool Resync (uint64 goodDelayNS)
+{
+	COMM_SetTXDelayNS (goodDelayNS);
+	COMM_Reset ();
+
+	uint32 nSent = 0;
+	for (uint32 attempt=0; attempt<kResyncBytes*2 && nSent<kResyncBytes; attempt++)
+	{
+		if (COMM_SendByte (COMMAND_NOP))
+		{
+			nSent++;
+			continue;
+		}
+
+		// Busy: it's waiting to reply.
+		COMM_Reset ();
+		if (COMM_RecvByte () == -1)
+			return false;
+	}
+
+	return nSent == kResyncBytes && Nop ();
+}
+
+static void PrintTrial (uint64 delayNS, TrialResult result)
+{
+	static const char* resultNames[] = { "ok", "damaged", "timed out" };
+	printf ("  " FMT_U64 " ns: %s\n", delayNS, resultNames[result]);
+}
+
+// A delay that timed out counts as bad once the bootloader is back in step.
+static bool Probe (uint64 delayNS, uint64 goodDelayNS, TrialResult& result)
+{
+	result = RunTrial (delayNS, goodDelayNS, 1);
+	PrintTrial (delayNS, result);
+	if (result != TRIAL_TIMEDOUT)
+		return true;
+
+	if (Resync (goodDelayNS))
+		return true;
+
+	printf ("  The bootloader stopped responding.\n");
+	return false;
+}
+
+bool CALIBRATE_FindTXDelay (uint64 maxDelayNS, uint64& txDelayNS)
+{
+	BuildPatterns ();
+
+	// The round trip latency tells us roughly how slow the optocouplers are, so start there
+	// if it's tighter than the given maximum. Nothing is sent faster than that anyway.
+	COMM_ResetLatencyStats ();
+	TrialResult result = RunTrial (maxDelayNS, maxDelayNS, 1);
+	PrintTrial (maxDelayNS, result);
+	if (result != TRIAL_PASSED)
+		return false;
+
+	uint64 good = maxDelayNS;
+	const CommLatencyStats& stats = COMM_GetLatencyStats ();
+	if (stats.count && stats.maxNS * 2 < good)
+	{
+		if (!Probe (stats.maxNS * 2, good, result))
+			return false;
+		if (result == TRIAL_PASSED)
+			good = stats.maxNS * 2;
+	}
+
+	// Every probe sends its command and header at the best delay so far, so a bad delay is either refused
+	// or, when a strobe got lost, resynced at that delay.
+	uint64 bad = 0;
+	while (good - bad > kResolutionNS)
+	{
+		uint64 delay = bad + (good - bad) / 2;
+		if (!Probe (delay, good, result))
+			return false;
+		if (result == TRIAL_PASSED)
+			good = delay;
+		else bad = delay;
+	}
+
+	uint64 margin = good * kMarginPercent / 100;
+	if (margin < kMinMarginNS)
+		margin = kMinMarginNS;
+	txDelayNS = good + margin;
+
+	// One longer run with the final value, in case we were lucky near the edge.
+	result = RunTrial (txDelayNS, txDelayNS, kConfirmRounds);
+	PrintTrial (txDelayNS, result);
+	return result == TRIAL_PASSED;
+}
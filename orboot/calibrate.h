@@ -0,0 +1,13 @@
+#ifndef __CALIBRATE_H__
+#define __CALIBRATE_H__
+
+#include <Platform.h>
+
+// Finds the smallest TX delay that still transfers reliably, by uploading test patterns in framed
+// blocks (bootloader V0.9C) and binary searching between a known good and a known bad delay.
+// Patterns go to the start of main ram, so upload the real image afterwards.
+// The result includes a safety margin, and is left set in the comm layer.
+// Returns false if even maxDelayNS doesn't work, or the bootloader stopped responding.
+bool CALIBRATE_FindTXDelay (uint64 maxDelayNS, uint64& txDelayNS);
+
+#endif // __CALIBRATE_H__
@@ -2,36 +2,150 @@
 #include "comm.h"
 #include "lpt.h"
 
-// Timing settings.
-static uint64 s_txDelay = 50000; // 50 microseconds (25 might work too).
-static uint32 s_debugDelay = 0;  // Disabled by default.
-static uint32 s_rxTimeOut = 0;   // Disabled by default.
-static uint32 s_txTimeOut = 0; 	 // Disabled by default.
-
-// Control register mirror. Is initialized when COMM_Reset is called.
-static uint8 s_controlMirror = 0;
-
 // Inactivity time before we go into a low power slack state.
 static const uint32 kSlackOffTimeMS = 50;
 
+// Reading the clock costs more than reading the port, so we only look at it every so many polls.
+static const uint32 kPollsPerClockCheck = 16;
+
+static void ResetLatencyStats (CommLatencyStats& stats)
+{
+	stats.count = 0;
+	stats.minNS = 0;
+	stats.maxNS = 0;
+	stats.totalNS = 0;
+}
+
+static void ResetTelemetry (CommTelemetry& telemetry)
+{
+	for (uint32 i=0; i<COMM_NUM_PHASES; i++)
+		telemetry.phaseNS[i].Reset ();
+	telemetry.sendByteNS.Reset ();
+	telemetry.recvByteNS.Reset ();
+	telemetry.nSlackOffs = 0;
+	telemetry.nTimeOuts = 0;
+}
+
+// Everything we keep per port.
+struct CommPort
+{
+	LPTBackend* pBackend; // NULL for the default port, which uses whatever LPT_SetBackend selected.
+
+	// Timing settings.
+	uint64 txDelay;
+	uint32 debugDelay;
+	uint32 rxTimeOut;
+	uint32 txTimeOut;
+
+	// Control register mirror. Is initialized when COMM_Reset is called.
+	uint8 controlMirror;
+	uint8 controlInversionMask;
+
+	// BUSY round trip statistics.
+	CommLatencyStats latencyStats;
+
+	// Handshake telemetry. Only collected when enabled, since it reads the clock around every wait.
+	CommTelemetry telemetry;
+	bool bTelemetry;
+
+	// Thread that called COMM_Init.
+	uint64 threadID;
+
+	CommPort ()
+		: pBackend (NULL)
+		, txDelay (50000)  // 50 microseconds (25 might work too).
+		, debugDelay (0)   // Disabled by default.
+		, rxTimeOut (0)    // Disabled by default.
+		, txTimeOut (0)    // Disabled by default.
+		, controlMirror (0)
+		, controlInversionMask (0)
+		, bTelemetry (false)
+		, threadID (0)
+	{
+		ResetLatencyStats (latencyStats);
+		ResetTelemetry (telemetry);
+	}
+};
+
+// Used by threads that didn't select a port of their own.
+static CommPort s_defaultPort;
+static PLATFORM_THREAD_LOCAL CommPort* s_pPort = NULL;
+
+static inline CommPort& GetPort ()
+{
+	return s_pPort ? *s_pPort : s_defaultPort;
+}
+
 // Timing control functions.
-void COMM_SetTXDelayNS (uint64 nanoseconds) { s_txDelay = nanoseconds; }
-void COMM_SetDebugDelayMS (uint32 milliseconds) { s_debugDelay = milliseconds; }
-void COMM_SetRXTimeOutMS (uint32 milliseconds) { s_rxTimeOut = milliseconds; }
-void COMM_SetTXTimeOutMS (uint32 milliseconds) { s_txTimeOut = milliseconds; }
+void COMM_SetTXDelayNS (uint64 nanoseconds) { GetPort().txDelay = nanoseconds; }
+uint64 COMM_GetTXDelayNS () { return GetPort().txDelay; }
+void COMM_SetDebugDelayMS (uint32 milliseconds) { GetPort().debugDelay = milliseconds; }
+void COMM_SetRXTimeOutMS (uint32 milliseconds) { GetPort().rxTimeOut = milliseconds; }
+void COMM_SetTXTimeOutMS (uint32 milliseconds) { GetPort().txTimeOut = milliseconds; }
+uint32 COMM_GetRXTimeOutMS () { return GetPort().rxTimeOut; }
+
+void COMM_SetControlInversionMask (uint8 mask) { GetPort().controlInversionMask = (mask & 0xf); }
+
+void COMM_ResetLatencyStats ()
+{
+	ResetLatencyStats (GetPort().latencyStats);
+}
+
+const CommLatencyStats& COMM_GetLatencyStats ()
+{
+	return GetPort().latencyStats;
+}
+
+void COMM_EnableTelemetry (bool bEnable) { GetPort().bTelemetry = bEnable; }
+
+void COMM_ResetTelemetry ()
+{
+	ResetTelemetry (GetPort().telemetry);
+}
+
+const CommTelemetry& COMM_GetTelemetry ()
+{
+	return GetPort().telemetry;
+}
+
+static void AddLatency (CommPort& port, uint64 nanoSecs)
+{
+	CommLatencyStats& stats = port.latencyStats;
+	if (!stats.count || nanoSecs < stats.minNS)
+		stats.minNS = nanoSecs;
+	if (nanoSecs > stats.maxNS)
+		stats.maxNS = nanoSecs;
+	stats.totalNS += nanoSecs;
+	stats.count++;
+}
+
+CommPort* COMM_CreatePort (LPTBackend* pBackend)
+{
+	// Same settings, but nothing else.
+	CommPort* pPort = new CommPort (GetPort ());
+	pPort->pBackend = pBackend;
+	pPort->controlMirror = 0;
+	pPort->threadID = 0;
+	ResetLatencyStats (pPort->latencyStats);
+	ResetTelemetry (pPort->telemetry);
+	return pPort;
+}
 
-static uint8 s_controlInversionMask = 0;
-void COMM_SetControlInversionMask (uint8 mask) { s_controlInversionMask = (mask & 0xf); }
+void COMM_DestroyPort (CommPort* pPort)
+{
+	if (s_pPort == pPort)
+		s_pPort = NULL;
+	delete pPort;
+}
 
-// Single threaded initialization!
-static DWORD s_commThreadID = 0;
-static LARGE_INTEGER s_qpcFreq = { 0 };
-void COMM_Init ()
+void COMM_Init (CommPort* pPort, uint32 cpu)
 {
-	s_commThreadID = GetCurrentThreadId();
-	DWORD_PTR prevMask = SetThreadAffinityMask (GetCurrentThread(), 1);
-	BOOL qpfSucceeded = QueryPerformanceFrequency (&s_qpcFreq); // Well, this shouldn't fail.
-	DEBUG_ASSERT(qpfSucceeded && s_qpcFreq.QuadPart);
+	s_pPort = pPort;
+	if (pPort)
+		LPT_SetBackend (pPort->pBackend);
+
+	GetPort().threadID = PLATFORM_GetCurrentThreadID();
+	PLATFORM_PinCurrentThread (cpu);
 }
 
 // This will sleep (well, busy wait actually) for at least the given amount of nanoseconds.
@@ -40,84 +154,70 @@ static void SleepNanoSeconds (uint64 nanoSecs)
 	if (!nanoSecs)
 		return;
 
-	// We use QueryPerformanceCounter to do actual sleeping since it's about as accurate as we will get.
-	LARGE_INTEGER count1, count2;
-	QueryPerformanceCounter (&count1);
-	for (;;)
-	{
-		QueryPerformanceCounter (&count2);
-		uint64 nanoSecsElapsed = (((count2.QuadPart - count1.QuadPart) * 1000000000) / s_qpcFreq.QuadPart);
-		if (nanoSecsElapsed >= nanoSecs)
-			break;
-	}
+	// We use the high resolution timer to do actual sleeping since it's about as accurate as we will get.
+	uint64 start = PLATFORM_GetTimeNS();
+	while (PLATFORM_GetTimeNS() - start < nanoSecs)
+		;
 }
 
 // Resets the control register.
 void COMM_Reset ()
 {
 	// Make sure we're doing it from the same thread as we called Init() on.
-	DEBUG_ASSERT(GetCurrentThreadId() == s_commThreadID);
+	CommPort& port = GetPort ();
+	DEBUG_ASSERT(PLATFORM_GetCurrentThreadID() == port.threadID);
 
 	// Default: we want nSTROBE and nAUTOFEED to be high. Both are inverted.
-	s_controlMirror = 0;
-	if (s_debugDelay)
-		Sleep (s_debugDelay);
-	LPT_SetControl (s_controlMirror ^ s_controlInversionMask);
+	port.controlMirror = 0;
+	if (port.debugDelay)
+		PLATFORM_SleepMS (port.debugDelay);
+	LPT_SetControl (port.controlMirror ^ port.controlInversionMask);
 	LPT_SetData (0);
-	SleepNanoSeconds (s_txDelay);
-}
-
-static uint8 SwizzleStatus08E (uint8 status)
-{
-	// Since we reversed the bit order on the A20..A23 pins on the outrun PCB, 
-	// We should switch the corresponding status bits here.
-	//
-	// +-------------+-----------+----------------------------+----------+-------------+
-	// | Outrun PCB  | 0.8E Lite |          LPT               | Register | Nibble Mode |
-	// +-----+-------+-----------+-----+----------+-----------+----------+-------------+
-	// | A23 | Bit 0 | Inverted  | P11 | Inverted | BUSY      | Status:7 |   Bit 3/7   |
-	// | A22 | Bit 1 | Inverted  | P12 |     -    | PAPER OUT | Status:5 |   Bit 2/6   |
-	// | A21 | Bit 2 | Inverted  | P13 |     -    | SELECT    | Status:4 |   Bit 1/5   |
-	// | A20 | Bit 3 | Inverted  | P15 |     -    | nERROR    | Status:3 |   Bit 0/4   |
-	// | A19 | Bit 4 | Inverted  | P10 |     -    | nACK      | Status:6 |   PtrClk    |
-	// +-----+-------+-----------+-----+----------+-----------+----------+-------------+
-	//
-	// So, register bits 4 and 5 should be swapped, and bits 7 and 3 - they should be inverted too.
-	uint8 swizzled = (((status & 0x8)  << 4) ^ 0x80) |
-		              ((status & 0x10) << 1) | 
-					  ((status & 0x20) >> 1) |
-					   (status & 0x40) | // nACK stays.
-					 (((status & 0x80) >> 4) ^ 0x8);
-
-	return swizzled;
-}
-
-static bool WaitForStatusMask (uint32 timeOut, uint8 maskHigh, uint8 maskLow, uint8& status)
-{
-	// Wait for the BUSY line to go (or be) low.
-	uint32 timerStart = GetTickCount();
+	SleepNanoSeconds (port.txDelay);
+}
+
+// Waits for the status lines to match. Waits that can take long (the device is idle or busy) may slack off,
+// but once a transfer is going the device answers within microseconds, so we keep polling.
+static bool WaitForStatusMask (CommPort& port, CommPhase phase, uint32 timeOut, uint8 maskHigh, uint8 maskLow, uint8& status, bool bMaySlackOff = true)
+{
+	uint64 startNS = port.bTelemetry ? PLATFORM_GetTimeNS() : 0;
+	uint32 timerStart = PLATFORM_GetTickCountMS();
 	bool bSlackOff = false;
-	for (;;)
+	for (uint32 polls=1;; polls++)
 	{
-		status = SwizzleStatus08E (LPT_GetStatus());
+		status = LPT_SwizzleStatus08E (LPT_GetStatus());
 		if ((status & maskHigh) == maskHigh && 
 			(status & maskLow) == 0)
+		{
+			if (port.bTelemetry)
+				port.telemetry.phaseNS[phase].Add (PLATFORM_GetTimeNS() - startNS);
 			return true;
+		}
+
+		if (polls % kPollsPerClockCheck)
+			continue;
 
 		// If we're not in slack mode already, get the current time.
 		// Also if we have a timeout set.
 		uint32 curTime;
-		if (timeOut || !bSlackOff)
-			curTime = GetTickCount();
+		if (timeOut || (bMaySlackOff && !bSlackOff))
+			curTime = PLATFORM_GetTickCountMS();
 
-		if (timeOut && (curTime - timerStart) > s_txTimeOut)
-			return false; // Timeout.
+		if (timeOut && (curTime - timerStart) > timeOut)
+		{
+			port.telemetry.nTimeOuts++;
+			return false;
+		}
 
 		// Slack?
-		if (!bSlackOff)
+		if (!bSlackOff && bMaySlackOff)
+		{
 			bSlackOff = ((curTime - timerStart) >= kSlackOffTimeMS);
+			if (bSlackOff)
+				port.telemetry.nSlackOffs++;
+		}
 		if (bSlackOff)
-			Sleep(10);
+			PLATFORM_SleepMS (10);
 	}
 
 	return true;
@@ -127,91 +227,143 @@ static bool WaitForStatusMask (uint32 timeOut, uint8 maskHigh, uint8 maskLow, ui
 bool COMM_SendByte (uint8 data)
 {
 	// Make sure we're doing it from the same thread as we called Init() on.
-	DEBUG_ASSERT(GetCurrentThreadId() == s_commThreadID);
+	CommPort& port = GetPort ();
+	DEBUG_ASSERT(PLATFORM_GetCurrentThreadID() == port.threadID);
+	uint64 startNS = port.bTelemetry ? PLATFORM_GetTimeNS() : 0;
 
 	// Wait for BUSY to be low (indicates the hardware can receive data).
 	uint8 status;
-	if (!WaitForStatusMask (s_txTimeOut, STATUS_BUSY_i, 0, status))
+	if (!WaitForStatusMask (port, COMM_PHASE_SEND_READY, port.txTimeOut, STATUS_BUSY_i, 0, status))
 		return false;
 
 	// Device not busy - set data on the output pins.
-	if (s_debugDelay)
-		Sleep (s_debugDelay);
+	if (port.debugDelay)
+		PLATFORM_SleepMS (port.debugDelay);
 	LPT_SetData (data);
 
 	// Wait before we strobe. We have to do this or the data might be read wrong.
-	SleepNanoSeconds (s_txDelay);
+	SleepNanoSeconds (port.txDelay);
 
 	// Pull the strobe line to low.
-	if (s_debugDelay)
-		Sleep (s_debugDelay);
-	s_controlMirror |= CONTROL_nSTROBE_i;
-	LPT_SetControl (s_controlMirror ^ s_controlInversionMask);
+	if (port.debugDelay)
+		PLATFORM_SleepMS (port.debugDelay);
+	port.controlMirror |= CONTROL_nSTROBE_i;
+	LPT_SetControl (port.controlMirror ^ port.controlInversionMask);
+	uint64 strobeTime = PLATFORM_GetTimeNS();
 
 	// Wait for BUSY high.
-	if (!WaitForStatusMask (s_txTimeOut, 0, STATUS_BUSY_i, status))
+	if (!WaitForStatusMask (port, COMM_PHASE_SEND_ACK, port.txTimeOut, 0, STATUS_BUSY_i, status))
 		return false;
+	AddLatency (port, PLATFORM_GetTimeNS() - strobeTime);
 
 	// Set the strobe line back to high.
-	if (s_debugDelay)
-		Sleep (s_debugDelay);
-	s_controlMirror &= ~CONTROL_nSTROBE_i;
-	LPT_SetControl (s_controlMirror ^ s_controlInversionMask);
+	if (port.debugDelay)
+		PLATFORM_SleepMS (port.debugDelay);
+	port.controlMirror &= ~CONTROL_nSTROBE_i;
+	LPT_SetControl (port.controlMirror ^ port.controlInversionMask);
+
+	if (port.bTelemetry)
+		port.telemetry.sendByteNS.Add (PLATFORM_GetTimeNS() - startNS);
 
 	// Ignore nACK transition, since we're not sending anything back anyway.
 	return true;
 }
 
+bool COMM_SendWord (uint16 word)
+{
+	return COMM_SendByte (word >> 8) && COMM_SendByte (word & 0xff);
+}
+
+bool COMM_WaitReady ()
+{
+	CommPort& port = GetPort ();
+	DEBUG_ASSERT(PLATFORM_GetCurrentThreadID() == port.threadID);
+
+	uint8 status;
+	return WaitForStatusMask (port, COMM_PHASE_SEND_READY, port.txTimeOut, STATUS_BUSY_i, 0, status);
+}
+
 static uint8 StatusToNibble (uint8 statusByte) 
 { 
 	return ((statusByte & (STATUS_nERROR|STATUS_SELECT|STATUS_PAPEROUT)) >> 3)
 		| (((statusByte & STATUS_BUSY_i) ^ STATUS_BUSY_i) >> 4); // Busy is inverted.
 }
 
-// Reads a nibble.
-static int8 ReadNibble ()
+// One reverse handshake. Reads a nibble from the status lines.
+// Only the wait for the very first nibble of a transfer may slack off.
+static int16 ReadReverse (CommPort& port, bool bFirst)
 {
+	// Right after a byte was sent, _readchar may still be holding nACK low until it sees STROBE go high.
+	// That would look like PtrClk, so wait for it to clear first.
+	uint8 status;
+	if (bFirst && !WaitForStatusMask (port, COMM_PHASE_RECV_IDLE, port.rxTimeOut, STATUS_nACK, 0, status))
+		return -1;
+
 	// Set HostBusy (=nAUTOFEED) to low. This tells we are ready to receive a byte.
-	if (s_debugDelay)
-		Sleep (s_debugDelay);
-	s_controlMirror |= CONTROL_nAUTOFEED_i;
-	LPT_SetControl (s_controlMirror ^ s_controlInversionMask);
+	if (port.debugDelay)
+		PLATFORM_SleepMS (port.debugDelay);
+	port.controlMirror |= CONTROL_nAUTOFEED_i;
+	LPT_SetControl (port.controlMirror ^ port.controlInversionMask);
 
-	// Device will set nibble data on the status bits; then assert PtrClk (=nACK) low.
-	uint8 status;
-	if (!WaitForStatusMask (s_rxTimeOut, 0, STATUS_nACK, status))
+	// Device will set the data; then assert PtrClk (=nACK) low.
+	if (!WaitForStatusMask (port, COMM_PHASE_RECV_CLOCK, port.rxTimeOut, 0, STATUS_nACK, status, bFirst))
 		return -1;
 
-	// Wait a bit and read the status bits again, just to be sure that they weren't still being set.
-	SleepNanoSeconds (10);
-	uint8 nibbleData = StatusToNibble (SwizzleStatus08E (LPT_GetStatus()));
+	// Read the lines again, just to be sure that they weren't still being set.
+	// The device sets them well before PtrClk, so the time a port read takes is enough.
+	uint8 data = StatusToNibble (LPT_SwizzleStatus08E (LPT_GetStatus()));
 
 	// Set HostBusy (=nAUTOFEED) to high.
-	if (s_debugDelay)
-		Sleep (s_debugDelay);
-	s_controlMirror &= ~CONTROL_nAUTOFEED_i;
-	LPT_SetControl (s_controlMirror ^ s_controlInversionMask);
+	if (port.debugDelay)
+		PLATFORM_SleepMS (port.debugDelay);
+	port.controlMirror &= ~CONTROL_nAUTOFEED_i;
+	LPT_SetControl (port.controlMirror ^ port.controlInversionMask);
 
 	// Wait for PtrClk (=nACK) to go high again.
-	if (!WaitForStatusMask (s_rxTimeOut, STATUS_nACK, 0, status))
+	if (!WaitForStatusMask (port, COMM_PHASE_RECV_RELEASE, port.rxTimeOut, STATUS_nACK, 0, status, false))
 		return -1;
 
-	return nibbleData;
+	return data;
+}
+
+static int16 ReadByte (CommPort& port, bool bFirst)
+{
+	uint64 startNS = port.bTelemetry ? PLATFORM_GetTimeNS() : 0;
+	int16 byte = ReadReverse (port, bFirst);
+	if (byte != -1)
+	{
+		int16 highBits = ReadReverse (port, false);
+		byte = (highBits == -1) ? -1 : ((highBits << 4) | byte);
+	}
+
+	if (port.bTelemetry && byte != -1)
+		port.telemetry.recvByteNS.Add (PLATFORM_GetTimeNS() - startNS);
+	return byte;
 }
 
 // Reads a single byte, in two nibbles.
 int16 COMM_RecvByte ()
 {
 	// Make sure we're doing it from the same thread as we called Init() on.
-	DEBUG_ASSERT(GetCurrentThreadId() == s_commThreadID);
+	CommPort& port = GetPort ();
+	DEBUG_ASSERT(PLATFORM_GetCurrentThreadID() == port.threadID);
 
-	int8 lowBits = ReadNibble();
-	if (lowBits == -1)
-		return -1;
+	return ReadByte (port, true);
+}
 
-	int8 highBits = ReadNibble();
-	if (highBits == -1)
-		return -1;
+uint32 COMM_RecvBytes (uint8* pBuffer, uint32 nBytes)
+{
+	CommPort& port = GetPort ();
+	DEBUG_ASSERT(PLATFORM_GetCurrentThreadID() == port.threadID);
+
+	uint32 nReceived = 0;
+	while (nReceived < nBytes)
+	{
+		int16 byte = ReadByte (port, nReceived == 0);
+		if (byte == -1)
+			break;
+		pBuffer[nReceived++] = (uint8)byte;
+	}
 
-	return (((uint8)highBits) << 4) | ((uint8)lowBits);
+	return nReceived;
 }
@@ -2,17 +2,34 @@
 #define __COMM_H__
 
 #include <Platform.h>
+#include "histogram.h"
 
 // Parallel protocol based on IEEE1284.
 // Difference is that we actually wait for the transitions instead of relying on
 // adequate 500ns response time. We don't have hooked up interrupts and 10MHz is too slow.
 
-// Initializes timers. Run from the same thread as all the other calls.
-void COMM_Init ();
+class LPTBackend;
+
+// Everything the comm layer keeps for a port: the settings below, the control register mirror, statistics
+// and the port backend. The COMM_ functions work on the port selected on the calling thread, so several
+// boards can be driven at once with a thread per port. Threads that don't select one share a default port,
+// which uses the backend set with LPT_SetBackend.
+struct CommPort;
+
+// Creates a port on the given backend, with the settings of the port selected on the calling thread.
+// Ownership of the backend stays with the caller.
+CommPort* COMM_CreatePort (LPTBackend* pBackend);
+void COMM_DestroyPort (CommPort* pPort);
+
+// Selects the port (NULL for the default port) for the calling thread, pins the thread to a CPU, so our busy
+// waits aren't disturbed by migrations, and initializes timers. All other calls on the port have to come from
+// this thread. Give every port thread a CPU of its own when there are enough.
+void COMM_Init (CommPort* pPort = NULL, uint32 cpu = 0);
 
 // Set the transition delay. Default is 50ms to be safe. 35ms is about the minimum transition time
 // for the TLP521 optocouplers used on the Outrun board.
 void COMM_SetTXDelayNS (uint64 nanoseconds);
+uint64 COMM_GetTXDelayNS ();
 
 // Sets a debug delay for all output transitions. Zero (default) means no delay.
 void COMM_SetDebugDelayMS (uint32 milliseconds);
@@ -26,6 +43,7 @@ void COMM_Reset ();
 // Sets the response timeout. Set to zero for no timeout.
 void COMM_SetRXTimeOutMS (uint32 milliseconds);
 void COMM_SetTXTimeOutMS (uint32 milliseconds);
+uint32 COMM_GetRXTimeOutMS ();
 
 // Sets an inversion mask for the control register. Default is zero (normal behavior).
 void COMM_SetControlInversionMask (uint8 mask);
@@ -34,8 +52,58 @@ void COMM_SetControlInversionMask (uint8 mask);
 // Returns false if the send times out.
 bool COMM_SendByte (uint8 byte);
 
+// Sends a 16 bit value in high-low (bigendian) order.
+bool COMM_SendWord (uint16 word);
+
+// Waits until the device can take the next byte (BUSY low), which is how the bootloader tells that a command
+// without a reply is done. Returns false if that takes longer than the TX timeout.
+bool COMM_WaitReady ();
+
 // Reads a single byte in 'nibble' mode.
 // Returns -1 if the receive times out.
 int16 COMM_RecvByte ();
 
+// Reads up to nBytes in one go. Only the wait for the first byte is allowed to slack off, so use this
+// when the device sends several bytes back to back.
+// Returns the number of bytes received, which is less than nBytes if the receive times out.
+uint32 COMM_RecvBytes (uint8* pBuffer, uint32 nBytes);
+
+// Round trip statistics for COMM_SendByte: the time between pulling STROBE low and seeing BUSY go high.
+// This is mostly the response time of the optocouplers plus the bootloader's polling loop.
+struct CommLatencyStats
+{
+	uint32 count;
+	uint64 minNS;
+	uint64 maxNS;
+	uint64 totalNS;
+};
+
+void COMM_ResetLatencyStats ();
+const CommLatencyStats& COMM_GetLatencyStats ();
+
+// Detailed timing of every handshake, for -stats. Off by default, since it reads the clock around every wait.
+// Slack-offs and timeouts are always counted.
+enum CommPhase
+{
+	COMM_PHASE_SEND_READY,   // Waiting for BUSY low, before sending a byte.
+	COMM_PHASE_SEND_ACK,     // Waiting for BUSY high, after pulling STROBE low.
+	COMM_PHASE_RECV_IDLE,    // Waiting for nACK to be released, before reading a reply.
+	COMM_PHASE_RECV_CLOCK,   // Waiting for PtrClk low, after asserting HostBusy.
+	COMM_PHASE_RECV_RELEASE, // Waiting for PtrClk high, after releasing HostBusy.
+	COMM_NUM_PHASES,
+};
+
+struct CommTelemetry
+{
+	Histogram phaseNS[COMM_NUM_PHASES];
+	Histogram sendByteNS;    // All of COMM_SendByte, including the TX delay.
+	Histogram recvByteNS;    // Both nibbles of a received byte.
+	uint32 nSlackOffs;       // Waits that took long enough to start sleeping in between polls.
+	uint32 nTimeOuts;
+};
+
+void COMM_EnableTelemetry (bool bEnable);
+void COMM_ResetTelemetry ();
+const CommTelemetry& COMM_GetTelemetry ();
+
 #endif // __COMM_H__
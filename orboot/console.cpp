@@ -0,0 +1,252 @@
+#include <Platform.h>
+#include <stdio.h>
+#include <string.h>
+#include "spscqueue.h"
+#include "console.h"
+
+static const uint32 kQueueSize = 256;
+static const uint16 kChannelText = 0x100; // Bytes outside records, for stdout.
+static const uint32 kNumChannels = 256;
+
+struct ConsoleRecord
+{
+	uint16 channel;
+	uint16 frame;
+	uint32 nBytes;
+	uint8 data[255];
+};
+
+struct ConsoleLog
+{
+	const char* prefix;
+	SPSCQueue<ConsoleRecord, kQueueSize> queue;
+	PlatformThread* pWriter;
+	volatile bool bStop;
+
+	// Writer thread only.
+	FILE* pFiles[kNumChannels];
+	bool bOpenFailed[kNumChannels];
+
+	// Decoder state, comm thread only.
+	uint8 header[kConsoleHeaderSize];
+	uint32 nHeaderBytes;
+	bool bInPayload;
+	ConsoleRecord record;
+	ConsoleRecord text;
+};
+
+static void PushRecord (ConsoleLog& log, const ConsoleRecord& record)
+{
+	// The port is a lot slower than the disk, so this only waits when the disk stalls.
+	while (!log.queue.Push (record))
+		PLATFORM_SleepMS (1);
+}
+
+static void FlushText (ConsoleLog& log)
+{
+	if (!log.text.nBytes)
+		return;
+	PushRecord (log, log.text);
+	log.text.nBytes = 0;
+}
+
+static void AddText (ConsoleLog& log, uint8 byte)
+{
+	log.text.data[log.text.nBytes++] = byte;
+	if (log.text.nBytes == sizeof (log.text.data))
+		FlushText (log);
+}
+
+static void DecodeByte (ConsoleLog& log, uint8 byte)
+{
+	if (log.bInPayload)
+	{
+		log.record.data[log.record.nBytes++] = byte;
+		if (log.record.nBytes == log.header[4])
+		{
+			PushRecord (log, log.record);
+			log.bInPayload = false;
+		}
+		return;
+	}
+
+	if (log.nHeaderBytes == 0 && byte != kConsoleRecordSync)
+	{
+		AddText (log, byte);
+		return;
+	}
+
+	log.header[log.nHeaderBytes++] = byte;
+	if (log.nHeaderBytes < kConsoleHeaderSize)
+		return;
+	log.nHeaderBytes = 0;
+
+	uint8 header[kConsoleHeaderSize];
+	memcpy (header, log.header, sizeof (header));
+	if ((header[1] ^ header[2] ^ header[3] ^ header[4]) == header[5])
+	{
+		// Keep the text and the records in order.
+		FlushText (log);
+		log.record.channel = header[1];
+		log.record.frame = (uint16)((header[2] << 8) | header[3]);
+		log.record.nBytes = 0;
+		if (header[4])
+			log.bInPayload = true;
+		else
+			PushRecord (log, log.record);
+		return;
+	}
+
+	// Not a record after all. Print the sync byte and look for a record in the rest.
+	AddText (log, header[0]);
+	for (uint32 i=1; i<kConsoleHeaderSize; i++)
+		DecodeByte (log, header[i]);
+}
+
+static bool IsText (const uint8* pData, uint32 nBytes)
+{
+	for (uint32 i=0; i<nBytes; i++)
+		if ((pData[i] < 0x20 || pData[i] > 0x7e) && pData[i] != '\t' && pData[i] != '\r' && pData[i] != '\n')
+			return false;
+	return true;
+}
+
+static void WriteRecord (ConsoleLog& log, const ConsoleRecord& record)
+{
+	if (record.channel == kChannelText)
+	{
+		fwrite (record.data, 1, record.nBytes, stdout);
+		return;
+	}
+
+	if (record.channel == kConsoleChannelDropped)
+	{
+		uint32 nDropped = record.nBytes == 2 ? ((record.data[0] << 8) | record.data[1]) : 0;
+		printf ("\n[Frame %u: %u log record(s) dropped, the log buffer was full.]\n", record.frame, nDropped);
+		return;
+	}
+
+	FILE*& pFile = log.pFiles[record.channel];
+	if (!pFile)
+	{
+		if (log.bOpenFailed[record.channel])
+			return;
+
+		char fileName[1024];
+		snprintf (fileName, sizeof (fileName), "%s-%u.log", log.prefix, record.channel);
+		pFile = fopen (fileName, "wb");
+		if (!pFile)
+		{
+			printf ("\n[Couldn't create %s, dropping channel %u.]\n", fileName, record.channel);
+			log.bOpenFailed[record.channel] = true;
+			return;
+		}
+	}
+
+	fprintf (pFile, "%5u ", record.frame);
+	if (IsText (record.data, record.nBytes))
+	{
+		uint32 nBytes = record.nBytes;
+		while (nBytes && (record.data[nBytes-1] == '\n' || record.data[nBytes-1] == '\r'))
+			nBytes--;
+		fwrite (record.data, 1, nBytes, pFile);
+	}
+	else
+	{
+		for (uint32 i=0; i<record.nBytes; i++)
+			fprintf (pFile, i ? " %02x" : "%02x", record.data[i]);
+	}
+	fputc ('\n', pFile);
+}
+
+static void FlushFiles (ConsoleLog& log)
+{
+	fflush (stdout);
+	for (uint32 i=0; i<kNumChannels; i++)
+		if (log.pFiles[i])
+			fflush (log.pFiles[i]);
+}
+
+static void WriterThread (void* pParam)
+{
+	ConsoleLog& log = *(ConsoleLog*)pParam;
+	bool bDirty = false;
+	for (;;)
+	{
+		ConsoleRecord record;
+		if (log.queue.Pop (record))
+		{
+			WriteRecord (log, record);
+			bDirty = true;
+			continue;
+		}
+
+		// Flush whenever we catch up, so the files are current when the program is interrupted.
+		if (bDirty)
+		{
+			FlushFiles (log);
+			bDirty = false;
+		}
+
+		if (log.bStop)
+		{
+			PLATFORM_MemoryBarrier ();
+			while (log.queue.Pop (record))
+				WriteRecord (log, record);
+			FlushFiles (log);
+			break;
+		}
+
+		PLATFORM_SleepMS (1);
+	}
+}
+
+ConsoleLog* CONSOLE_StartLog (const char* prefix)
+{
+	ConsoleLog* pLog = new ConsoleLog;
+	pLog->prefix = prefix;
+	pLog->bStop = false;
+	for (uint32 i=0; i<kNumChannels; i++)
+	{
+		pLog->pFiles[i] = NULL;
+		pLog->bOpenFailed[i] = false;
+	}
+	pLog->nHeaderBytes = 0;
+	pLog->bInPayload = false;
+	pLog->text.channel = kChannelText;
+	pLog->text.frame = 0;
+	pLog->text.nBytes = 0;
+
+	pLog->pWriter = PLATFORM_StartThread (WriterThread, pLog);
+	if (!pLog->pWriter)
+	{
+		delete pLog;
+		return NULL;
+	}
+
+	return pLog;
+}
+
+void CONSOLE_Receive (ConsoleLog* pLog, const uint8* pBytes, uint32 nBytes)
+{
+	DEBUG_ASSERT(pLog);
+	for (uint32 i=0; i<nBytes; i++)
+		DecodeByte (*pLog, pBytes[i]);
+
+	// Don't hold back console output until the next record.
+	FlushText (*pLog);
+}
+
+void CONSOLE_StopLog (ConsoleLog* pLog)
+{
+	DEBUG_ASSERT(pLog);
+	FlushText (*pLog);
+	PLATFORM_MemoryBarrier ();
+	pLog->bStop = true;
+	PLATFORM_JoinThread (pLog->pWriter);
+
+	for (uint32 i=0; i<kNumChannels; i++)
+		if (pLog->pFiles[i])
+			fclose (pLog->pFiles[i]);
+	delete pLog;
+}
@@ -0,0 +1,27 @@
+#ifndef __CONSOLE_H__
+#define __CONSOLE_H__
+
+#include <Platform.h>
+
+// Structured console output, as written by the LOG_ functions in the SDK (sdk/include/cpu0/log.h).
+// Records are decoded on the comm thread and handed to a writer thread through a lock-free queue,
+// so slow disks never hold up the port. Every channel gets its own file, <prefix>-<channel>.log,
+// with one line per record, prefixed with the frame number. Bytes outside records are printed to
+// stdout, like plain console output.
+
+static const uint8 kConsoleRecordSync = 0xA5;
+static const uint32 kConsoleHeaderSize = 6;
+static const uint8 kConsoleChannelDropped = 0xFF;
+
+struct ConsoleLog;
+
+// Starts the writer thread. Returns NULL if it can't be started.
+ConsoleLog* CONSOLE_StartLog (const char* prefix);
+
+// Decodes received bytes. Call from the comm thread. Waits when the writer falls far behind.
+void CONSOLE_Receive (ConsoleLog* pLog, const uint8* pBytes, uint32 nBytes);
+
+// Writes everything that was decoded, stops the writer thread and closes the files.
+void CONSOLE_StopLog (ConsoleLog* pLog);
+
+#endif // __CONSOLE_H__
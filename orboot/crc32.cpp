@@ -0,0 +1,29 @@
+#include <Platform.h>
+#include "crc32.h"
+
+static uint32 s_crcTable[256];
+
+static bool BuildCrcTable ()
+{
+	for (uint32 n=0; n<256; n++)
+	{
+		uint32 c = n;
+		for (uint32 k=0; k<8; k++)
+			c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+		s_crcTable[n] = c;
+	}
+	return true;
+}
+
+// Built before main() runs.
+static bool s_crcTableBuilt = BuildCrcTable ();
+
+uint32 CRC32_Calc (const void* pData, uint32 nBytes, uint32 crc)
+{
+	DEBUG_ASSERT(s_crcTableBuilt);
+	const uint8* pByteData = (const uint8*)pData;
+	crc ^= 0xffffffff;
+	while (nBytes--)
+		crc = s_crcTable[(crc ^ *pByteData++) & 0xff] ^ (crc >> 8);
+	return crc ^ 0xffffffff;
+}
@@ -0,0 +1,10 @@
+#ifndef __CRC32_H__
+#define __CRC32_H__
+
+#include <Platform.h>
+
+// CRC-32 with the 0xedb88320 polynomial; the same one used by zip, the memtest sample and the bootloader.
+// Pass a previous result as 'crc' to continue a checksum over several buffers.
+uint32 CRC32_Calc (const void* pData, uint32 nBytes, uint32 crc = 0);
+
+#endif // __CRC32_H__
@@ -0,0 +1,87 @@
+#include <Platform.h>
+#include "bootcmd.h"
+#include "crc32.h"
+#include "delta.h"
+
+// Every block costs a command byte, a 6 byte header and a 4 byte CRC, plus two replies.
+// Unchanged gaps smaller than that are cheaper to send along.
+static const uint32 kMinGapBytes = 16;
+
+// When ram doesn't match in the end, we check it in chunks of this size and resend the ones that differ.
+static const uint32 kRepairChunkSize = 1024;
+
+static bool UploadRange (uint8 target, const uint8* pData, uint32 rangeOffset, uint32 rangeBytes, uint32& nRetries, uint32& nSentBytes)
+{
+	for (uint32 offset=0; offset<rangeBytes; offset+=kBlockSize)
+	{
+		uint32 blockSize = rangeBytes - offset;
+		if (blockSize > kBlockSize)
+			blockSize = kBlockSize;
+
+		uint32 blockOffset = rangeOffset + offset;
+		if (!UploadBlock (target, (uint16)blockOffset, pData + blockOffset, (uint16)blockSize, nRetries, kMaxBlockRetries))
+			return false;
+		nSentBytes += blockSize;
+	}
+
+	return true;
+}
+
+void DELTA_FindChangedRanges (const uint8* pOld, uint32 nOldBytes, const uint8* pNew, uint32 nNewBytes, std::vector<DeltaRange>& ranges)
+{
+	ranges.clear();
+	uint32 nCompare = nOldBytes < nNewBytes ? nOldBytes : nNewBytes;
+	uint32 pos = 0;
+	while (pos < nNewBytes)
+	{
+		// Skip over what's the same.
+		while (pos < nCompare && pOld[pos] == pNew[pos])
+			pos++;
+		if (pos == nNewBytes)
+			break;
+
+		// Find the end of the change, allowing for small gaps.
+		uint32 start = pos;
+		uint32 end = pos + 1;
+		for (pos=end; pos<nNewBytes && pos-end<kMinGapBytes; pos++)
+		{
+			if (pos >= nCompare || pOld[pos] != pNew[pos])
+				end = pos + 1;
+		}
+		pos = end;
+
+		DeltaRange range = { start, end - start };
+		ranges.push_back (range);
+	}
+}
+
+DeltaResult DELTA_CheckAndRepair (uint8 target, const uint8* pData, uint32 nBytes, uint32& nRetries, uint32& nSentBytes)
+{
+	DEBUG_ASSERT(nBytes && nBytes <= 32768);
+	const uint32 crc = CRC32_Calc (pData, nBytes);
+	uint32 ramCrc;
+	if (!CheckRange (target, 0, (uint16)nBytes, ramCrc))
+		return DELTA_TIMEDOUT;
+	if (ramCrc == crc)
+		return DELTA_UPLOADED;
+
+	// The program that ran last probably changed its data. That's usually a small part of the image,
+	// so look for it instead of sending everything.
+	for (uint32 offset=0; offset<nBytes; offset+=kRepairChunkSize)
+	{
+		uint32 chunkSize = nBytes - offset;
+		if (chunkSize > kRepairChunkSize)
+			chunkSize = kRepairChunkSize;
+
+		uint32 chunkCrc;
+		if (!CheckRange (target, (uint16)offset, (uint16)chunkSize, chunkCrc))
+			return DELTA_TIMEDOUT;
+		if (chunkCrc != CRC32_Calc (pData + offset, chunkSize) &&
+			!UploadRange (target, pData, offset, chunkSize, nRetries, nSentBytes))
+			return DELTA_TIMEDOUT;
+	}
+
+	if (!CheckRange (target, 0, (uint16)nBytes, ramCrc))
+		return DELTA_TIMEDOUT;
+	return ramCrc == crc ? DELTA_UPLOADED : DELTA_MISMATCH;
+}
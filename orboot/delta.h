@@ -0,0 +1,32 @@
+#ifndef __DELTA_H__
+#define __DELTA_H__
+
+#include <Platform.h>
+#include <vector>
+
+// Delta uploads: only the ranges that changed since the previous upload are sent, using framed blocks.
+// Afterwards the bootloader checks the CRC of the whole image, since the program we uploaded last time
+// may have changed ram after it was started. If it doesn't match, the image is checked and repaired in chunks.
+
+struct DeltaRange
+{
+	uint32 offset;
+	uint32 nBytes;
+};
+
+// Ranges where the new image differs from the old one, including anything past the end of the old image.
+// Ranges closer together than it costs to send a block header are merged.
+void DELTA_FindChangedRanges (const uint8* pOld, uint32 nOldBytes, const uint8* pNew, uint32 nNewBytes, std::vector<DeltaRange>& ranges);
+
+enum DeltaResult
+{
+	DELTA_UPLOADED,   // Ram matches the new image.
+	DELTA_MISMATCH,   // Ram still didn't match after the repair; upload the whole image instead.
+	DELTA_TIMEDOUT,
+};
+
+// Checks the image in ram after the changed ranges were uploaded, and repairs it where needed.
+// Adds the number of bytes resent to nSentBytes.
+DeltaResult DELTA_CheckAndRepair (uint8 target, const uint8* pData, uint32 nBytes, uint32& nRetries, uint32& nSentBytes);
+
+#endif // __DELTA_H__
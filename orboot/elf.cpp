@@ -0,0 +1,139 @@
+#include <Platform.h>
+#include <algorithm>
+#include <string.h>
+#include "elf.h"
+
+// From the System V ABI. Everything is big endian on the 68000.
+static const uint32 kHeaderSize = 52;
+static const uint32 kProgramHeaderSize = 32;
+static const uint32 kSectionHeaderSize = 40;
+static const uint8  kClass32 = 1;
+static const uint8  kDataBigEndian = 2;
+static const uint16 kTypeExecutable = 2;
+static const uint16 kMachine68K = 4;
+static const uint32 kProgramLoad = 1;     // PT_LOAD
+static const uint32 kSectionNoBits = 8;   // SHT_NOBITS
+static const uint32 kSectionAlloc = 2;    // SHF_ALLOC
+
+static uint16 Read16 (const uint8* p)
+{
+	return (uint16)((p[0] << 8) | p[1]);
+}
+
+static uint32 Read32 (const uint8* p)
+{
+	return ((uint32)p[0] << 24) | ((uint32)p[1] << 16) | ((uint32)p[2] << 8) | p[3];
+}
+
+// Whether offset..offset+nBytes-1 lies within the file.
+static bool InFile (uint32 fileBytes, uint32 offset, uint32 nBytes)
+{
+	return offset <= fileBytes && nBytes <= fileBytes - offset;
+}
+
+static bool SectionBefore (const ElfSection& a, const ElfSection& b)
+{
+	return a.address < b.address;
+}
+
+bool ELF_IsELF (const uint8* pData, uint32 nBytes)
+{
+	return nBytes >= 4 && memcmp (pData, "\x7f" "ELF", 4) == 0;
+}
+
+bool ELF_Parse (const uint8* pData, uint32 nBytes, ElfImage& image, const char*& pReason)
+{
+	image.segments.clear ();
+	image.sections.clear ();
+
+	if (!ELF_IsELF (pData, nBytes) || nBytes < kHeaderSize)
+	{
+		pReason = "not an ELF file";
+		return false;
+	}
+	if (pData[4] != kClass32 || pData[5] != kDataBigEndian || Read16 (pData + 18) != kMachine68K)
+	{
+		pReason = "not linked for the 68000";
+		return false;
+	}
+	if (Read16 (pData + 16) != kTypeExecutable)
+	{
+		pReason = "not an executable";
+		return false;
+	}
+
+	image.entry = Read32 (pData + 24);
+	uint32 programOffset = Read32 (pData + 28);
+	uint32 sectionOffset = Read32 (pData + 32);
+	uint16 programEntrySize = Read16 (pData + 42);
+	uint16 nProgramHeaders = Read16 (pData + 44);
+	uint16 sectionEntrySize = Read16 (pData + 46);
+	uint16 nSectionHeaders = Read16 (pData + 48);
+	uint16 nameSection = Read16 (pData + 50);
+
+	if (!nProgramHeaders || programEntrySize < kProgramHeaderSize || !InFile (nBytes, programOffset, nProgramHeaders * programEntrySize))
+	{
+		pReason = "the program headers are missing or damaged";
+		return false;
+	}
+
+	for (uint32 i=0; i<nProgramHeaders; i++)
+	{
+		const uint8* pHeader = pData + programOffset + i * programEntrySize;
+		if (Read32 (pHeader) != kProgramLoad)
+			continue;
+
+		uint32 fileOffset = Read32 (pHeader + 4);
+		ElfSegment segment;
+		segment.address = Read32 (pHeader + 12);
+		segment.nFileBytes = Read32 (pHeader + 16);
+		segment.nMemBytes = Read32 (pHeader + 20);
+		segment.pData = pData + fileOffset;
+		if (segment.nFileBytes > segment.nMemBytes || !InFile (nBytes, fileOffset, segment.nFileBytes) || segment.address + segment.nMemBytes < segment.address)
+		{
+			pReason = "a program header is damaged";
+			return false;
+		}
+
+		if (segment.nMemBytes)
+			image.segments.push_back (segment);
+	}
+
+	if (image.segments.empty ())
+	{
+		pReason = "there is nothing to load";
+		return false;
+	}
+
+	// Sections are only for the layout, so a stripped file is fine.
+	if (!nSectionHeaders || sectionEntrySize < kSectionHeaderSize || nameSection >= nSectionHeaders || !InFile (nBytes, sectionOffset, nSectionHeaders * sectionEntrySize))
+		return true;
+
+	const uint8* pNames = pData + sectionOffset + nameSection * sectionEntrySize;
+	uint32 namesOffset = Read32 (pNames + 16);
+	uint32 namesBytes = Read32 (pNames + 20);
+	if (!InFile (nBytes, namesOffset, namesBytes))
+		namesBytes = 0;
+
+	for (uint32 i=0; i<nSectionHeaders; i++)
+	{
+		const uint8* pHeader = pData + sectionOffset + i * sectionEntrySize;
+		ElfSection section;
+		section.address = Read32 (pHeader + 12);
+		section.nBytes = Read32 (pHeader + 20);
+		section.bLoaded = Read32 (pHeader + 4) != kSectionNoBits;
+		if (!(Read32 (pHeader + 8) & kSectionAlloc) || !section.nBytes)
+			continue;
+
+		uint32 nameOffset = Read32 (pHeader);
+		if (nameOffset < namesBytes)
+		{
+			const char* pName = (const char*)pData + namesOffset + nameOffset;
+			section.name.assign (pName, strnlen (pName, namesBytes - nameOffset));
+		}
+		image.sections.push_back (section);
+	}
+
+	std::stable_sort (image.sections.begin (), image.sections.end (), SectionBefore);
+	return true;
+}
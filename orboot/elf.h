@@ -0,0 +1,43 @@
+#ifndef __ELF_H__
+#define __ELF_H__
+
+#include <Platform.h>
+#include <string>
+#include <vector>
+
+// Executables as linked by the samples (see sdk/ldscript), in ELF format instead of a flat binary:
+// 32 bit, big endian, 68000. Only what's needed to load them is looked at: the program headers that say
+// what goes where (PT_LOAD), the entry point, and the allocated sections, for the layout.
+
+// A PT_LOAD program header. Memory past the file contents, up to nMemBytes, is zero (.bss).
+struct ElfSegment
+{
+	uint32 address;      // Physical (load) address.
+	const uint8* pData;  // Points into the file.
+	uint32 nFileBytes;
+	uint32 nMemBytes;
+};
+
+struct ElfSection
+{
+	std::string name;
+	uint32 address;
+	uint32 nBytes;
+	bool bLoaded;        // False for sections that are only zeroed, like .bss.
+};
+
+struct ElfImage
+{
+	uint32 entry;
+	std::vector<ElfSegment> segments;  // Empty ones are left out.
+	std::vector<ElfSection> sections;  // Allocated, non-empty sections only, in address order.
+};
+
+// Whether the data starts with the ELF magic.
+bool ELF_IsELF (const uint8* pData, uint32 nBytes);
+
+// Parses an executable. The segments point into pData, so keep that around while the image is used.
+// Returns false when it's not a 68000 executable or it's damaged, with the reason in pReason.
+bool ELF_Parse (const uint8* pData, uint32 nBytes, ElfImage& image, const char*& pReason);
+
+#endif // __ELF_H__
@@ -0,0 +1,82 @@
+#include <Platform.h>
+#include <string.h>
+#include "histogram.h"
+
+void Histogram::Reset ()
+{
+	m_count = 0;
+	m_min = 0;
+	m_max = 0;
+	m_total = 0;
+	memset (m_buckets, 0, sizeof (m_buckets));
+}
+
+// Values below 4 get a bucket each. Above that, the top three bits pick the bucket:
+// the position of the highest bit, and the two bits below it.
+uint32 Histogram::GetBucket (uint64 value)
+{
+	if (value < 4)
+		return (uint32)value;
+
+	uint32 msb = 63;
+	while (!(value & (1ull << msb)))
+		msb--;
+	return msb * 4 + (uint32)((value >> (msb - 2)) & 3) - 4;
+}
+
+uint64 Histogram::GetBucketMin (uint32 bucket)
+{
+	if (bucket < 4)
+		return bucket;
+
+	uint32 msb = bucket / 4 + 1;
+	return (uint64)(4 + bucket % 4) << (msb - 2);
+}
+
+uint64 Histogram::GetBucketMax (uint32 bucket)
+{
+	if (bucket < 4)
+		return bucket;
+	if (bucket == kNumBuckets - 1)
+		return ~0ull;
+
+	return GetBucketMin (bucket + 1) - 1;
+}
+
+void Histogram::Add (uint64 value)
+{
+	if (!m_count || value < m_min)
+		m_min = value;
+	if (value > m_max)
+		m_max = value;
+	m_total += value;
+	m_count++;
+	m_buckets[GetBucket (value)]++;
+}
+
+uint64 Histogram::GetPercentile (double percentile) const
+{
+	if (!m_count)
+		return 0;
+
+	// Smallest bucket that holds at least the requested share of the values.
+	uint64 needed = (uint64)(percentile / 100.0 * m_count + 0.5);
+	if (needed < 1)
+		needed = 1;
+	uint64 seen = 0;
+	for (uint32 i=0; i<kNumBuckets; i++)
+	{
+		seen += m_buckets[i];
+		if (seen >= needed)
+		{
+			uint64 value = GetBucketMax (i);
+			if (value > m_max)
+				value = m_max;
+			if (value < m_min)
+				value = m_min;
+			return value;
+		}
+	}
+
+	return m_max;
+}
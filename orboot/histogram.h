@@ -0,0 +1,43 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <Platform.h>
+
+// Log scale histogram for durations or other positive values. Every power of two is split into four
+// buckets, so percentiles are accurate to within 25%, while adding a value stays cheap enough for the
+// comm loops. The exact minimum, maximum and total are kept on the side.
+class Histogram
+{
+public:
+	enum { kNumBuckets = 252 };
+
+	Histogram () { Reset (); }
+
+	void Reset ();
+	void Add (uint64 value);
+
+	uint32 GetCount () const { return m_count; }
+	uint64 GetMin () const { return m_min; }
+	uint64 GetMax () const { return m_max; }
+	uint64 GetTotal () const { return m_total; }
+	uint64 GetMean () const { return m_count ? m_total / m_count : 0; }
+
+	// Upper bound of the bucket holding the given percentile (0..100), clamped to the maximum.
+	uint64 GetPercentile (double percentile) const;
+
+	// Range of values in a bucket, and the number of values that fell into it.
+	static uint64 GetBucketMin (uint32 bucket);
+	static uint64 GetBucketMax (uint32 bucket);
+	uint32 GetBucketCount (uint32 bucket) const { return m_buckets[bucket]; }
+
+private:
+	static uint32 GetBucket (uint64 value);
+
+	uint32 m_count;
+	uint64 m_min;
+	uint64 m_max;
+	uint64 m_total;
+	uint32 m_buckets[kNumBuckets];
+};
+
+#endif // __HISTOGRAM_H__
@@ -1,40 +1,64 @@
 #include <Platform.h>
 #include "lpt.h"
-#include "inpout32.h"
-#pragma comment(lib, "inpout32.lib")
 
-// Register offsets.
-enum
-{
-	REG_DATA    = 0,
-	REG_STATUS  = 1,
-	REG_CONTROL = 2,
-};
+// Selected backend, per thread.
+static PLATFORM_THREAD_LOCAL LPTBackend* s_pBackend = NULL;
 
-// Base port.
-uint32 s_portBase = 0x378;
+void LPT_SetBackend (LPTBackend* pBackend)
+{
+	s_pBackend = pBackend;
+}
 
-void LPT_SetBasePort (uint32 port)
+LPTBackend* LPT_GetBackend ()
 {
-	s_portBase = port;
+	return s_pBackend;
 }
 
 void LPT_SetData (uint8 dataBits)
 {
-	Out32 (s_portBase+REG_DATA, (short)dataBits);
+	DEBUG_ASSERT(s_pBackend);
+	s_pBackend->SetData (dataBits);
 }
 
 void LPT_SetControl (uint8 controlBits)
 {
-	Out32 (s_portBase+REG_CONTROL, (controlBits & 0xf));
+	DEBUG_ASSERT(s_pBackend);
+	s_pBackend->SetControl (controlBits & 0xf);
 }
 
 uint8 LPT_GetControl ()
 {
-	return (Inp32 (s_portBase+REG_CONTROL) & 0xf);
+	DEBUG_ASSERT(s_pBackend);
+	return (s_pBackend->GetControl () & 0xf);
 }
 
 uint8 LPT_GetStatus ()
 {
-	return ((uint8)Inp32(s_portBase+REG_STATUS)) & 0xF8; // Ignore the 3 unused bits.
+	DEBUG_ASSERT(s_pBackend);
+	return s_pBackend->GetStatus () & 0xF8; // Ignore the 3 unused bits.
+}
+
+uint8 LPT_SwizzleStatus08E (uint8 status)
+{
+	// Since we reversed the bit order on the A20..A23 pins on the outrun PCB, 
+	// We should switch the corresponding status bits here.
+	//
+	// +-------------+-----------+----------------------------+----------+-------------+
+	// | Outrun PCB  | 0.8E Lite |          LPT               | Register | Nibble Mode |
+	// +-----+-------+-----------+-----+----------+-----------+----------+-------------+
+	// | A23 | Bit 0 | Inverted  | P11 | Inverted | BUSY      | Status:7 |   Bit 3/7   |
+	// | A22 | Bit 1 | Inverted  | P12 |     -    | PAPER OUT | Status:5 |   Bit 2/6   |
+	// | A21 | Bit 2 | Inverted  | P13 |     -    | SELECT    | Status:4 |   Bit 1/5   |
+	// | A20 | Bit 3 | Inverted  | P15 |     -    | nERROR    | Status:3 |   Bit 0/4   |
+	// | A19 | Bit 4 | Inverted  | P10 |     -    | nACK      | Status:6 |   PtrClk    |
+	// +-----+-------+-----------+-----+----------+-----------+----------+-------------+
+	//
+	// So, register bits 4 and 5 should be swapped, and bits 7 and 3 - they should be inverted too.
+	uint8 swizzled = (((status & 0x8)  << 4) ^ 0x80) |
+		              ((status & 0x10) << 1) | 
+					  ((status & 0x20) >> 1) |
+					   (status & 0x40) | // nACK stays.
+					 (((status & 0x80) >> 4) ^ 0x8);
+
+	return swizzled;
 }
@@ -4,7 +4,8 @@
 #include <Platform.h>
 
 // Basic functionality to bitwise control the LPT port.
-// Uses inpout32.
+// The actual port access goes through a backend: inpout32 on Windows, ppdev on Linux,
+// or an in-process fake or simulator that don't need any hardware.
 //
 // +-------------+--------------+------+-----+---------+---------+
 // | Name        | Register:Bit | Pins | Dir | Wr. Inv | Rd. Inv |
@@ -36,9 +37,6 @@
 // Not inverted means setting a bit to 1 means TTL high on the output.
 //
 
-// Sets the base port address. Default is 0x378 (LPT1).
-void LPT_SetBasePort (uint32 port);
-
 // Status bits.
 enum
 {
@@ -70,4 +68,44 @@ uint8 LPT_GetControl ();
 // Sets the data bits.
 void LPT_SetData (uint8 dataBits);
 
+// Converts between the status register and the status lines as wired on the 0.8E PC interface.
+// The mapping is its own inverse, so it also converts the other way around.
+uint8 LPT_SwizzleStatus08E (uint8 status);
+
+// Port access backend. All of the register functions above go through the selected backend.
+class LPTBackend
+{
+public:
+	virtual ~LPTBackend () {}
+
+	virtual const char* GetName () const = 0;
+
+	virtual uint8 GetStatus () = 0;
+	virtual void  SetControl (uint8 controlBits) = 0;
+	virtual uint8 GetControl () = 0;
+	virtual void  SetData (uint8 dataBits) = 0;
+};
+
+// Selects the backend used by the LPT_ functions on the calling thread, so every port can have a thread of
+// its own (see COMM_Init). Ownership stays with the caller.
+void LPT_SetBackend (LPTBackend* pBackend);
+LPTBackend* LPT_GetBackend ();
+
+// Direct port I/O through inpout32.dll, at the given base port (0x378 for LPT1). Windows only.
+LPTBackend* LPT_CreateInpOut32Backend (uint32 basePort);
+
+// Linux parallel port device (/dev/parportN) through the ppdev ioctls. Claims the port exclusively.
+// Returns NULL if the device can't be opened or claimed. Linux only.
+LPTBackend* LPT_CreatePPDevBackend (const char* device);
+
+// In-process fake device. It acknowledges every strobe right away and records the data bytes,
+// and answers nibble mode reads from a queue. Useful to exercise the comm layer without hardware.
+class LPTFakeBackend;
+LPTFakeBackend* LPT_CreateFakeBackend ();
+
+// In-process simulation of the bootloader, running in real time on a simulated 68000 (see lpt_sim.h).
+// Options are timing overrides for LPT_ParseSimTiming, or NULL for the defaults. Returns NULL on bad options.
+class LPTSimBackend;
+LPTSimBackend* LPT_CreateSimBackend (const char* options);
+
 #endif // LPT_H__
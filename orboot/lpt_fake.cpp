@@ -0,0 +1,50 @@
+#include <Platform.h>
+#include "lpt_fake.h"
+
+// Device side output bits, see boot.s.
+enum
+{
+	OUT_BUSY = 0x08,
+	OUT_nACK = 0x10,
+	OUT_IDLE = 0x90, // Ready to receive: BUSY low, nACK high.
+};
+
+LPTFakeBackend* LPT_CreateFakeBackend ()
+{
+	return new LPTFakeBackend ();
+}
+
+LPTFakeBackend::LPTFakeBackend ()
+	: m_control (CONTROL_nAUTOFEED_i) // HostBusy released, as seen through the PCB inversion.
+	, m_digitalOut (OUT_IDLE)
+{
+}
+
+uint8 LPTFakeBackend::GetStatus ()
+{
+	// BUSY is inverted by the status register.
+	uint8 swizzled = ((m_digitalOut & OUT_nACK) ? STATUS_nACK : 0) |
+	                 ((m_digitalOut & OUT_BUSY) ? 0 : STATUS_BUSY_i);
+	return LPT_SwizzleStatus08E (swizzled);
+}
+
+void LPTFakeBackend::SetControl (uint8 controlBits)
+{
+	m_control = controlBits & 0xf;
+
+	// nSTROBE is inverted by the control register. The byte is taken when STROBE is released.
+	if (m_control & CONTROL_nSTROBE_i)
+		m_digitalOut |= OUT_BUSY;
+	else
+		m_digitalOut = OUT_IDLE;
+}
+
+uint8 LPTFakeBackend::GetControl ()
+{
+	return m_control;
+}
+
+// Nothing looks at the bytes.
+void LPTFakeBackend::SetData (uint8)
+{
+}
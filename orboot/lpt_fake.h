@@ -0,0 +1,28 @@
+#ifndef __LPT_FAKE_H__
+#define __LPT_FAKE_H__
+
+#include <Platform.h>
+#include "lpt.h"
+
+// In-process fake device, see LPT_CreateFakeBackend.
+// It reacts instantly to every register write and does the compatibility mode handshake of the 0.8E
+// interface: BUSY goes high while STROBE is low. It takes every byte and never replies, so it only
+// exercises the send path; use the sim backend for a device that runs the protocol.
+class LPTFakeBackend : public LPTBackend
+{
+public:
+	LPTFakeBackend ();
+
+	virtual const char* GetName () const { return "fake"; }
+
+	virtual uint8 GetStatus ();
+	virtual void  SetControl (uint8 controlBits);
+	virtual uint8 GetControl ();
+	virtual void  SetData (uint8 dataBits);
+
+private:
+	uint8 m_control;
+	uint8 m_digitalOut;   // Device side output lines, as written by the bootloader to IO_DIGITAL_OUT.
+};
+
+#endif // __LPT_FAKE_H__
@@ -0,0 +1,45 @@
+#include <Platform.h>
+#include "lpt.h"
+
+#ifdef _WIN32
+
+#include "inpout32.h"
+#pragma comment(lib, "inpout32.lib")
+
+// Register offsets.
+enum
+{
+	REG_DATA    = 0,
+	REG_STATUS  = 1,
+	REG_CONTROL = 2,
+};
+
+class LPTInpOut32Backend : public LPTBackend
+{
+public:
+	LPTInpOut32Backend (uint32 basePort) : m_portBase (basePort) {}
+
+	virtual const char* GetName () const { return "inpout32"; }
+
+	virtual uint8 GetStatus ()                { return (uint8)Inp32 ((short)(m_portBase+REG_STATUS)); }
+	virtual void  SetControl (uint8 controlBits) { Out32 ((short)(m_portBase+REG_CONTROL), (short)controlBits); }
+	virtual uint8 GetControl ()               { return (uint8)Inp32 ((short)(m_portBase+REG_CONTROL)); }
+	virtual void  SetData (uint8 dataBits)    { Out32 ((short)(m_portBase+REG_DATA), (short)dataBits); }
+
+private:
+	uint32 m_portBase;
+};
+
+LPTBackend* LPT_CreateInpOut32Backend (uint32 basePort)
+{
+	return new LPTInpOut32Backend (basePort);
+}
+
+#else // _WIN32
+
+LPTBackend* LPT_CreateInpOut32Backend (uint32)
+{
+	return NULL;
+}
+
+#endif // _WIN32
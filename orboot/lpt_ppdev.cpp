@@ -0,0 +1,82 @@
+#include <Platform.h>
+#include "lpt.h"
+
+#ifdef __linux__
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/ppdev.h>
+#include <linux/parport.h>
+
+// The ppdev register ioctls take and return the raw register values, just like inpout32 does.
+class LPTPPDevBackend : public LPTBackend
+{
+public:
+	LPTPPDevBackend (int fd) : m_fd (fd) {}
+
+	virtual ~LPTPPDevBackend ()
+	{
+		ioctl (m_fd, PPRELEASE);
+		close (m_fd);
+	}
+
+	virtual const char* GetName () const { return "ppdev"; }
+
+	virtual uint8 GetStatus ()
+	{
+		unsigned char status = 0;
+		ioctl (m_fd, PPRSTATUS, &status);
+		return status;
+	}
+
+	virtual void SetControl (uint8 controlBits)
+	{
+		unsigned char control = controlBits;
+		ioctl (m_fd, PPWCONTROL, &control);
+	}
+
+	virtual uint8 GetControl ()
+	{
+		unsigned char control = 0;
+		ioctl (m_fd, PPRCONTROL, &control);
+		return control;
+	}
+
+	virtual void SetData (uint8 dataBits)
+	{
+		unsigned char data = dataBits;
+		ioctl (m_fd, PPWDATA, &data);
+	}
+
+private:
+	int m_fd;
+};
+
+LPTBackend* LPT_CreatePPDevBackend (const char* device)
+{
+	int fd = open (device, O_RDWR);
+	if (fd < 0)
+		return NULL;
+
+	if (ioctl (fd, PPEXCL) < 0 || ioctl (fd, PPCLAIM) < 0)
+	{
+		close (fd);
+		return NULL;
+	}
+
+	// Plain compatibility mode; we do all the handshaking ourselves.
+	int mode = IEEE1284_MODE_COMPAT;
+	ioctl (fd, PPSETMODE, &mode);
+	return new LPTPPDevBackend (fd);
+}
+
+#else // __linux__
+
+LPTBackend* LPT_CreatePPDevBackend (const char* device)
+{
+	return NULL;
+}
+
+#endif // __linux__
@@ -0,0 +1,673 @@
+#include <Platform.h>
+#include <stdio.h>
+#include <string.h>
+#include "bootcmd.h"
+#include "crc32.h"
+#include "lz.h"
+#include "manifest.h"
+#include "lpt_sim.h"
+
+// Device side input bits on digital input 1 (0x140011), active low. See boot.s.
+enum
+{
+	IN_nSTROBE   = 0x01,
+	IN_nHOSTBUSY = 0x02,
+};
+
+// Device side output bits, see boot.s.
+enum
+{
+	OUT_BUSY  = 0x08,
+	OUT_nACK  = 0x10,
+	OUT_READY = 0x90, // _readchar waiting: BUSY low, nACK high.
+	OUT_IDLE  = 0x98, // BUSY and nACK high.
+	OUT_ACK   = 0x88, // Byte read: nACK pulsed low.
+};
+
+// Fixed parts of _readchar and SEND_NIBBLE, in cycles after the write that answers a control line change.
+static const uint32 kReadDataCycles = 16;    // move.b 0x140013, %D0
+static const uint32 kAckCycles = 36;         // move.b #0x88, IO_DIGITAL_OUT
+static const uint32 kReleaseWaitCycles = 52; // Four nops, then the wait for STROBE high.
+static const uint32 kReturnCycles = 8;       // RETURN
+static const uint32 kEnterReadCycles = 20;   // move.b #0x90, IO_DIGITAL_OUT at the start of _readchar.
+static const uint32 kNibbleDoneCycles = 20;  // move.b #0x98, IO_DIGITAL_OUT at the end of _sendchar.
+static const uint32 kCRCRangeCycles = 16;    // Per byte in _crc32_range, besides CRC32_UPDATE: the load, and the loop every four bytes.
+static const uint32 kFillCycles = 17;        // Per byte in _fillregion: the store, and the loop every four bytes.
+
+static const uint32 kRamSize = 0x8000;            // UPLOAD_RAM_SIZE in boot.s.
+static const uint32 kMaxBlockSize = 0x100;        // BLOCK_MAX_SIZE in boot.s.
+static const uint32 kMainRamBase = 0x060000;
+static const uint32 kSubRamBase = 0x260000;       // SUBRAM_BASE in boot.s.
+static const uint32 kVideoRamBase = 0x100000;     // TILERAM_BASE in boot.s, up to IO_BASE.
+static const uint32 kVideoRamSize = 0x40000;
+static const uint32 kSubRomBase = 0x200000;
+static const uint32 kRomSize = 0x60000;
+
+static const struct
+{
+	const char* key;
+	uint32 LPTSimTiming::* pField;
+}
+s_timingKeys[] =
+{
+	{ "clock",  &LPTSimTiming::clockHz },
+	{ "poll",   &LPTSimTiming::pollCycles },
+	{ "react",  &LPTSimTiming::reactCycles },
+	{ "settle", &LPTSimTiming::settleCycles },
+	{ "byte",   &LPTSimTiming::byteCycles },
+	{ "crc",    &LPTSimTiming::crcCycles },
+	{ "status", &LPTSimTiming::statusCycles },
+	{ "rise",   &LPTSimTiming::riseNS },
+	{ "fall",   &LPTSimTiming::fallNS },
+	{ "sleep",  &LPTSimTiming::sleepNS },
+};
+
+bool LPT_ParseSimTiming (const char* options, LPTSimTiming& timing)
+{
+	timing.clockHz = 10000000;
+	timing.pollCycles = 46;
+	timing.reactCycles = 32;
+	timing.settleCycles = 514;
+	timing.byteCycles = 42;
+	timing.crcCycles = 70;
+	timing.statusCycles = 1500;
+	timing.riseNS = 30000; // The TLP521s are a lot slower to turn off than on.
+	timing.fallNS = 5000;
+	timing.sleepNS = 0;
+
+	for (const char* p = options; p && *p;)
+	{
+		char key[16];
+		uint32 value;
+		int nChars;
+		if (sscanf (p, "%15[a-z]=%u%n", key, &value, &nChars) != 2)
+			return false;
+		p += nChars;
+
+		uint32 i = 0;
+		for (; i<sizeof (s_timingKeys) / sizeof (s_timingKeys[0]); i++)
+			if (strcmp (key, s_timingKeys[i].key) == 0)
+				break;
+		if (i == sizeof (s_timingKeys) / sizeof (s_timingKeys[0]))
+			return false;
+		timing.*s_timingKeys[i].pField = value;
+
+		if (*p == ',')
+			p++;
+		else if (*p)
+			return false;
+	}
+
+	return timing.clockHz != 0 && timing.pollCycles != 0;
+}
+
+LPTSimBackend* LPT_CreateSimBackend (const char* options)
+{
+	LPTSimTiming timing;
+	if (!LPT_ParseSimTiming (options, timing))
+		return NULL;
+	return new LPTSimBackend (timing);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+void LPTSimBackend::Lines::Init (uint8 value)
+{
+	current = value;
+	previous = value;
+	for (uint32 i=0; i<8; i++)
+		changeNS[i] = 0;
+}
+
+void LPTSimBackend::Lines::Set (uint64 timeNS, uint8 value, const LPTSimTiming& timing)
+{
+	uint8 visible = GetVisible (timeNS, timing);
+	for (uint32 i=0; i<8; i++)
+	{
+		uint8 mask = 1 << i;
+		if (!((value ^ current) & mask))
+			continue;
+
+		// A change that hadn't come through yet is simply cut short.
+		previous = (previous & ~mask) | (visible & mask);
+		changeNS[i] = timeNS;
+	}
+	current = value;
+}
+
+uint8 LPTSimBackend::Lines::GetVisible (uint64 timeNS, const LPTSimTiming& timing) const
+{
+	uint8 visible = 0;
+	for (uint32 i=0; i<8; i++)
+	{
+		uint8 mask = 1 << i;
+		uint64 delay = (current & mask) ? timing.riseNS : timing.fallNS;
+		visible |= ((timeNS >= changeNS[i] + delay) ? current : previous) & mask;
+	}
+	return visible;
+}
+
+bool LPTSimBackend::Lines::WhenVisible (uint8 mask, bool bHigh, uint64 timeNS, const LPTSimTiming& timing, uint64& visibleNS) const
+{
+	uint8 level = bHigh ? mask : 0;
+	if ((GetVisible (timeNS, timing) & mask) == level)
+	{
+		visibleNS = timeNS;
+		return true;
+	}
+
+	if ((current & mask) != level)
+		return false;
+
+	uint32 i = 0;
+	while (!(mask & (1 << i)))
+		i++;
+	visibleNS = changeNS[i] + (bHigh ? timing.riseNS : timing.fallNS);
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+LPTSimBackend::LPTSimBackend (const LPTSimTiming& timing)
+	: m_timing (timing)
+	, m_startNS (PLATFORM_GetTimeNS ())
+	, m_control (CONTROL_nAUTOFEED_i) // HostBusy released, as seen through the PCB inversion.
+	, m_state (DEVICE_HALTED)
+	, m_deviceNS (0)
+	, m_resumeNS (0)
+	, m_rxByte (0)
+	, m_txOut (OUT_IDLE)
+	, m_bTXHighNibble (false)
+	, m_bHalt (false)
+	, m_programState (PROGRAM_COMMAND)
+	, m_command (0)
+	, m_nExpected (1)
+	, m_mainRam (kRamSize, 0)
+	, m_subRam (kRamSize, 0)
+	, m_videoRam (kVideoRamSize, 0)
+	, m_rom (kRomSize * 2)
+{
+	memset (&m_stats, 0, sizeof (m_stats));
+
+	// We don't have the rom images, so the roms read back as a pattern.
+	for (uint32 i=0; i<m_rom.size (); i++)
+		m_rom[i] = (uint8)(i ^ (i >> 8) ^ (i >> 16));
+	m_input.Init (IN_nSTROBE | IN_nHOSTBUSY);
+	m_data.Init (0);
+	m_output.Init (OUT_IDLE);
+
+	// Straight into the main loop.
+	m_deviceNS = m_startNS + Cycles (m_timing.statusCycles);
+	StartReceive ();
+}
+
+uint8 LPTSimBackend::GetStatus ()
+{
+	uint64 nowNS = PLATFORM_GetTimeNS ();
+	Advance (nowNS);
+
+	// Same wiring as the fake backend.
+	uint8 out = m_output.GetVisible (nowNS, m_timing);
+	uint8 swizzled = ((out & 0x7) << 3) |
+	                 ((out & OUT_nACK) ? STATUS_nACK : 0) |
+	                 ((out & OUT_BUSY) ? 0 : STATUS_BUSY_i);
+	return LPT_SwizzleStatus08E (swizzled);
+}
+
+void LPTSimBackend::SetControl (uint8 controlBits)
+{
+	uint64 nowNS = PLATFORM_GetTimeNS ();
+	Advance (nowNS);
+	m_control = controlBits & 0xf;
+
+	// nSTROBE is inverted by the control register; nAUTOFEED is inverted once more on the PCB.
+	bool bStrobe = (m_control & CONTROL_nSTROBE_i) != 0;
+	bool bHostBusy = (m_control & CONTROL_nAUTOFEED_i) == 0;
+	m_input.Set (nowNS, (bStrobe ? 0 : IN_nSTROBE) | (bHostBusy ? 0 : IN_nHOSTBUSY), m_timing);
+}
+
+uint8 LPTSimBackend::GetControl ()
+{
+	return m_control;
+}
+
+void LPTSimBackend::SetData (uint8 dataBits)
+{
+	uint64 nowNS = PLATFORM_GetTimeNS ();
+	Advance (nowNS);
+	m_data.Set (nowNS, dataBits, m_timing);
+}
+
+LPTSimStats LPTSimBackend::GetStats ()
+{
+	uint64 nowNS = PLATFORM_GetTimeNS ();
+	Advance (nowNS);
+	m_stats.elapsedNS = nowNS - m_startNS;
+	return m_stats;
+}
+
+// Finds the first poll of the current wait loop that sees the input line at the given level.
+bool LPTSimBackend::FindPoll (uint8 mask, bool bHigh, uint64& seenNS)
+{
+	uint64 visibleNS;
+	if (!m_input.WhenVisible (mask, bHigh, m_deviceNS, m_timing, visibleNS))
+		return false;
+
+	uint64 pollNS = Cycles (m_timing.pollCycles);
+	if (!pollNS)
+		pollNS = 1;
+	seenNS = m_deviceNS + (visibleNS - m_deviceNS + pollNS - 1) / pollNS * pollNS;
+	return true;
+}
+
+// Runs the device up to nowNS. A step is only taken once all of it lies in the past, so whatever the device
+// reads during the step is final.
+void LPTSimBackend::Advance (uint64 nowNS)
+{
+	for (;;)
+	{
+		uint64 seenNS;
+		switch (m_state)
+		{
+		case DEVICE_RX_WAIT_STROBE:
+		{
+			if (!FindPoll (IN_nSTROBE, false, seenNS))
+				return;
+			uint64 busyNS = seenNS + Cycles (m_timing.reactCycles);
+			uint64 endNS = busyNS + Cycles (kReleaseWaitCycles);
+			if (endNS > nowNS)
+				return;
+
+			// Set BUSY, read the data, then pulse nACK low.
+			m_stats.waitNS += seenNS - m_deviceNS;
+			m_output.Set (busyNS, OUT_IDLE, m_timing);
+			m_rxByte = m_data.GetVisible (busyNS + Cycles (kReadDataCycles), m_timing);
+			if (m_rxByte != m_data.current)
+				m_stats.nMisread++;
+			m_output.Set (busyNS + Cycles (kAckCycles), OUT_ACK, m_timing);
+			m_deviceNS = endNS;
+			m_state = DEVICE_RX_WAIT_RELEASE;
+			break;
+		}
+
+		case DEVICE_RX_WAIT_RELEASE:
+		{
+			if (!FindPoll (IN_nSTROBE, true, seenNS))
+				return;
+			uint64 idleNS = seenNS + Cycles (m_timing.reactCycles);
+			if (idleNS + Cycles (kReturnCycles) > nowNS)
+				return;
+
+			m_stats.waitNS += seenNS - m_deviceNS;
+			m_output.Set (idleNS, OUT_IDLE, m_timing);
+			m_deviceNS = idleNS + Cycles (kReturnCycles);
+			m_stats.nReceived++;
+			OnByte (m_rxByte);
+			Continue ();
+			break;
+		}
+
+		case DEVICE_TX_WAIT_HOSTBUSY:
+		{
+			if (!FindPoll (IN_nHOSTBUSY, false, seenNS))
+				return;
+			uint64 nibbleNS = seenNS + Cycles (m_timing.reactCycles);
+			uint64 clockNS = nibbleNS + Cycles (m_timing.settleCycles);
+			if (clockNS > nowNS)
+				return;
+
+			// Put the nibble on the lines, let them settle and pull PtrClk low.
+			m_stats.waitNS += seenNS - m_deviceNS;
+			uint8 reply = m_replies.front ();
+			m_txOut = OUT_READY | (m_bTXHighNibble ? (reply >> 4) : (reply & 0xf));
+			m_output.Set (nibbleNS, m_txOut, m_timing);
+			m_output.Set (clockNS, m_txOut & ~OUT_nACK, m_timing);
+			m_deviceNS = clockNS;
+			m_state = DEVICE_TX_WAIT_RELEASE;
+			break;
+		}
+
+		case DEVICE_TX_WAIT_RELEASE:
+		{
+			if (!FindPoll (IN_nHOSTBUSY, true, seenNS))
+				return;
+			uint64 releaseNS = seenNS + Cycles (m_timing.reactCycles);
+			uint64 endNS = releaseNS + (m_bTXHighNibble ? Cycles (kNibbleDoneCycles) : 0);
+			if (endNS > nowNS)
+				return;
+
+			// Release PtrClk; after the high nibble, BUSY and nACK go back to idle.
+			m_stats.waitNS += seenNS - m_deviceNS;
+			m_output.Set (releaseNS, m_txOut, m_timing);
+			if (m_bTXHighNibble)
+			{
+				m_output.Set (endNS, OUT_IDLE, m_timing);
+				m_replies.pop_front ();
+				m_stats.nSent++;
+			}
+			m_bTXHighNibble = !m_bTXHighNibble;
+			m_deviceNS = endNS;
+			Continue ();
+			break;
+		}
+
+		case DEVICE_HALTED:
+			return;
+		}
+	}
+}
+
+void LPTSimBackend::StartReceive ()
+{
+	m_output.Set (m_deviceNS, OUT_READY, m_timing);
+	m_deviceNS += Cycles (kEnterReadCycles);
+	m_state = DEVICE_RX_WAIT_STROBE;
+}
+
+// Sends any replies, then does whatever the program does before it reads the next byte.
+void LPTSimBackend::Continue ()
+{
+	if (!m_replies.empty ())
+	{
+		m_state = DEVICE_TX_WAIT_HOSTBUSY;
+		return;
+	}
+
+	m_deviceNS += m_resumeNS;
+	m_resumeNS = 0;
+	if (m_bHalt)
+	{
+		m_stats.rebootNS = m_deviceNS - m_startNS;
+		m_state = DEVICE_HALTED;
+		return;
+	}
+
+	StartReceive ();
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+void LPTSimBackend::Expect (ProgramState state, uint32 nBytes)
+{
+	m_programState = state;
+	m_nExpected = nBytes;
+	m_buffer.clear ();
+}
+
+void LPTSimBackend::ReturnToMainLoop (uint64 sleepNS)
+{
+	Expect (PROGRAM_COMMAND, 1);
+	m_resumeNS += sleepNS + Cycles (m_timing.statusCycles);
+}
+
+void LPTSimBackend::OnByte (uint8 byte)
+{
+	if (m_programState == PROGRAM_COMMAND)
+	{
+		OnCommand (byte);
+		return;
+	}
+
+	// Framed blocks are checked while they come in.
+	bool bCRC = m_programState == PROGRAM_BLOCK_DATA || m_programState == PROGRAM_ADDRESS_DATA ||
+	            (m_programState == PROGRAM_FRAME_HEADER && (m_command == COMMAND_UPLOADBLOCK || m_command == COMMAND_UPLOADADDRESS));
+	m_deviceNS += Cycles (m_timing.byteCycles + (bCRC ? m_timing.crcCycles : 0));
+
+	m_buffer.push_back (byte);
+	if (m_buffer.size () < m_nExpected)
+		return;
+
+	switch (m_programState)
+	{
+	case PROGRAM_UPLOAD_SIZE:
+	{
+		uint32 size = (m_buffer[0] << 8) | m_buffer[1];
+		if (!size)
+			ReturnToMainLoop (m_timing.sleepNS);
+		else
+			Expect (PROGRAM_UPLOAD_DATA, ((size - 1) & 0x7fff) + 1);
+		break;
+	}
+
+	case PROGRAM_UPLOAD_DATA:
+	{
+		std::vector<uint8>& ram = m_command == COMMAND_UPLOADMAIN ? m_mainRam : m_subRam;
+		memcpy (&ram[0], &m_buffer[0], m_buffer.size ());
+		ReturnToMainLoop (m_timing.sleepNS);
+		break;
+	}
+
+	case PROGRAM_FRAME_HEADER:
+		OnFrameHeader ();
+		break;
+
+	case PROGRAM_BLOCK_DATA:
+	{
+		uint32 nBytes = m_nExpected - 4;
+		const uint8* pCRC = &m_buffer[nBytes];
+		uint32 crc = (pCRC[0] << 24) | (pCRC[1] << 16) | (pCRC[2] << 8) | pCRC[3];
+		uint8 target = m_header[0];
+		uint32 offset = (m_header[1] << 8) | m_header[2];
+
+		// Written while it's received, whether it's damaged or not.
+		std::vector<uint8>& ram = target ? m_subRam : m_mainRam;
+		memcpy (&ram[offset], &m_buffer[0], nBytes);
+		Reply (CRC32_Calc (&m_buffer[0], nBytes, CRC32_Calc (m_header, 5)) == crc ? REPLY_ACK : REPLY_NAK);
+		ReturnToMainLoop (0);
+		break;
+	}
+
+	case PROGRAM_COMPRESSED_DATA:
+	{
+		uint32 nCompressedBytes = m_nExpected - 4;
+		const uint8* pCRC = &m_buffer[nCompressedBytes];
+		uint32 crc = (pCRC[0] << 24) | (pCRC[1] << 16) | (pCRC[2] << 8) | pCRC[3];
+		uint8 target = m_header[0];
+		uint32 nBytes = (m_header[3] << 8) | m_header[4];
+
+		// Decompressing and checking happens while receiving; it's only added up here.
+		m_deviceNS += Cycles (nBytes * (m_timing.byteCycles + m_timing.crcCycles));
+
+		std::vector<uint8> data (nBytes);
+		bool bOK = LZ_Decompress (&m_buffer[0], nCompressedBytes, &data[0], nBytes) && CRC32_Calc (&data[0], nBytes) == crc;
+		if (bOK)
+			memcpy (target ? &m_subRam[0] : &m_mainRam[0], &data[0], nBytes);
+		Reply (bOK ? REPLY_ACK : REPLY_NAK);
+		ReturnToMainLoop (0);
+		break;
+	}
+
+	case PROGRAM_ADDRESS_DATA:
+	{
+		uint32 nBytes = m_nExpected - 4;
+		const uint8* pCRC = &m_buffer[nBytes];
+		uint32 crc = (pCRC[0] << 24) | (pCRC[1] << 16) | (pCRC[2] << 8) | pCRC[3];
+		uint32 address = (m_header[0] << 24) | (m_header[1] << 16) | (m_header[2] << 8) | m_header[3];
+
+		memcpy (MapAddress (address), &m_buffer[0], nBytes);
+		Reply (CRC32_Calc (&m_buffer[0], nBytes, CRC32_Calc (m_header, 8)) == crc ? REPLY_ACK : REPLY_NAK);
+		ReturnToMainLoop (0);
+		break;
+	}
+
+	case PROGRAM_COMMAND:
+		DEBUG_ASSERT(false);
+		break;
+	}
+}
+
+void LPTSimBackend::OnCommand (uint8 command)
+{
+	m_stats.nCommands++;
+	m_command = command;
+	switch (command)
+	{
+	case COMMAND_NOP:
+		ReturnToMainLoop (0);
+		break;
+
+	case COMMAND_REBOOTRAM:
+		// Whatever was uploaded runs now, and we can't simulate that.
+		m_resumeNS += Cycles (m_timing.statusCycles) + m_timing.sleepNS;
+		m_bHalt = true;
+		break;
+
+	case COMMAND_REBOOTROM:
+		ReturnToMainLoop (Cycles (m_timing.statusCycles) + m_timing.sleepNS);
+		break;
+
+	case COMMAND_UPLOADMAIN:
+	case COMMAND_UPLOADSUB:
+		m_resumeNS += Cycles (m_timing.statusCycles);
+		Expect (PROGRAM_UPLOAD_SIZE, 2);
+		break;
+
+	case COMMAND_UPLOADBLOCK:
+	case COMMAND_UPLOADCOMPRESSED:
+	case COMMAND_CHECKRANGE:
+		m_resumeNS += Cycles (m_timing.statusCycles);
+		Expect (PROGRAM_FRAME_HEADER, 6);
+		break;
+
+	case COMMAND_UPLOADADDRESS:
+	case COMMAND_READRANGE:
+	case COMMAND_CHECKADDRESS:
+		m_resumeNS += Cycles (m_timing.statusCycles);
+		Expect (PROGRAM_FRAME_HEADER, 9);
+		break;
+
+	case COMMAND_FILLREGION:
+		m_resumeNS += Cycles (m_timing.statusCycles);
+		Expect (PROGRAM_FRAME_HEADER, 10);
+		break;
+
+	default:
+		ReturnToMainLoop (Cycles (m_timing.statusCycles) + m_timing.sleepNS);
+		break;
+	}
+}
+
+void LPTSimBackend::OnFrameHeader ()
+{
+	memcpy (m_header, &m_buffer[0], m_buffer.size ());
+	if (m_command == COMMAND_FILLREGION)
+	{
+		// Like the address commands, with the fill byte before the check byte. Answered once the range is filled.
+		uint32 address = (m_header[0] << 24) | (m_header[1] << 16) | (m_header[2] << 8) | m_header[3];
+		uint32 nBytes = (m_header[4] << 24) | (m_header[5] << 16) | (m_header[6] << 8) | m_header[7];
+		uint8 check = 0;
+		for (uint32 i=0; i<9; i++)
+			check ^= m_header[i];
+
+		if (check == m_header[9] && nBytes && MANIFEST_FindRegion (address, nBytes, true))
+		{
+			memset (MapAddress (address), m_header[8], nBytes);
+			m_deviceNS += Cycles (nBytes * kFillCycles);
+			Reply (REPLY_ACK);
+		}
+		else
+			Reply (REPLY_NAK);
+		ReturnToMainLoop (0);
+		return;
+	}
+
+	if (m_command == COMMAND_UPLOADADDRESS || m_command == COMMAND_READRANGE || m_command == COMMAND_CHECKADDRESS)
+	{
+		// Address and length are longs; the range has to be in one of the regions in _upload_regions or _read_regions.
+		uint32 address = (m_header[0] << 24) | (m_header[1] << 16) | (m_header[2] << 8) | m_header[3];
+		uint32 nBytes = (m_header[4] << 24) | (m_header[5] << 16) | (m_header[6] << 8) | m_header[7];
+		uint8 check = 0;
+		for (uint32 i=0; i<8; i++)
+			check ^= m_header[i];
+
+		bool bUpload = m_command == COMMAND_UPLOADADDRESS;
+		if (check != m_header[8] || !nBytes || !MANIFEST_FindRegion (address, nBytes, bUpload))
+		{
+			Reply (REPLY_NAK);
+			ReturnToMainLoop (0);
+			return;
+		}
+
+		Reply (REPLY_ACK);
+		if (bUpload)
+		{
+			Expect (PROGRAM_ADDRESS_DATA, nBytes + 4);
+			return;
+		}
+
+		// The data and its CRC, or just the CRC. Sending takes a lot longer than the CRC, so that is only added up here.
+		const uint8* pData = MapAddress (address);
+		uint32 crc = CRC32_Calc (pData, nBytes);
+		if (m_command == COMMAND_CHECKADDRESS)
+			m_deviceNS += Cycles (nBytes * (m_timing.crcCycles + kCRCRangeCycles));
+		else
+		{
+			for (uint32 i=0; i<nBytes; i++)
+				Reply (pData[i]);
+			m_deviceNS += Cycles (nBytes * m_timing.crcCycles);
+		}
+		Reply ((uint8)(crc >> 24));
+		Reply ((uint8)(crc >> 16));
+		Reply ((uint8)(crc >> 8));
+		Reply ((uint8)crc);
+		ReturnToMainLoop (0);
+		return;
+	}
+
+	uint8 target = m_header[0];
+	uint32 word0 = (m_header[1] << 8) | m_header[2];
+	uint32 word1 = (m_header[3] << 8) | m_header[4];
+	bool bValid = (m_header[0] ^ m_header[1] ^ m_header[2] ^ m_header[3] ^ m_header[4]) == m_header[5] && target <= 1 && word1;
+
+	switch (m_command)
+	{
+	case COMMAND_UPLOADBLOCK:
+		// word0 is the offset, word1 the length.
+		if (!bValid || word1 > kMaxBlockSize || word0 + word1 > kRamSize)
+			break;
+		Reply (REPLY_ACK);
+		Expect (PROGRAM_BLOCK_DATA, word1 + 4);
+		return;
+
+	case COMMAND_UPLOADCOMPRESSED:
+		// word0 is the compressed length, word1 the decompressed length.
+		if (!bValid || word1 > kRamSize || !word0)
+			break;
+		Reply (REPLY_ACK);
+		Expect (PROGRAM_COMPRESSED_DATA, word0 + 4);
+		return;
+
+	case COMMAND_CHECKRANGE:
+	{
+		// word0 is the offset, word1 the length. The CRC is calculated after the ACK, but we only keep the total time.
+		if (!bValid || word0 + word1 > kRamSize)
+			break;
+		const std::vector<uint8>& ram = target ? m_subRam : m_mainRam;
+		uint32 crc = CRC32_Calc (&ram[word0], word1);
+		m_deviceNS += Cycles (word1 * (m_timing.crcCycles + kCRCRangeCycles));
+		Reply (REPLY_ACK);
+		Reply ((uint8)(crc >> 24));
+		Reply ((uint8)(crc >> 16));
+		Reply ((uint8)(crc >> 8));
+		Reply ((uint8)crc);
+		ReturnToMainLoop (0);
+		return;
+	}
+	}
+
+	Reply (REPLY_NAK);
+	ReturnToMainLoop (0);
+}
+
+uint8* LPTSimBackend::MapAddress (uint32 address)
+{
+	if (address >= kSubRamBase)
+		return &m_subRam[address - kSubRamBase];
+	if (address >= kSubRomBase)
+		return &m_rom[kRomSize + address - kSubRomBase];
+	if (address >= kVideoRamBase)
+		return &m_videoRam[address - kVideoRamBase];
+	if (address >= kMainRamBase)
+		return &m_mainRam[address - kMainRamBase];
+	return &m_rom[address];
+}
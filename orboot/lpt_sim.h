@@ -0,0 +1,153 @@
+#ifndef __LPT_SIM_H__
+#define __LPT_SIM_H__
+
+#include <Platform.h>
+#include "lpt.h"
+#include <vector>
+#include <deque>
+
+// Simulated bootloader device, see LPT_CreateSimBackend.
+// Unlike the fake backend, this one runs the device side in (simulated) real time, so the host code can be
+// timed against it. The bootloader is modeled at the level of its I/O: the wait loops in _readchar and
+// SEND_NIBBLE poll the control lines every pollCycles, writes to IO_DIGITAL_OUT happen a fixed number of
+// cycles after that, and the command handlers in _mainloop take time per received byte.
+// Every line between the PC and the board goes through an optocoupler, which passes a rising edge after
+// riseNS and a falling edge after fallNS. Data that changes too close to STROBE is read wrong, just like
+// on the real thing.
+
+// Device timing. Cycle counts are taken from boot.s.
+struct LPTSimTiming
+{
+	uint32 clockHz;      // 68000 clock; 10MHz on the Out Run board.
+	uint32 pollCycles;   // One iteration of a wait loop on a control line (WATCHDOG_CLEAR, btst, bne).
+	uint32 reactCycles;  // From the poll that sees a control line change to the write of the reply.
+	uint32 settleCycles; // Settle loop in SEND_NIBBLE, before PtrClk goes low.
+	uint32 byteCycles;   // Storing a received byte and calling _readchar again.
+	uint32 crcCycles;    // CRC32_UPDATE, per byte.
+	uint32 statusCycles; // _print_status, whenever the main loop is entered.
+	uint32 riseNS;       // Optocoupler delay for a line going high.
+	uint32 fallNS;       // Optocoupler delay for a line going low.
+	uint32 sleepNS;      // _sleep after plain uploads, reboots and invalid commands. Gone since V0.9E; 500 ms before that.
+};
+
+// Fills in the defaults, then applies a comma separated list of key=value overrides (e.g. "clock=8000000,rise=40000").
+// Keys are the field names without the unit: clock, poll, react, settle, byte, crc, status, rise, fall and sleep.
+// For example, sleep=500000000 simulates a bootloader before V0.9E, to compare deploy times.
+// Returns false on an unknown key or a bad value. options may be NULL.
+bool LPT_ParseSimTiming (const char* options, LPTSimTiming& timing);
+
+// What the simulated device saw.
+struct LPTSimStats
+{
+	uint32 nReceived;   // Bytes read in _readchar.
+	uint32 nMisread;    // Received bytes that differ from what the host had on the data lines at the time.
+	uint32 nSent;       // Bytes sent in nibble mode.
+	uint32 nCommands;   // Commands received in the main loop.
+	uint64 waitNS;      // Time spent in the wait loops.
+	uint64 elapsedNS;   // Time since the device was created.
+	uint64 rebootNS;    // Time from the creation of the device until it rebooted to ram, or zero if it didn't.
+};
+
+class LPTSimBackend : public LPTBackend
+{
+public:
+	LPTSimBackend (const LPTSimTiming& timing);
+
+	virtual const char* GetName () const { return "sim"; }
+
+	virtual uint8 GetStatus ();
+	virtual void  SetControl (uint8 controlBits);
+	virtual uint8 GetControl ();
+	virtual void  SetData (uint8 dataBits);
+
+	LPTSimStats GetStats ();
+
+	// Device ram, as written by the upload commands.
+	const std::vector<uint8>& GetRam (uint8 target) const { return target ? m_subRam : m_mainRam; }
+
+private:
+	// A group of up to 8 lines, each with its own optocoupler.
+	struct Lines
+	{
+		uint8 current;        // As driven.
+		uint8 previous;       // What the far side saw before the last change of each line.
+		uint64 changeNS[8];   // Time of the last change of each line.
+
+		void Init (uint8 value);
+		void Set (uint64 timeNS, uint8 value, const LPTSimTiming& timing);
+		uint8 GetVisible (uint64 timeNS, const LPTSimTiming& timing) const;
+
+		// When the far side can first see the line at the given level, from timeNS on.
+		// Returns false if that won't happen until the near side changes the line.
+		bool WhenVisible (uint8 mask, bool bHigh, uint64 timeNS, const LPTSimTiming& timing, uint64& visibleNS) const;
+	};
+
+	enum DeviceState
+	{
+		DEVICE_RX_WAIT_STROBE,    // _readchar, waiting for STROBE to go low.
+		DEVICE_RX_WAIT_RELEASE,   // _readchar, waiting for STROBE to go high again.
+		DEVICE_TX_WAIT_HOSTBUSY,  // SEND_NIBBLE, waiting for HostBusy to go low.
+		DEVICE_TX_WAIT_RELEASE,   // SEND_NIBBLE, waiting for HostBusy to go high again.
+		DEVICE_HALTED,            // Rebooted to ram; the program doesn't talk to us.
+	};
+
+	enum ProgramState
+	{
+		PROGRAM_COMMAND,
+		PROGRAM_UPLOAD_SIZE,
+		PROGRAM_UPLOAD_DATA,
+		PROGRAM_FRAME_HEADER,
+		PROGRAM_BLOCK_DATA,
+		PROGRAM_COMPRESSED_DATA,
+		PROGRAM_ADDRESS_DATA,
+	};
+
+	uint64 Cycles (uint32 nCycles) const { return (uint64)nCycles * 1000000000 / m_timing.clockHz; }
+	bool   FindPoll (uint8 mask, bool bHigh, uint64& seenNS);
+	void   Advance (uint64 nowNS);
+	void   StartReceive ();
+	void   Continue ();
+
+	// The bootloader's command handling, one received byte at a time.
+	void   OnByte (uint8 byte);
+	void   OnCommand (uint8 command);
+	void   OnFrameHeader ();
+	void   Expect (ProgramState state, uint32 nBytes);
+	void   ReturnToMainLoop (uint64 sleepNS);
+	void   Reply (uint8 byte) { m_replies.push_back (byte); }
+	uint8* MapAddress (uint32 address);
+
+	LPTSimTiming m_timing;
+	LPTSimStats m_stats;
+	uint64 m_startNS;
+
+	// Host side.
+	uint8 m_control;
+
+	// Lines, as seen from both sides.
+	Lines m_input;    // Digital input 1 (0x140011): STROBE and HostBusy.
+	Lines m_data;     // Digital input 2 (0x140013): data.
+	Lines m_output;   // IO_DIGITAL_OUT, which drives the status lines.
+
+	// Device side.
+	DeviceState m_state;
+	uint64 m_deviceNS;        // Time the device reached the current state.
+	uint64 m_resumeNS;        // Time to spend after the replies are sent, before the next _readchar.
+	uint8 m_rxByte;
+	uint8 m_txOut;            // Nibble and flags on IO_DIGITAL_OUT while sending.
+	bool m_bTXHighNibble;
+	bool m_bHalt;
+	std::deque<uint8> m_replies;
+
+	ProgramState m_programState;
+	uint8 m_command;
+	uint8 m_header[10];       // Header of the current framed command.
+	uint32 m_nExpected;
+	std::vector<uint8> m_buffer;
+	std::vector<uint8> m_mainRam;
+	std::vector<uint8> m_subRam;
+	std::vector<uint8> m_videoRam;  // Tile, text, palette and sprite ram, for COMMAND_UPLOADADDRESS.
+	std::vector<uint8> m_rom;       // Main and sub rom, for COMMAND_READRANGE.
+};
+
+#endif // __LPT_SIM_H__
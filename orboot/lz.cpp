@@ -0,0 +1,128 @@
+#include <Platform.h>
+#include <string.h>
+#include "lz.h"
+
+static const uint32 kHashBits = 14;
+static const uint32 kMaxChainLength = 256; // Images are 32KB at most, so we can afford to search.
+static const uint32 kNoPosition = 0xffffffff;
+
+static inline uint32 Hash3 (const uint8* p)
+{
+	return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> (32 - kHashBits);
+}
+
+static void FlushLiterals (const uint8* pLiterals, uint32 nLiterals, std::vector<uint8>& compressed)
+{
+	while (nLiterals)
+	{
+		uint32 nRun = nLiterals < kLZMaxLiterals ? nLiterals : kLZMaxLiterals;
+		compressed.push_back ((uint8)(nRun - 1));
+		compressed.insert (compressed.end(), pLiterals, pLiterals + nRun);
+		pLiterals += nRun;
+		nLiterals -= nRun;
+	}
+}
+
+void LZ_Compress (const void* pData, uint32 nBytes, std::vector<uint8>& compressed)
+{
+	const uint8* pSrc = (const uint8*)pData;
+
+	// Hash chains over all 3 byte sequences.
+	std::vector<uint32> head (1 << kHashBits, kNoPosition);
+	std::vector<uint32> prev (nBytes, kNoPosition);
+
+	uint32 literalStart = 0;
+	uint32 pos = 0;
+	while (pos < nBytes)
+	{
+		uint32 bestLength = 0;
+		uint32 bestOffset = 0;
+		if (pos + kLZMinMatch <= nBytes)
+		{
+			uint32 maxLength = nBytes - pos;
+			if (maxLength > kLZMaxMatch)
+				maxLength = kLZMaxMatch;
+
+			uint32 candidate = head[Hash3 (pSrc + pos)];
+			for (uint32 chain=0; chain<kMaxChainLength && candidate != kNoPosition; chain++)
+			{
+				if (pos - candidate > kLZMaxOffset)
+					break;
+
+				uint32 length = 0;
+				while (length < maxLength && pSrc[candidate + length] == pSrc[pos + length])
+					length++;
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestOffset = pos - candidate;
+					if (length == maxLength)
+						break;
+				}
+				candidate = prev[candidate];
+			}
+		}
+
+		// A 3 byte match costs as much as the literals, and breaks up literal runs.
+		uint32 advance = 1;
+		if (bestLength > kLZMinMatch)
+		{
+			FlushLiterals (pSrc + literalStart, pos - literalStart, compressed);
+			compressed.push_back ((uint8)(0x80 | (bestLength - kLZMinMatch)));
+			compressed.push_back ((uint8)(bestOffset >> 8));
+			compressed.push_back ((uint8)(bestOffset & 0xff));
+			advance = bestLength;
+			literalStart = pos + bestLength;
+		}
+
+		// Insert all positions we skip over into the chains.
+		for (uint32 i=0; i<advance; i++, pos++)
+		{
+			if (pos + kLZMinMatch <= nBytes)
+			{
+				uint32 hash = Hash3 (pSrc + pos);
+				prev[pos] = head[hash];
+				head[hash] = pos;
+			}
+		}
+	}
+
+	FlushLiterals (pSrc + literalStart, nBytes - literalStart, compressed);
+}
+
+bool LZ_Decompress (const void* pCompressed, uint32 nCompressedBytes, void* pData, uint32 nBytes)
+{
+	const uint8* pSrc = (const uint8*)pCompressed;
+	const uint8* pSrcEnd = pSrc + nCompressedBytes;
+	uint8* pDst = (uint8*)pData;
+	uint32 pos = 0;
+	while (pSrc < pSrcEnd)
+	{
+		uint8 token = *pSrc++;
+		if (token & 0x80)
+		{
+			if (pSrcEnd - pSrc < 2)
+				return false;
+			uint32 offset = (pSrc[0] << 8) | pSrc[1];
+			uint32 length = (token & 0x7f) + kLZMinMatch;
+			pSrc += 2;
+			if (!offset || offset > pos || length > nBytes - pos)
+				return false;
+
+			// Byte by byte, since the copy may overlap.
+			for (uint32 i=0; i<length; i++, pos++)
+				pDst[pos] = pDst[pos - offset];
+		}
+		else
+		{
+			uint32 length = token + 1;
+			if ((uint32)(pSrcEnd - pSrc) < length || length > nBytes - pos)
+				return false;
+			memcpy (pDst + pos, pSrc, length);
+			pSrc += length;
+			pos += length;
+		}
+	}
+
+	return pos == nBytes;
+}
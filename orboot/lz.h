@@ -0,0 +1,25 @@
+#ifndef __LZ_H__
+#define __LZ_H__
+
+#include <Platform.h>
+#include <vector>
+
+// Byte oriented LZ compression, simple enough to decode on the fly in the bootloader while receiving.
+// The stream is a sequence of tokens:
+// - 0x00..0x7f: literal run; (token+1) bytes follow which are copied as is.
+// - 0x80..0xff: match; a 16 bit offset follows in high-low order. Copies (token&0x7f)+3 bytes
+//               starting 'offset' bytes back in the output. The copy may overlap the output.
+// There's no end marker; the decompressed size is sent separately.
+
+static const uint32 kLZMinMatch = 3;
+static const uint32 kLZMaxMatch = 0x7f + kLZMinMatch;
+static const uint32 kLZMaxLiterals = 0x80;
+static const uint32 kLZMaxOffset = 0xffff;
+
+// Appends the compressed data to 'compressed'.
+void LZ_Compress (const void* pData, uint32 nBytes, std::vector<uint8>& compressed);
+
+// Decompresses exactly nBytes into pData. Returns false if the stream is damaged or doesn't match the size.
+bool LZ_Decompress (const void* pCompressed, uint32 nCompressedBytes, void* pData, uint32 nBytes);
+
+#endif // __LZ_H__
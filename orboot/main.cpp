@@ -1,70 +1,433 @@
 #include <Platform.h>
 #include <stdio.h>
-#include <conio.h>
+#include <string>
+#include <vector>
 #include "lpt.h"
+#include "lpt_fake.h"
+#include "lpt_sim.h"
 #include "comm.h"
+#include "bootcmd.h"
+#include "calibrate.h"
+#include "console.h"
+#include "manifest.h"
+#include "settings.h"
+#include "stats.h"
+#include "pipeline.h"
+#include "profile.h"
 
 static const char versionString[] = "0.9A";
 
-enum
+// Creates the port backend. Prints the reason and returns NULL on failure.
+static LPTBackend* CreateBackend (const char* backendName, const char* portName)
 {
-	COMMAND_NOP        = 0,
-	COMMAND_REBOOTRAM  = 1,
-	COMMAND_REBOOTROM  = 2,
-	COMMAND_UPLOADMAIN = 3,
-	COMMAND_UPLOADSUB  = 4,
-};
+	if (stricmp (backendName, "inpout32") == 0)
+	{
+#ifdef _WIN32
+		uint32 port = 0x378;
+		if (portName && 
+			sscanf (portName, "0x%x", &port) != 1 && 
+			sscanf (portName, "0x%X", &port) != 1 && 
+			sscanf (portName, "%u",   &port) != 1)
+		{
+			printf ("Port option needs a valid positive value!\n");
+			return NULL;
+		}
 
-bool Nop ()       { return COMM_SendByte (COMMAND_NOP); }
-bool RebootRAM () { return COMM_SendByte (COMMAND_REBOOTRAM); }
-bool RebootROM () { return COMM_SendByte (COMMAND_REBOOTROM); }
+		if (port == 378) 
+			printf ("Warning: did you mean to use hexadecimal (0x378) notation?\n");
+		return LPT_CreateInpOut32Backend (port);
+#else
+		printf ("The inpout32 backend is only available on Windows.\n");
+		return NULL;
+#endif
+	}
+	else if (stricmp (backendName, "ppdev") == 0)
+	{
+#ifdef __linux__
+		// Either a device path, or just the port number.
+		char device[64] = "/dev/parport0";
+		uint32 portIdx;
+		if (portName && portName[0] == '/')
+			snprintf (device, sizeof(device), "%s", portName);
+		else if (portName && sscanf (portName, "%u", &portIdx) == 1)
+			snprintf (device, sizeof(device), "/dev/parport%u", portIdx);
+		else if (portName)
+		{
+			printf ("Port option needs a device path or port number!\n");
+			return NULL;
+		}
 
-// Write a 16 bit value in high-low (bigendian) order.
-static bool COMM_SendWord (uint16 word)
+		LPTBackend* pBackend = LPT_CreatePPDevBackend (device);
+		if (!pBackend)
+			printf ("Couldn't open or claim '%s'. Is the ppdev module loaded, and do we have access?\n", device);
+		return pBackend;
+#else
+		printf ("The ppdev backend is only available on Linux.\n");
+		return NULL;
+#endif
+	}
+	else if (stricmp (backendName, "fake") == 0)
+	{
+		// Accepts everything, but never replies on its own. Mostly useful to test the host side.
+		return LPT_CreateFakeBackend ();
+	}
+	else if (stricmp (backendName, "sim") == 0)
+	{
+		// The port option holds timing overrides, see LPT_ParseSimTiming.
+		LPTBackend* pBackend = LPT_CreateSimBackend (portName);
+		if (!pBackend)
+			printf ("Bad simulator timing '%s'. Use key=value pairs, e.g. clock=8000000,rise=40000.\n", portName);
+		return pBackend;
+	}
+
+	printf ("Unknown backend '%s'.\n", backendName);
+	return NULL;
+}
+
+// Prints what the simulated device saw, for benchmarks.
+static void PrintSimStats (LPTBackend* pBackend)
 {
-	return COMM_SendByte (word >> 8) && COMM_SendByte (word & 0xff);
+	if (stricmp (pBackend->GetName (), "sim") != 0)
+		return;
+
+	LPTSimStats stats = ((LPTSimBackend*)pBackend)->GetStats ();
+	printf ("Simulated device: %u commands, %u bytes received (%u misread), %u bytes sent in %.3f seconds; waited for the host %.1f%% of the time.\n",
+		stats.nCommands, stats.nReceived, stats.nMisread, stats.nSent, stats.elapsedNS / 1e9,
+		stats.elapsedNS ? stats.waitNS * 100.0 / stats.elapsedNS : 0.0);
 }
 
-static bool UploadInternal (const uint8* pData, uint16 nBytes)
+// The simulated device reboots in its own time, which is where a deploy ends. It knows when as soon as it
+// sees the end of the reboot command, so this doesn't take long.
+static void PrintSimReboot (LPTBackend* pBackend)
 {
-	// Command has been sent.
-	if (!COMM_SendWord (nBytes))
-		return false;
+	if (stricmp (pBackend->GetName (), "sim") != 0)
+		return;
+
+	uint64 rebootNS = 0;
+	for (uint32 i=0; i<100 && !rebootNS; i++)
+	{
+		rebootNS = ((LPTSimBackend*)pBackend)->GetStats ().rebootNS;
+		if (!rebootNS)
+			PLATFORM_SleepMS (1);
+	}
+	if (rebootNS)
+		printf ("Simulated device rebooted to ram after %.3f seconds.\n", rebootNS / 1e9);
+}
+
+// Finds the TX delay for the port and stores it. The TX delay option sets the upper bound.
+static int Calibrate (const char* backendName, const char* portName, const char* settingsKey, bool bTXDelaySet)
+{
+	uint64 maxDelay = bTXDelaySet ? COMM_GetTXDelayNS () : 100000;
+
+	LPTBackend* pBackend = CreateBackend (backendName, portName);
+	if (!pBackend)
+		return 1;
+	LPT_SetBackend (pBackend);
+
+	COMM_Init ();
+	COMM_SetControlInversionMask (CONTROL_nAUTOFEED_i); // We have autofeed inverted on the PCB.
+	COMM_Reset ();
+
+	printf ("Initializing...");
+	if (!Nop())
+	{
+		printf ("\nBootloader device not in default state. Operation timed out.\n");
+		delete pBackend;
+		return 1;
+	}
+
+	printf ("\nCalibrating TX delay (at most " FMT_U64 " nanoseconds)...\n", maxDelay);
+	uint64 txDelay = 0;
+	bool bCalibrated = CALIBRATE_FindTXDelay (maxDelay, txDelay);
 
-	// Now send out all the data.
-	for (uint32 i=0; i<nBytes; i++)
-		if (!COMM_SendByte(pData[i]))
-			return false;
+	const CommLatencyStats& stats = COMM_GetLatencyStats ();
+	if (stats.count)
+	{
+		printf ("Strobe to busy latency: min " FMT_U64 ", avg " FMT_U64 ", max " FMT_U64 " nanoseconds (%u bytes).\n",
+			stats.minNS, stats.totalNS / stats.count, stats.maxNS, stats.count);
+	}
+
+	PrintSimStats (pBackend);
+	delete pBackend;
+	if (!bCalibrated)
+	{
+		printf ("Calibration failed. Reset the board, and try a larger -txdelay as the upper bound.\n");
+		return 1;
+	}
+
+	printf ("Calibrated TX delay is " FMT_U64 " nanoseconds.\n", txDelay);
+	if (!SETTINGS_SaveTXDelay (settingsKey, txDelay))
+	{
+		printf ("Couldn't store the TX delay for '%s'!\n", settingsKey);
+		return 1;
+	}
 
-	return true;
+	return 0;
 }
 
-bool UploadMainRam (const void* pData, uint16 nBytes)
+// Reads a range of memory into a file. The bootloader sends a CRC after every block, and we read it again if it doesn't match.
+static int Dump (const char* backendName, const char* portName, uint32 address, uint32 nBytes, const char* fileName)
 {
-	DEBUG_ASSERT(pData);
-	DEBUG_ASSERT(nBytes <= 32768);
-	if (!COMM_SendByte (COMMAND_UPLOADMAIN))
-		return false;
+	LPTBackend* pBackend = CreateBackend (backendName, portName);
+	if (!pBackend)
+		return 1;
+	LPT_SetBackend (pBackend);
 
-	return UploadInternal ((const uint8*)pData, nBytes);
+	COMM_Init ();
+	COMM_SetControlInversionMask (CONTROL_nAUTOFEED_i); // We have autofeed inverted on the PCB.
+	COMM_Reset ();
+
+	printf ("Initializing...");
+	if (!Nop())
+	{
+		printf ("\nBootloader device not in default state. Operation timed out.\n");
+		delete pBackend;
+		return 1;
+	}
+
+	printf ("\nReading %u bytes from 0x%06x...", nBytes, address);
+	std::vector<uint8> data (nBytes);
+	uint32 nRetries = 0;
+	uint64 startNS = PLATFORM_GetTimeNS ();
+	bool bRead = ReadRange (address, &data[0], nBytes, nRetries);
+	uint64 elapsedNS = PLATFORM_GetTimeNS () - startNS;
+	if (bRead)
+		printf (" %.1f seconds.\n", elapsedNS / 1e9);
+	else
+		printf ("\nRead timed out, or the data kept arriving damaged.\n");
+	if (nRetries)
+		printf ("Read %u damaged block(s) again.\n", nRetries);
+
+	PrintSimStats (pBackend);
+	delete pBackend;
+	if (!bRead)
+		return 1;
+
+	FILE* pFile = fopen (fileName, "wb");
+	if (!pFile || fwrite (&data[0], 1, nBytes, pFile) != nBytes)
+	{
+		printf ("Couldn't write '%s'!\n", fileName);
+		if (pFile)
+			fclose (pFile);
+		return 1;
+	}
+
+	fclose (pFile);
+	return 0;
 }
 
-bool UploadSubRam (const void* pData, uint16 nBytes)
+// Calibrated delays and cached images are stored per backend and port.
+static void MakeSettingsKey (char* settingsKey, size_t keySize, const char* backendName, const char* portName)
 {
-	DEBUG_ASSERT(pData);
-	DEBUG_ASSERT(nBytes <= 32768);
-	if (!COMM_SendByte (COMMAND_UPLOADSUB))
-		return false;
+	snprintf (settingsKey, keySize, "%s:%s", backendName, portName ? portName : "default");
+	for (char* p=settingsKey; *p; p++)
+		if (*p == ' ')
+			*p = '_';
+}
 
-	return UploadInternal ((const uint8*)pData, nBytes);
+// A board of a multi-board upload, driven by a thread of its own.
+struct Board
+{
+	const char* portName;
+	char settingsKey[256];
+	LPTBackend* pBackend;
+	CommPort* pPort;
+	uint32 cpu;
+	uint64 txDelayNS; // Calibrated delay, or zero to keep the option or default.
+
+	// The same for every board.
+	const std::vector<PipelineImage>* pImages;
+	UploadMode uploadMode;
+	bool bDelta;
+	bool bVerify;
+	bool bPush;
+
+	// Results. The rest of the results can be read once bDone is set.
+	PipelineProgress progress;
+	volatile bool bDone;
+	bool bSucceeded;
+	uint32 nRetries;
+	uint64 elapsedNS;
+};
+
+static void BoardThread (void* pParam)
+{
+	Board& board = *(Board*)pParam;
+	uint64 startNS = PLATFORM_GetTimeNS ();
+
+	COMM_Init (board.pPort, board.cpu);
+	if (board.txDelayNS)
+		COMM_SetTXDelayNS (board.txDelayNS);
+	COMM_SetControlInversionMask (CONTROL_nAUTOFEED_i); // We have autofeed inverted on the PCB.
+	COMM_Reset ();
+
+	const std::vector<PipelineImage>& images = *board.pImages;
+	if (!Nop ())
+	{
+		snprintf (board.progress.errorMessage, sizeof(board.progress.errorMessage), board.bPush ?
+			"The program doesn't answer. Is the monitor installed? Operation timed out." :
+			"Bootloader device not in default state. Operation timed out.");
+	}
+	else if (PIPELINE_Upload (&images[0], (uint32)images.size(), board.uploadMode, board.bDelta ? board.settingsKey : NULL, board.bVerify, board.nRetries, &board.progress))
+	{
+		// Pushed assets are picked up by the program that's running.
+		board.bSucceeded = board.bPush || RebootRAM ();
+		if (!board.bSucceeded)
+			snprintf (board.progress.errorMessage, sizeof(board.progress.errorMessage), "Reboot timed out.");
+	}
+
+	board.elapsedNS = PLATFORM_GetTimeNS () - startNS;
+	PLATFORM_MemoryBarrier ();
+	board.bDone = true;
 }
 
+// Uploads the same images to several boards at once, with a thread per port, and shows their progress on a
+// single line. The port threads get a CPU each, as far as they go, so they don't slow each other down.
+static int UploadToBoards (const char* backendName, const std::vector<const char*>& portNames, const std::vector<PipelineImage>& images,
+                           UploadMode uploadMode, bool bDelta, bool bVerify, bool bPush, bool bTXDelaySet)
+{
+	const uint32 nBoards = (uint32)portNames.size();
+	const uint32 nCPUs = PLATFORM_GetNumCPUs ();
+	if (nBoards > nCPUs)
+		printf ("Warning: %u boards, but only %u CPUs. The boards will slow each other down.\n", nBoards, nCPUs);
+
+	std::vector<Board> boards (nBoards);
+	bool bCreated = true;
+	for (uint32 i=0; i<nBoards; i++)
+	{
+		Board& board = boards[i];
+		board.portName = portNames[i];
+		MakeSettingsKey (board.settingsKey, sizeof(board.settingsKey), backendName, board.portName);
+		board.pBackend = bCreated ? CreateBackend (backendName, board.portName) : NULL;
+		board.pPort = board.pBackend ? COMM_CreatePort (board.pBackend) : NULL;
+		board.cpu = i % nCPUs;
+		board.txDelayNS = 0;
+		board.pImages = &images;
+		board.uploadMode = uploadMode;
+		board.bDelta = bDelta;
+		board.bVerify = bVerify;
+		board.bPush = bPush;
+		board.progress.imageIdx = 0;
+		board.progress.nImageBytes = 0;
+		board.progress.nDoneBytes = 0;
+		board.progress.errorMessage[0] = 0;
+		board.bDone = false;
+		board.bSucceeded = false;
+		board.nRetries = 0;
+		board.elapsedNS = 0;
+		bCreated = bCreated && board.pBackend;
+
+		if (!bTXDelaySet && SETTINGS_LoadTXDelay (board.settingsKey, board.txDelayNS))
+			printf ("Board %u: using calibrated TX delay of " FMT_U64 " nanoseconds.\n", i+1, board.txDelayNS);
+	}
+
+	// Start uploading.
+	std::vector<PlatformThread*> threads;
+	for (uint32 i=0; i<nBoards && bCreated; i++)
+	{
+		PlatformThread* pThread = PLATFORM_StartThread (BoardThread, &boards[i]);
+		if (!pThread)
+		{
+			printf ("Couldn't start the thread for board %u!\n", i+1);
+			bCreated = false;
+			break;
+		}
+		threads.push_back (pThread);
+	}
+
+	// Boards that couldn't start are left alone; the others finish what they started.
+	uint64 startNS = PLATFORM_GetTimeNS ();
+	size_t lineLength = 0;
+	while (!threads.empty())
+	{
+		bool bAllDone = true;
+		std::string line;
+		for (uint32 i=0; i<threads.size(); i++)
+		{
+			const Board& board = boards[i];
+			char status[64];
+			if (board.bDone)
+				snprintf (status, sizeof(status), "[%u] %s", i+1, board.bSucceeded ? "done" : "failed");
+			else
+			{
+				const PipelineProgress& progress = board.progress;
+				uint32 nImageBytes = progress.nImageBytes;
+				uint32 percent = nImageBytes ? (uint32)((uint64)progress.nDoneBytes * 100 / nImageBytes) : 0;
+				snprintf (status, sizeof(status), "[%u] %s %3u%%", i+1, images[progress.imageIdx].description, percent);
+				bAllDone = false;
+			}
+
+			line += (i ? "  " : "");
+			line += status;
+		}
+
+		// Pad with spaces to clear what's left of the previous line.
+		printf ("\r%s%*s", line.c_str(), (int)(lineLength > line.size() ? lineLength - line.size() : 0), "");
+		fflush (stdout);
+		lineLength = line.size();
+		if (bAllDone)
+			break;
+		PLATFORM_SleepMS (100);
+	}
+	uint64 elapsedNS = PLATFORM_GetTimeNS () - startNS;
+	if (!threads.empty())
+		printf ("\n");
+
+	uint32 nSucceeded = 0;
+	for (uint32 i=0; i<threads.size(); i++)
+	{
+		PLATFORM_JoinThread (threads[i]);
+
+		const Board& board = boards[i];
+		printf ("Board %u (%s): ", i+1, board.settingsKey);
+		if (board.bSucceeded)
+			printf ("done in %.1f seconds.\n", board.elapsedNS / 1e9);
+		else
+			printf ("%s\n", board.progress.errorMessage);
+		if (board.nRetries)
+			printf ("  Resent %u damaged block(s).\n", board.nRetries);
+		PrintSimStats (board.pBackend);
+		if (board.bSucceeded && !board.bPush)
+			PrintSimReboot (board.pBackend);
+		nSucceeded += board.bSucceeded ? 1 : 0;
+	}
+	if (!threads.empty())
+		printf ("%u of %u boards done in %.1f seconds.\n", nSucceeded, nBoards, elapsedNS / 1e9);
+
+	for (uint32 i=0; i<nBoards; i++)
+	{
+		if (boards[i].pPort)
+			COMM_DestroyPort (boards[i].pPort);
+		delete boards[i].pBackend;
+	}
+
+	return nSucceeded == nBoards ? 0 : 1;
+}
+
+#ifdef _WIN32
+static const char defaultBackend[] = "inpout32";
+#else
+static const char defaultBackend[] = "ppdev";
+#endif
+
 // Options:
-// -port <lpt port>; default 0x378.
-// -txdelay <ns>; default 50000.
+// -backend <inpout32|ppdev|fake|sim>; default inpout32 on Windows, ppdev on Linux.
+// -port <lpt port>; default 0x378 (inpout32) or /dev/parport0 (ppdev). Timing overrides for sim, see lpt_sim.h.
+//  Repeat it to upload to several boards at once, one per port.
+// -txdelay <ns>; default is the calibrated delay for the port, or 50000.
 // -txtimeout <ms>; default 0 (disabled).
 // -debugdelay (ms); default 0 (disabled).
 // -console; reads debug output instead of exiting.
+// -log <prefix>; like -console, but also decodes SDK log records into <prefix>-<channel>.log files.
+// -framed; uploads in CRC checked blocks, resending damaged blocks. Needs bootloader V0.9C.
+// -compress; uploads LZ compressed images, which the bootloader unpacks and checks. Needs bootloader V0.9C.
+// -delta; only sends what changed since the last upload to the port, then checks ram. Needs bootloader V0.9C.
+// -verify; checks the CRC of every image and segment in ram before rebooting. Needs bootloader V0.9E.
+// -calibrate; finds and stores the smallest reliable TX delay for the port. Needs bootloader V0.9C.
+// -stats[=json]; prints transfer statistics (handshake timing percentiles, throughput, retries) at the end.
+// -manifest <file>; also uploads the segments in the manifest to tile, palette, sprite or other ram (see manifest.h). Needs bootloader V0.9D.
+// -dump <address> <length> <file>; reads memory (ram, video ram or rom) into a file, checked with CRCs. Needs bootloader V0.9D.
+// -push; sends the arguments (address and file pairs) and manifest segments to the SDK monitor (monitor.h) of the running program, without a reboot.
 
 int main (int argc, char** argv)
 {
@@ -72,53 +435,69 @@ int main (int argc, char** argv)
 
 	// Parse options.
 	bool bConsoleSet = false;
-	bool bPortSet = false;
 	bool bTXDelaySet = false;
 	bool bTXTimeOutSet = false;
 	bool bDebugDelaySet = false;
-
-	// Arguments.
+	bool bFramedSet = false;
+	bool bCompressSet = false;
+	bool bDeltaSet = false;
+	bool bVerifySet = false;
+	bool bCalibrateSet = false;
+	bool bPushSet = false;
+	const char* backendName = NULL;
+	std::vector<const char*> portNames;
+	const char* logPrefix = NULL;
+	const char* manifestName = NULL;
+	const char* dumpArgs[3] = { NULL, NULL, NULL };
+	const char* profileLog = NULL;
+	bool bStatsSet = false;
+	bool bStatsJSON = false;
+
+	// Arguments. Images, or address and file pairs with -push.
+	std::vector<const char*> arguments;
 	const char* mainRamImage = NULL;
 	const char* subRamImage = NULL;
 
 	for (int32 i=1; i<argc; i++)
 	{
 		const char* arg = argv[i];
+#ifdef _WIN32
 		if (arg[0] == '-' || arg[0] == '/')
+#else
+		if (arg[0] == '-') // Paths start with a slash here.
+#endif
 		{
-			// Option.
+			// Option. Also accept GNU style double dashes.
 			arg++;
+			if (arg[0] == '-')
+				arg++;
 			if (stricmp (arg, "port") == 0)
 			{
-				if (bPortSet)
-				{
-					printf ("Port already set!\n");
-					return 1;
-				}
-				else if (i+1==argc)
+				if (i+1==argc)
 				{
 					printf ("Port option needs argument!\n");
 					return 1;
 				}
 				else
 				{
+					// Validated when the backend is created. More than one means more than one board.
 					i++;
-					uint32 port;
-					if (sscanf (argv[i], "0x%x", &port) == 1 || 
-						sscanf (argv[i], "0x%X", &port) == 1 || 
-						sscanf (argv[i], "%u",   &port) == 1)
-					{
-						if (port == 378) 
-							printf ("Warning: did you mean to use hexadecimal (0x378) notation?\n");
-						LPT_SetBasePort (port);
-						bPortSet = true;
-					}
-					else
-					{
-						printf ("Port option needs a valid positive value!\n");
-						return 1;
-					}
+					portNames.push_back (argv[i]);
+				}
+			}
+			else if (stricmp (arg, "backend") == 0)
+			{
+				if (backendName)
+				{
+					printf ("Backend already set!\n");
+					return 1;
 				}
+				else if (i+1==argc)
+				{
+					printf ("Backend option needs argument!\n");
+					return 1;
+				}
+				else backendName = argv[++i];
 			}
 			else if (stricmp (arg, "txdelay") == 0)
 			{
@@ -136,7 +515,7 @@ int main (int argc, char** argv)
 				{
 					i++;
 					uint64 txDelay;
-					if (sscanf (argv[i], "%I64u", &txDelay) == 1)
+					if (sscanf (argv[i], FMT_U64, &txDelay) == 1)
 					{
 						COMM_SetTXDelayNS (txDelay);
 						bTXDelaySet = true;
@@ -215,168 +594,412 @@ int main (int argc, char** argv)
 				}
 				else bConsoleSet = true;
 			}
+			else if (stricmp (arg, "stats") == 0 || stricmp (arg, "stats=json") == 0)
+			{
+				if (bStatsSet)
+				{
+					printf ("Stats parameter already specified!\n");
+					return 1;
+				}
+				bStatsSet = true;
+				bStatsJSON = stricmp (arg, "stats=json") == 0;
+			}
+			else if (stricmp (arg, "log") == 0)
+			{
+				if (logPrefix)
+				{
+					printf ("Log prefix already set!\n");
+					return 1;
+				}
+				else if (i+1==argc)
+				{
+					printf ("Log option needs argument!\n");
+					return 1;
+				}
+				else logPrefix = argv[++i];
+			}
+			else if (stricmp (arg, "manifest") == 0)
+			{
+				if (manifestName)
+				{
+					printf ("Manifest already set!\n");
+					return 1;
+				}
+				else if (i+1==argc)
+				{
+					printf ("Manifest option needs argument!\n");
+					return 1;
+				}
+				else manifestName = argv[++i];
+			}
+			else if (stricmp (arg, "framed") == 0)
+			{
+				if (bFramedSet)
+				{
+					printf ("Framed parameter already specified!\n");
+					return 1;
+				}
+				else bFramedSet = true;
+			}
+			else if (stricmp (arg, "compress") == 0)
+			{
+				if (bCompressSet)
+				{
+					printf ("Compress parameter already specified!\n");
+					return 1;
+				}
+				else bCompressSet = true;
+			}
+			else if (stricmp (arg, "delta") == 0)
+			{
+				if (bDeltaSet)
+				{
+					printf ("Delta parameter already specified!\n");
+					return 1;
+				}
+				else bDeltaSet = true;
+			}
+			else if (stricmp (arg, "verify") == 0)
+			{
+				if (bVerifySet)
+				{
+					printf ("Verify parameter already specified!\n");
+					return 1;
+				}
+				else bVerifySet = true;
+			}
+			else if (stricmp (arg, "calibrate") == 0)
+			{
+				if (bCalibrateSet)
+				{
+					printf ("Calibrate parameter already specified!\n");
+					return 1;
+				}
+				else bCalibrateSet = true;
+			}
+			else if (stricmp (arg, "dump") == 0)
+			{
+				if (dumpArgs[0])
+				{
+					printf ("Dump already set!\n");
+					return 1;
+				}
+				else if (i+3>=argc)
+				{
+					printf ("Dump option needs an address, a length and a file!\n");
+					return 1;
+				}
+				else
+				{
+					dumpArgs[0] = argv[++i];
+					dumpArgs[1] = argv[++i];
+					dumpArgs[2] = argv[++i];
+				}
+			}
+			else if (stricmp (arg, "profile") == 0)
+			{
+				if (profileLog)
+				{
+					printf ("Profile log already set!\n");
+					return 1;
+				}
+				else if (i+1==argc)
+				{
+					printf ("Profile option needs a log file!\n");
+					return 1;
+				}
+				else profileLog = argv[++i];
+			}
+			else if (stricmp (arg, "push") == 0)
+			{
+				if (bPushSet)
+				{
+					printf ("Push parameter already specified!\n");
+					return 1;
+				}
+				else bPushSet = true;
+			}
 		}
 		else
 		{
 			// Argument.
-			if (!mainRamImage)
-				mainRamImage = argv[i];
-			else if (!subRamImage)
-				subRamImage = argv[i];
-			else
-			{
-				printf ("Too many arguments! Only a main and sub image are required.\n");
-				return 1;
-			}
+			arguments.push_back (argv[i]);
 		}
 	}
 
-	if (!mainRamImage)
+	// Pushed segments are checked along with the manifest, below.
+	if (!bPushSet)
+	{
+		if (arguments.size() > 2)
+		{
+			printf ("Too many arguments! Only a main and sub image are required.\n");
+			return 1;
+		}
+		if (arguments.size() > 0)
+			mainRamImage = arguments[0];
+		if (arguments.size() > 1)
+			subRamImage = arguments[1];
+	}
+	else if (arguments.size() % 2)
+	{
+		printf ("Push needs an address and a file for each segment!\n");
+		return 1;
+	}
+
+	// Profiles are made from a log, without a board.
+	if (profileLog && mainRamImage)
+		return PROFILE_Report (profileLog, mainRamImage, subRamImage) ? 0 : 1;
+
+	if (!mainRamImage && !manifestName && !bCalibrateSet && !dumpArgs[0] && (!bPushSet || arguments.empty()))
 	{
 		// Print options.
 		printf ("Usage: orboot [-options] main.bin [sub.bin]\n");
-		printf ("Options: -port        Set the LPT port number (default: 0x378).\n");
-		printf ("         -txdelay     Sets the strobe delay in nanoseconds (default: 50000).\n");
+		printf ("       orboot [-options] -manifest segments.txt [main.bin [sub.bin]]\n");
+		printf ("       orboot [-options] -push [-manifest segments.txt] [address file ...]\n");
+		printf ("       orboot [-options] -dump address length file\n");
+		printf ("       orboot [-options] -calibrate\n");
+		printf ("       orboot -profile prefix-254.log maincpu_ram.map [subcpu_ram.map]\n");
+		printf ("Options: -backend     Port access: inpout32, ppdev, fake or sim (default: %s).\n", defaultBackend);
+		printf ("         -port        Set the LPT port (default: 0x378 or /dev/parport0), or sim timing.\n");
+		printf ("                      Repeat it to upload to several boards at once.\n");
+		printf ("         -txdelay     Sets the strobe delay in nanoseconds (default: calibrated or 50000).\n");
 		printf ("         -debugdelay  Sets a debug delay in milliseconds between transitions.\n");
 		printf ("         -txtimeout   Sets a timeout delay in milliseconds (0=disabled).\n");
 		printf ("         -console     Keeps the console open and prints nibble mode output.\n");
+		printf ("         -log         Like -console, and writes SDK log channels to <prefix>-<channel>.log.\n");
+		printf ("         -framed      Uploads in CRC checked blocks and resends damaged ones.\n");
+		printf ("         -compress    Uploads compressed images, which are checked after unpacking.\n");
+		printf ("         -delta       Only sends what changed since the last upload, then checks ram.\n");
+		printf ("         -verify      Checks the CRC of everything that was uploaded before rebooting.\n");
+		printf ("         -calibrate   Finds and stores the smallest reliable strobe delay for the port.\n");
+		printf ("         -stats       Prints transfer statistics at the end; -stats=json prints them as JSON.\n");
+		printf ("         -manifest    Also uploads the segments listed in the file, e.g. to tile or palette ram.\n");
+		printf ("         -dump        Reads memory into a file, e.g. -dump main 0x8000 ram.bin or -dump 0x200000 0x1000 sub.bin.\n");
+		printf ("         -push        Sends segments to the SDK monitor of the running program, without a reboot.\n");
+		printf ("         -profile     Prints a profile from the samples in a log written with -log (see profile.h in the SDK).\n");
+		printf ("       Images can be ELF files too (ld --oformat elf32-m68k); only their loadable bytes are sent, and\n");
+		printf ("       .bss and other zeros are filled in by the bootloader.\n");
 		return 1;
 	}
 
-	if (!bTXTimeOutSet)
-		COMM_SetTXTimeOutMS (10*1000); // 10 second default timeout.
-
-	// Load images from disk into memory.
-	HANDLE hMain = CreateFile (mainRamImage, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
-	if (hMain == INVALID_HANDLE_VALUE)
+	// The monitor only takes uploads.
+	if (bVerifySet && bPushSet)
 	{
-		printf ("Main ram image '%s' not found!\n", mainRamImage);
+		printf ("Pushed segments can't be verified; the monitor only takes uploads.\n");
 		return 1;
 	}
 
-	LARGE_INTEGER mainRamSize;
-	if (!GetFileSizeEx (hMain, &mainRamSize) || mainRamSize.QuadPart > 32*1024)
+	// Several boards are only ever uploaded to.
+	const char* portName = portNames.empty() ? NULL : portNames[0];
+	if (portNames.size() > 1 && (bCalibrateSet || dumpArgs[0] || bConsoleSet || logPrefix || bStatsSet))
 	{
-		printf ("Invalid size for main ram image '%s'!\n", mainRamImage);
-		CloseHandle (hMain);
+		printf ("Calibrate, dump, console, log and stats only work with a single port!\n");
 		return 1;
 	}
 
-	uint8* mainRamData = new uint8[(size_t)mainRamSize.QuadPart];
-	DWORD bytesRead;
-	if (!ReadFile (hMain, mainRamData, (uint32)mainRamSize.QuadPart, &bytesRead, NULL) || bytesRead != (uint32)mainRamSize.QuadPart)
+	if (!bTXTimeOutSet)
+		COMM_SetTXTimeOutMS (10*1000); // 10 second default timeout.
+
+	// Framed uploads wait for replies, which shouldn't take forever either.
+	if (bFramedSet || bCompressSet || bDeltaSet || bVerifySet || bCalibrateSet || manifestName || bPushSet || dumpArgs[0])
+		COMM_SetRXTimeOutMS (10*1000);
+
+	if (!backendName)
+		backendName = defaultBackend;
+	char settingsKey[256];
+	MakeSettingsKey (settingsKey, sizeof(settingsKey), backendName, portName);
+
+	if (bCalibrateSet)
+		return Calibrate (backendName, portName, settingsKey, bTXDelaySet);
+
+	// With several boards, every port has its own.
+	if (!bTXDelaySet && portNames.size() < 2)
 	{
-		printf ("Error reading main ram image '%s'!\n", mainRamImage);
-		delete[] mainRamData;
-		CloseHandle (hMain);
-		return 1;
+		uint64 txDelay;
+		if (SETTINGS_LoadTXDelay (settingsKey, txDelay))
+		{
+			printf ("Using calibrated TX delay of " FMT_U64 " nanoseconds.\n", txDelay);
+			COMM_SetTXDelayNS (txDelay);
+		}
 	}
 
-	CloseHandle (hMain);
-	hMain = INVALID_HANDLE_VALUE;
-
-	uint8* subRamData = NULL;
-	LARGE_INTEGER subRamSize = { 0 };
-	if (subRamImage)
+	if (dumpArgs[0])
 	{
-		HANDLE hSub = CreateFile (subRamImage, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
-		if (hSub == INVALID_HANDLE_VALUE)
+		uint32 address, nBytes;
+		if (!MANIFEST_ParseAddress (dumpArgs[0], address) || !MANIFEST_ParseNumber (dumpArgs[1], nBytes) || !nBytes)
 		{
-			printf ("Sub ram image '%s' not found!\n", subRamImage);
-			delete[] mainRamData;
+			printf ("Dump needs an address (a number or a region name, like main or tile+0x100) and a length!\n");
 			return 1;
 		}
-
-		if (!GetFileSizeEx (hSub, &subRamSize) || subRamSize.QuadPart > 32*1024)
+		if (!MANIFEST_FindRegion (address, nBytes, false))
 		{
-			printf ("Invalid size for sub ram image '%s'!\n", subRamImage);
-			delete[] mainRamData;
-			CloseHandle (hSub);
+			printf ("Can't read 0x%x bytes from 0x%06x; the range has to be within ram, video ram or rom.\n", nBytes, address);
 			return 1;
 		}
 
-		subRamData = new uint8[(uint32)subRamSize.QuadPart];
-		if (!ReadFile (hSub, subRamData, (uint32)subRamSize.QuadPart, &bytesRead, NULL) || bytesRead != (uint32)subRamSize.QuadPart)
+		return Dump (backendName, portName, address, nBytes, dumpArgs[2]);
+	}
+
+	UploadMode uploadMode = bCompressSet ? UPLOAD_COMPRESSED : (bFramedSet ? UPLOAD_FRAMED : UPLOAD_PLAIN);
+
+	// Images are loaded while uploading, see pipeline.h. Segments go after the program images.
+	std::vector<PipelineImage> images;
+	if (mainRamImage)
+	{
+		PipelineImage image = { mainRamImage, "main ram", BLOCK_TARGET_MAIN, 0 };
+		images.push_back (image);
+	}
+	if (subRamImage)
+	{
+		PipelineImage image = { subRamImage, "sub ram", BLOCK_TARGET_SUB, 0 };
+		images.push_back (image);
+	}
+
+	std::vector<ManifestSegment> segments;
+	std::vector<std::string> segmentDescriptions;
+	if (manifestName && !MANIFEST_Load (manifestName, segments))
+		return 1;
+	if (bPushSet)
+	{
+		for (size_t i=0; i<arguments.size(); i+=2)
 		{
-			printf ("Error reading sub ram image '%s'!\n", subRamImage);
-			delete[] mainRamData;
-			delete[] subRamData;
-			CloseHandle (hSub);
-			return 1;
+			ManifestSegment segment;
+			if (!MANIFEST_ParseAddress (arguments[i], segment.address) || !MANIFEST_FindRegion (segment.address, 1, true))
+			{
+				printf ("'%s' is not a writable address.\n", arguments[i]);
+				return 1;
+			}
+			segment.fileName = arguments[i+1];
+			segments.push_back (segment);
 		}
+	}
 
-		CloseHandle (hSub);
+	if (!segments.empty())
+	{
+		// Descriptions first, so the strings don't move anymore.
+		for (size_t i=0; i<segments.size(); i++)
+		{
+			const MemoryRegion* pRegion = MANIFEST_FindRegion (segments[i].address, 1, true);
+			if (bPushSet && !pRegion->bVideo)
+			{
+				printf ("Can't push to %s ram; the monitor only writes to tile, text, palette and sprite ram.\n", pRegion->name);
+				return 1;
+			}
+
+			uint32 offset = segments[i].address - pRegion->address;
+			char description[64];
+			if (offset)
+				snprintf (description, sizeof(description), "%s+0x%x", pRegion->name, offset);
+			else
+				snprintf (description, sizeof(description), "%s ram", pRegion->name);
+			segmentDescriptions.push_back (description);
+		}
+		for (size_t i=0; i<segments.size(); i++)
+		{
+			PipelineImage image = { segments[i].fileName.c_str(), segmentDescriptions[i].c_str(), BLOCK_TARGET_MAIN, segments[i].address };
+			images.push_back (image);
+		}
 	}
 
+	if (portNames.size() > 1)
+		return UploadToBoards (backendName, portNames, images, uploadMode, bDeltaSet, bVerifySet, bPushSet, bTXDelaySet);
+
+	LPTBackend* pBackend = CreateBackend (backendName, portName);
+	if (!pBackend)
+		return 1;
+	LPT_SetBackend (pBackend);
+
 	// Start uploading.
 	COMM_Init ();
 	COMM_SetControlInversionMask (CONTROL_nAUTOFEED_i); // We have autofeed inverted on the PCB.
+	COMM_EnableTelemetry (bStatsSet);
 	COMM_Reset ();
 
+	// The monitor ignores the NOP, but it does tell us whether anything is listening.
 	bool bError = false;
+	uint32 nRetries = 0;
 	printf ("Initializing...");
 	if (!Nop())
 	{
-		printf ("\nBootloader device not in default state. Operation timed out.\n");
+		if (bPushSet)
+			printf ("\nThe program doesn't answer. Is the monitor installed? Operation timed out.\n");
+		else
+			printf ("\nBootloader device not in default state. Operation timed out.\n");
 		bError = true;
 	}
 	else
 	{
-		// Start uploading.
-		printf ("\nUploading to main ram (%d bytes)...", (uint32)mainRamSize.QuadPart);
-		if (!UploadMainRam (mainRamData, (uint16)mainRamSize.QuadPart))
-		{
-			printf ("\nUpload to main ram timed out.\n");
-			bError = true;
-		}
-		else
-		{
-			printf ("\n");
-			if (subRamData)
-			{
-				printf ("Uploading to sub ram (%d bytes)...", (uint32)subRamSize.QuadPart);
-				if (!UploadSubRam (subRamData, (uint16)subRamSize.QuadPart))
-				{
-					printf ("\nUpload to sub ram timed out.\n");
-					bError = true;
-				}
-				else printf ("\n");
-			}
-		}
+		printf ("\n");
+		bError = !PIPELINE_Upload (&images[0], (uint32)images.size(), uploadMode, bDeltaSet ? settingsKey : NULL, bVerifySet, nRetries);
 	}
 
-	delete[] mainRamData;
-	if (subRamData)
-		delete[] subRamData;
+	if (nRetries)
+		printf ("Resent %u damaged block(s).\n", nRetries);
+	PrintSimStats (pBackend);
+	if (bStatsSet)
+		STATS_Print (settingsKey, bStatsJSON);
 
 	if (bError)
+	{
+		delete pBackend;
 		return 1;
+	}
 
-	printf ("Rebooting to ram...");
-	if (!RebootRAM ())
+	// Pushed assets are picked up by the program that's running.
+	if (!bPushSet)
 	{
-		printf ("\nReboot timed out.\n");
-		return 1;
+		printf ("Rebooting to ram...");
+		if (!RebootRAM ())
+		{
+			printf ("\nReboot timed out.\n");
+			delete pBackend;
+			return 1;
+		}
+		printf ("\n");
+		PrintSimReboot (pBackend);
 	}
-	printf ("\n");
 
-	if (bConsoleSet)
+	if (bConsoleSet || logPrefix)
 	{
-		// Handle console output.
+		// Handle console output. We'll wait for as long as it takes.
+		COMM_SetRXTimeOutMS (0);
 		printf ("\n");
-		SetThreadPriority (GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+		PLATFORM_SetLowPriority ();
+
+		// Log records are decoded here, and written to disk by another thread.
+		ConsoleLog* pLog = NULL;
+		if (logPrefix)
+		{
+			pLog = CONSOLE_StartLog (logPrefix);
+			if (!pLog)
+			{
+				printf ("Couldn't start the log writer thread!\n");
+				delete pBackend;
+				return 1;
+			}
+		}
 
 		for (;;)
 		{
 			int16 byte = COMM_RecvByte ();
 			if (byte == -1)
 			{
+				if (pLog)
+					CONSOLE_StopLog (pLog);
 				printf ("\n\nRead timed out. Shouldn't happen.\n");
+				delete pBackend;
 				return 1;
 			}
-			putchar (byte);
+
+			if (pLog)
+			{
+				uint8 data = (uint8)byte;
+				CONSOLE_Receive (pLog, &data, 1);
+			}
+			else putchar (byte);
 		}
 	}
 
+	delete pBackend;
 	return 0;
 }
@@ -0,0 +1,124 @@
+#include <Platform.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "manifest.h"
+
+// Keep in sync with _read_regions and _upload_regions in boot.s.
+static const MemoryRegion s_regions[] =
+{
+	{ "rom",     0x000000, 0x60000, false, false },
+	{ "main",    0x060000, 0x8000,  true,  false },
+	{ "tile",    0x100000, 0x10000, true,  true },
+	{ "text",    0x110000, 0x1000,  true,  true },
+	{ "palette", 0x120000, 0x2000,  true,  true },
+	{ "sprite",  0x130000, 0x1000,  true,  true },
+	{ "subrom",  0x200000, 0x60000, false, false },
+	{ "sub",     0x260000, 0x8000,  true,  false },
+};
+
+static const uint32 kNumRegions = sizeof(s_regions) / sizeof(s_regions[0]);
+
+bool MANIFEST_ParseNumber (const char* text, uint32& value)
+{
+	if (!*text)
+		return false;
+
+	char* pEnd;
+	unsigned long parsed = strtoul (text, &pEnd, 0);
+	if (*pEnd || parsed > 0xffffffffUL)
+		return false;
+
+	value = (uint32)parsed;
+	return true;
+}
+
+bool MANIFEST_ParseAddress (const char* text, uint32& address)
+{
+	if (text[0] >= '0' && text[0] <= '9')
+		return MANIFEST_ParseNumber (text, address);
+
+	const char* pOffset = strchr (text, '+');
+	size_t nameLength = pOffset ? (size_t)(pOffset - text) : strlen (text);
+	for (uint32 i=0; i<kNumRegions; i++)
+	{
+		if (strlen (s_regions[i].name) != nameLength || strnicmp (text, s_regions[i].name, nameLength) != 0)
+			continue;
+
+		uint32 offset = 0;
+		if (pOffset && !MANIFEST_ParseNumber (pOffset + 1, offset))
+			return false;
+
+		address = s_regions[i].address + offset;
+		return true;
+	}
+
+	return false;
+}
+
+const MemoryRegion* MANIFEST_FindRegion (uint32 address, uint32 nBytes, bool bWrite)
+{
+	for (uint32 i=0; i<kNumRegions; i++)
+	{
+		const MemoryRegion& region = s_regions[i];
+		if ((region.bWritable || !bWrite) && address >= region.address && nBytes <= region.nBytes && address - region.address <= region.nBytes - nBytes)
+			return &region;
+	}
+
+	return NULL;
+}
+
+bool MANIFEST_Load (const char* fileName, std::vector<ManifestSegment>& segments)
+{
+	FILE* pFile = fopen (fileName, "r");
+	if (!pFile)
+	{
+		printf ("Couldn't open manifest '%s'!\n", fileName);
+		return false;
+	}
+
+	// Segment files are relative to the manifest.
+	std::string folder = fileName;
+	size_t slash = folder.find_last_of ("/\\");
+	folder = (slash == std::string::npos) ? "" : folder.substr (0, slash + 1);
+
+	char line[512];
+	for (uint32 lineNumber=1; fgets (line, sizeof(line), pFile); lineNumber++)
+	{
+		line[strcspn (line, "#\r\n")] = 0;
+
+		char addressText[64];
+		char segmentFile[512];
+		char extra[2];
+		int nFields = sscanf (line, "%63s %511s %1s", addressText, segmentFile, extra);
+		if (nFields <= 0)
+			continue;
+
+		ManifestSegment segment;
+		if (nFields != 2)
+		{
+			printf ("%s(%u): expected an address and a file name.\n", fileName, lineNumber);
+			fclose (pFile);
+			return false;
+		}
+		if (!MANIFEST_ParseAddress (addressText, segment.address) || !MANIFEST_FindRegion (segment.address, 1, true))
+		{
+			printf ("%s(%u): '%s' is not a writable address.\n", fileName, lineNumber, addressText);
+			fclose (pFile);
+			return false;
+		}
+
+		bool bAbsolute = segmentFile[0] == '/' || segmentFile[0] == '\\' || (segmentFile[0] && segmentFile[1] == ':');
+		segment.fileName = bAbsolute ? segmentFile : folder + segmentFile;
+		segments.push_back (segment);
+	}
+
+	fclose (pFile);
+	if (segments.empty ())
+	{
+		printf ("Manifest '%s' has no segments!\n", fileName);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,52 @@
+#ifndef __MANIFEST_H__
+#define __MANIFEST_H__
+
+#include <Platform.h>
+#include <string>
+#include <vector>
+
+// Segment manifests: data that is uploaded straight to where the program expects it (tiles, palettes, sprites,
+// tables in sub ram), so the program doesn't have to unpack it itself. A manifest is a text file with one
+// segment per line, an address and a file:
+//
+//   # Comments start with a hash.
+//   tile            tiles.bin
+//   palette+0x200   sprites.pal
+//   0x130000        sprites.bin
+//
+// Addresses are numbers (0x for hexadecimal) or region names with an optional offset. Relative file names
+// are relative to the folder of the manifest. Segments are sent with COMMAND_UPLOADADDRESS, which needs
+// bootloader V0.9D.
+
+// Memory the bootloader lets us read, like _read_regions in boot.s. Most of it can be written to as well
+// (_upload_regions).
+struct MemoryRegion
+{
+	const char* name;
+	uint32 address;
+	uint32 nBytes;
+	bool bWritable;
+	bool bVideo;     // The SDK monitor (monitor.h) can write here too, while the program runs.
+};
+
+struct ManifestSegment
+{
+	std::string fileName;
+	uint32 address;
+};
+
+// strtoul, but the whole string has to be a number.
+bool MANIFEST_ParseNumber (const char* text, uint32& value);
+
+// Parses a number, or a region name with an optional +offset.
+bool MANIFEST_ParseAddress (const char* text, uint32& address);
+
+// The region that holds all of address..address+nBytes-1, or NULL if there is none.
+// With bWrite, only regions that can be written to are considered.
+const MemoryRegion* MANIFEST_FindRegion (uint32 address, uint32 nBytes, bool bWrite);
+
+// Reads a manifest. Doesn't look at the segment files yet; the sizes are checked when they're uploaded.
+// Prints the reason on failure.
+bool MANIFEST_Load (const char* fileName, std::vector<ManifestSegment>& segments);
+
+#endif // __MANIFEST_H__
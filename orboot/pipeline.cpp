@@ -0,0 +1,579 @@
+#include <Platform.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "bootcmd.h"
+#include "comm.h"
+#include "crc32.h"
+#include "delta.h"
+#include "elf.h"
+#include "lz.h"
+#include "manifest.h"
+#include "settings.h"
+#include "spscqueue.h"
+#include "stats.h"
+#include "pipeline.h"
+
+static const uint32 kMaxImageSize = 32*1024;
+static const uint32 kQueueSize = 64; // Half an image in framed blocks, which is plenty to stay ahead.
+static const uint32 kMinFillRun = 32; // Shorter zero runs in ELF images are cheaper to send than to split a block for.
+
+// Work for the comm thread, in the order it has to be done.
+enum ItemType
+{
+	ITEM_BEGIN,      // Start of an image; nBytes is the image size.
+	ITEM_PLAIN,      // Plain upload of the whole image.
+	ITEM_BLOCK,      // Framed block at offset.
+	ITEM_SEGMENT,    // Block of a segment or ELF image at address, see UploadAddressBlock.
+	ITEM_FILL,       // Zeros for nBytes at address, see FillRegion.
+	ITEM_COMPRESSED, // Compressed image; nBytes is the compressed size, and crc is that of the image.
+	ITEM_CHECK,      // Delta upload done; check and repair ram.
+	ITEM_VERIFY,     // Compare the CRC of nBytes at address with crc.
+	ITEM_END,        // End of an image.
+	ITEM_ERROR,      // The producer gave up, see Pipeline::errorMessage. Nothing follows.
+};
+
+struct PipelineItem
+{
+	uint8 type;
+	uint8 imageIdx;
+	uint32 offset;       // In the image, for the progress.
+	const uint8* pData;
+	uint32 nBytes;
+	uint32 crc;
+	uint32 address;      // Of ITEM_SEGMENT, ITEM_FILL and ITEM_VERIFY.
+};
+
+struct PreparedImage
+{
+	const uint8* pMapped;
+	uint32 nBytes;
+	std::vector<uint8> compressed;
+	bool bELF;
+	ElfImage elf;
+	uint32 nFillBytes;   // Of an ELF image, left to FillRegion.
+};
+
+struct Pipeline
+{
+	const PipelineImage* pImages;
+	uint32 nImages;
+	UploadMode mode;
+	const char* cacheKey;
+	bool bVerify;
+	PipelineProgress* pProgress;         // NULL to print progress instead.
+
+	// Sized before the producer starts, so entries don't move. The producer fills an entry in before it pushes
+	// the first item that refers to it, and the consumer only reads it after popping that item; the barriers in
+	// the queue make that safe.
+	std::vector<PreparedImage> prepared;
+	SPSCQueue<PipelineItem, kQueueSize> queue;
+	volatile bool bAbort;                // Set by the comm thread when it gives up.
+	char errorMessage[512];
+
+	// Set by the comm thread when an image in ram doesn't match, or once it does.
+	bool bMismatch;
+	bool bVerified;
+	uint32 ramCrc;
+};
+
+static bool PushItem (Pipeline& pipeline, uint8 type, uint8 imageIdx, uint32 offset, const uint8* pData, uint32 nBytes, uint32 crc, uint32 address = 0)
+{
+	PipelineItem item = { type, imageIdx, offset, pData, nBytes, crc, address };
+
+	// The comm thread is a lot slower than we are, so there's no hurry when the queue is full.
+	while (!pipeline.queue.Push (item))
+	{
+		if (pipeline.bAbort)
+			return false;
+		PLATFORM_SleepMS (1);
+	}
+
+	return true;
+}
+
+static bool PushBlocks (Pipeline& pipeline, uint8 imageIdx, const uint8* pData, uint32 rangeOffset, uint32 rangeBytes)
+{
+	for (uint32 offset=0; offset<rangeBytes; offset+=kBlockSize)
+	{
+		uint32 blockSize = rangeBytes - offset;
+		if (blockSize > kBlockSize)
+			blockSize = kBlockSize;
+
+		if (!PushItem (pipeline, ITEM_BLOCK, imageIdx, rangeOffset + offset, pData + rangeOffset + offset, blockSize, 0))
+			return false;
+	}
+
+	return true;
+}
+
+// The CRC is calculated here, so the comm thread only has to ask for the one in ram.
+// Anything past nDataBytes, up to nBytes, should be zero.
+static bool PushVerify (Pipeline& pipeline, uint8 imageIdx, uint32 address, const uint8* pData, uint32 nDataBytes, uint32 nBytes)
+{
+	if (!pipeline.bVerify || !nBytes)
+		return true;
+
+	static const uint8 zeros[256] = { 0 };
+	uint32 crc = CRC32_Calc (pData, nDataBytes);
+	for (uint32 offset=nDataBytes; offset<nBytes; offset+=sizeof(zeros))
+		crc = CRC32_Calc (zeros, nBytes - offset < sizeof(zeros) ? nBytes - offset : sizeof(zeros), crc);
+
+	return PushItem (pipeline, ITEM_VERIFY, imageIdx, 0, pData, nBytes, crc, address);
+}
+
+// Where the first run of zeros from offset on starts and ends, if it's worth filling in instead of sending:
+// at least kMinFillRun bytes, or reaching past the file contents. Both are nMemBytes when there is none.
+static void FindZeroRun (const ElfSegment& segment, uint32 offset, uint32& zeroStart, uint32& zeroEnd)
+{
+	for (uint32 i=offset; i<segment.nMemBytes; )
+	{
+		if (i < segment.nFileBytes && segment.pData[i])
+		{
+			i++;
+			continue;
+		}
+
+		uint32 end = i + 1;
+		while (end < segment.nMemBytes && (end >= segment.nFileBytes || !segment.pData[end]))
+			end++;
+
+		if (end - i >= kMinFillRun || end > segment.nFileBytes)
+		{
+			zeroStart = i;
+			zeroEnd = end;
+			return;
+		}
+		i = end;
+	}
+
+	zeroStart = zeroEnd = segment.nMemBytes;
+}
+
+// ELF images go wherever their program headers say, as segments whatever the mode, and are never cached.
+// Only the file contents are sent; longer zero runs and .bss are filled in by the bootloader.
+static bool ProduceELF (Pipeline& pipeline, uint8 imageIdx)
+{
+	const PipelineImage& image = pipeline.pImages[imageIdx];
+	PreparedImage& prepared = pipeline.prepared[imageIdx];
+	const char* pReason;
+	if (!ELF_Parse (prepared.pMapped, prepared.nBytes, prepared.elf, pReason))
+	{
+		snprintf (pipeline.errorMessage, sizeof(pipeline.errorMessage), "Invalid ELF %s image '%s': %s!", image.description, image.fileName, pReason);
+		PushItem (pipeline, ITEM_ERROR, imageIdx, 0, NULL, 0, 0);
+		return false;
+	}
+
+	// Segments must land in the target cpu's own ram, or in the video ram both cpus share.
+	const char* pTargetRegion = image.target == BLOCK_TARGET_MAIN ? "main" : "sub";
+	const std::vector<ElfSegment>& segments = prepared.elf.segments;
+	uint32 nLoadBytes = 0;
+	for (size_t i=0; i<segments.size(); i++)
+	{
+		const ElfSegment& segment = segments[i];
+		const MemoryRegion* pRegion = MANIFEST_FindRegion (segment.address, segment.nMemBytes, true);
+		if (!pRegion || (!pRegion->bVideo && strcmp (pRegion->name, pTargetRegion) != 0))
+		{
+			snprintf (pipeline.errorMessage, sizeof(pipeline.errorMessage), "ELF %s image '%s' loads to 0x%06x..0x%06x, which isn't %s ram or video ram!",
+			          image.description, image.fileName, segment.address, segment.address + segment.nMemBytes - 1, pTargetRegion);
+			PushItem (pipeline, ITEM_ERROR, imageIdx, 0, NULL, 0, 0);
+			return false;
+		}
+		nLoadBytes += segment.nMemBytes;
+	}
+
+	// Whatever was cached for this target won't be in ram anymore.
+	if (pipeline.cacheKey)
+		SETTINGS_ClearCachedImage (pipeline.cacheKey, image.target == BLOCK_TARGET_MAIN ? "main" : "sub");
+
+	// Split everything up first, so the comm thread can tell how much is filled in when it starts.
+	std::vector<PipelineItem> items;
+	uint32 imageOffset = 0;
+	prepared.nFillBytes = 0;
+	for (size_t i=0; i<segments.size(); i++)
+	{
+		const ElfSegment& segment = segments[i];
+		for (uint32 offset=0; offset<segment.nMemBytes; )
+		{
+			uint32 zeroStart, zeroEnd;
+			FindZeroRun (segment, offset, zeroStart, zeroEnd);
+			for (; offset<zeroStart; offset+=kSegmentBlockSize)
+			{
+				uint32 blockSize = zeroStart - offset;
+				if (blockSize > kSegmentBlockSize)
+					blockSize = kSegmentBlockSize;
+
+				PipelineItem item = { ITEM_SEGMENT, imageIdx, imageOffset + offset, segment.pData + offset, blockSize, 0, segment.address + offset };
+				items.push_back (item);
+			}
+
+			if (zeroEnd > zeroStart)
+			{
+				PipelineItem item = { ITEM_FILL, imageIdx, imageOffset + zeroStart, NULL, zeroEnd - zeroStart, 0, segment.address + zeroStart };
+				items.push_back (item);
+				prepared.nFillBytes += zeroEnd - zeroStart;
+			}
+			offset = zeroEnd;
+		}
+		imageOffset += segment.nMemBytes;
+	}
+	prepared.bELF = true;
+
+	if (!PushItem (pipeline, ITEM_BEGIN, imageIdx, 0, prepared.pMapped, nLoadBytes, 0))
+		return false;
+
+	for (size_t i=0; i<items.size(); i++)
+	{
+		const PipelineItem& item = items[i];
+		if (!PushItem (pipeline, item.type, imageIdx, item.offset, item.pData, item.nBytes, item.crc, item.address))
+			return false;
+	}
+
+	for (size_t i=0; i<segments.size(); i++)
+		if (!PushVerify (pipeline, imageIdx, segments[i].address, segments[i].pData, segments[i].nFileBytes, segments[i].nMemBytes))
+			return false;
+
+	return PushItem (pipeline, ITEM_END, imageIdx, 0, prepared.pMapped, nLoadBytes, 0);
+}
+
+static bool ProduceImage (Pipeline& pipeline, uint8 imageIdx)
+{
+	const PipelineImage& image = pipeline.pImages[imageIdx];
+	PreparedImage& prepared = pipeline.prepared[imageIdx];
+	prepared.pMapped = PLATFORM_MapFile (image.fileName, prepared.nBytes);
+	if (!prepared.pMapped)
+	{
+		snprintf (pipeline.errorMessage, sizeof(pipeline.errorMessage), "Couldn't open %s image '%s'!", image.description, image.fileName);
+		PushItem (pipeline, ITEM_ERROR, imageIdx, 0, NULL, 0, 0);
+		return false;
+	}
+
+	const uint8* pData = prepared.pMapped;
+	const uint32 nBytes = prepared.nBytes;
+	if (!image.address && ELF_IsELF (pData, nBytes))
+		return ProduceELF (pipeline, imageIdx);
+	if (image.address && !MANIFEST_FindRegion (image.address, nBytes ? nBytes : 1, true))
+	{
+		snprintf (pipeline.errorMessage, sizeof(pipeline.errorMessage), "Segment '%s' doesn't fit in %s!", image.fileName, image.description);
+		PushItem (pipeline, ITEM_ERROR, imageIdx, 0, NULL, 0, 0);
+		return false;
+	}
+	if (!image.address && nBytes > kMaxImageSize)
+	{
+		snprintf (pipeline.errorMessage, sizeof(pipeline.errorMessage), "Invalid size for %s image '%s'!", image.description, image.fileName);
+		PushItem (pipeline, ITEM_ERROR, imageIdx, 0, NULL, 0, 0);
+		return false;
+	}
+
+	if (!PushItem (pipeline, ITEM_BEGIN, imageIdx, 0, pData, nBytes, 0))
+		return false;
+
+	if (image.address)
+	{
+		for (uint32 offset=0; offset<nBytes; offset+=kSegmentBlockSize)
+		{
+			uint32 blockSize = nBytes - offset;
+			if (blockSize > kSegmentBlockSize)
+				blockSize = kSegmentBlockSize;
+
+			if (!PushItem (pipeline, ITEM_SEGMENT, imageIdx, offset, pData + offset, blockSize, 0, image.address + offset))
+				return false;
+		}
+
+		return PushVerify (pipeline, imageIdx, image.address, pData, nBytes, nBytes) &&
+		       PushItem (pipeline, ITEM_END, imageIdx, 0, pData, nBytes, 0);
+	}
+
+	UploadMode mode = pipeline.mode;
+	if (pipeline.cacheKey)
+	{
+		// Until the upload succeeds we don't know what's in ram.
+		const char* imageName = image.target == BLOCK_TARGET_MAIN ? "main" : "sub";
+		std::vector<uint8> previous;
+		bool bCached = SETTINGS_LoadCachedImage (pipeline.cacheKey, imageName, previous);
+		SETTINGS_ClearCachedImage (pipeline.cacheKey, imageName);
+		if (bCached && nBytes)
+		{
+			std::vector<DeltaRange> ranges;
+			DELTA_FindChangedRanges (previous.empty() ? NULL : &previous[0], (uint32)previous.size(), pData, nBytes, ranges);
+			for (size_t i=0; i<ranges.size(); i++)
+				if (!PushBlocks (pipeline, imageIdx, pData, ranges[i].offset, ranges[i].nBytes))
+					return false;
+
+			return PushItem (pipeline, ITEM_CHECK, imageIdx, 0, pData, nBytes, 0) &&
+			       PushItem (pipeline, ITEM_END, imageIdx, 0, pData, nBytes, 0);
+		}
+
+		// Delta uploads need bootloader V0.9C anyway, so there's no reason not to check.
+		if (mode == UPLOAD_PLAIN)
+			mode = UPLOAD_FRAMED;
+	}
+
+	// Nothing to unpack or check in an empty image, so send that the old way.
+	if (mode == UPLOAD_PLAIN || !nBytes)
+	{
+		if (!PushItem (pipeline, ITEM_PLAIN, imageIdx, 0, pData, nBytes, 0))
+			return false;
+	}
+	else if (mode == UPLOAD_FRAMED)
+	{
+		if (!PushBlocks (pipeline, imageIdx, pData, 0, nBytes))
+			return false;
+	}
+	else
+	{
+		LZ_Compress (pData, nBytes, prepared.compressed);
+		DEBUG_ASSERT(prepared.compressed.size() <= 0xffff); // Worst case is 129 bytes per 128.
+		if (!PushItem (pipeline, ITEM_COMPRESSED, imageIdx, 0, &prepared.compressed[0], (uint32)prepared.compressed.size(), CRC32_Calc (pData, nBytes)))
+			return false;
+	}
+
+	uint32 address = image.target == BLOCK_TARGET_MAIN ? kMainRamAddress : kSubRamAddress;
+	return PushVerify (pipeline, imageIdx, address, pData, nBytes, nBytes) &&
+	       PushItem (pipeline, ITEM_END, imageIdx, 0, pData, nBytes, 0);
+}
+
+static void ProducerThread (void* pParam)
+{
+	Pipeline& pipeline = *(Pipeline*)pParam;
+	for (uint32 i=0; i<pipeline.nImages; i++)
+		if (!ProduceImage (pipeline, (uint8)i))
+			break;
+}
+
+// Prints progress, unless the caller shows it.
+static void Report (const Pipeline& pipeline, const char* format, ...)
+{
+	if (pipeline.pProgress)
+		return;
+
+	va_list args;
+	va_start (args, format);
+	vprintf (format, args);
+	va_end (args);
+}
+
+// Prints why the upload failed, or hands it to the caller.
+static void Fail (const Pipeline& pipeline, const char* format, ...)
+{
+	va_list args;
+	va_start (args, format);
+	if (pipeline.pProgress)
+		vsnprintf (pipeline.pProgress->errorMessage, sizeof(pipeline.pProgress->errorMessage), format, args);
+	else
+	{
+		vprintf (format, args);
+		printf ("\n");
+	}
+	va_end (args);
+}
+
+// Sends a single item. Returns false on a timeout.
+static bool ConsumeItem (Pipeline& pipeline, const PipelineItem& item, uint32& nRetries, uint32& nSentBytes)
+{
+	const PipelineImage& image = pipeline.pImages[item.imageIdx];
+	switch (item.type)
+	{
+	case ITEM_BEGIN:
+	{
+		const PreparedImage& prepared = pipeline.prepared[item.imageIdx];
+		if (prepared.bELF)
+		{
+			const std::vector<ElfSection>& sections = prepared.elf.sections;
+			Report (pipeline, "ELF %s image '%s', entry point 0x%06x:\n", image.description, image.fileName, prepared.elf.entry);
+			for (size_t i=0; i<sections.size(); i++)
+				Report (pipeline, "  %-16s 0x%06x %6u bytes%s\n", sections[i].name.c_str (), sections[i].address, sections[i].nBytes, sections[i].bLoaded ? "" : " (zeroed)");
+			Report (pipeline, "Uploading to %s (%u bytes, %u of them filled in)...", image.description, item.nBytes, prepared.nFillBytes);
+		}
+		else
+			Report (pipeline, "Uploading to %s (%u bytes)...", image.description, item.nBytes);
+		nSentBytes = 0;
+		pipeline.bVerified = false;
+		return true;
+	}
+
+	case ITEM_PLAIN:
+		return image.target == BLOCK_TARGET_MAIN ? UploadMainRam (item.pData, (uint16)item.nBytes)
+		                                         : UploadSubRam (item.pData, (uint16)item.nBytes);
+
+	case ITEM_BLOCK:
+		nSentBytes += item.nBytes;
+		return UploadBlock (image.target, (uint16)item.offset, item.pData, (uint16)item.nBytes, nRetries, kMaxBlockRetries);
+
+	case ITEM_SEGMENT:
+		nSentBytes += item.nBytes;
+		return UploadAddressBlock (item.address, item.pData, item.nBytes, nRetries, kMaxBlockRetries);
+
+	case ITEM_FILL:
+		return FillRegion (item.address, item.nBytes, 0, nRetries);
+
+	case ITEM_COMPRESSED:
+	{
+		const PreparedImage& prepared = pipeline.prepared[item.imageIdx];
+		Report (pipeline, " %u bytes compressed (%u%%)", item.nBytes, item.nBytes * 100 / prepared.nBytes);
+		return UploadCompressedData (image.target, item.pData, (uint16)item.nBytes, (uint16)prepared.nBytes, item.crc, nRetries);
+	}
+
+	case ITEM_CHECK:
+	{
+		DeltaResult result = DELTA_CheckAndRepair (image.target, item.pData, item.nBytes, nRetries, nSentBytes);
+		if (result == DELTA_TIMEDOUT)
+			return false;
+		Report (pipeline, " %u bytes changed", nSentBytes);
+		if (result == DELTA_UPLOADED)
+			return true;
+
+		// Rare enough not to bother the producer with.
+		Report (pipeline, ", ram doesn't match, sending everything...");
+		return UploadFramed (image.target, item.pData, (uint16)item.nBytes, nRetries);
+	}
+
+	case ITEM_VERIFY:
+		// ELF images are checked per program header, but only the whole counts.
+		if (!CheckAddress (item.address, item.nBytes, pipeline.ramCrc))
+			return false;
+
+		pipeline.bMismatch = pipeline.ramCrc != item.crc;
+		pipeline.bVerified = !pipeline.bMismatch;
+		return pipeline.bVerified;
+
+	case ITEM_END:
+		Report (pipeline, pipeline.bVerified ? " verified\n" : "\n");
+		return true;
+	}
+
+	DEBUG_ASSERT(false);
+	return false;
+}
+
+bool PIPELINE_Upload (const PipelineImage* pImages, uint32 nImages, UploadMode mode, const char* cacheKey, bool bVerify, uint32& nRetries, PipelineProgress* pProgress)
+{
+	DEBUG_ASSERT(nImages);
+	Pipeline* pPipeline = new Pipeline;
+	Pipeline& pipeline = *pPipeline;
+	pipeline.pImages = pImages;
+	pipeline.nImages = nImages;
+	pipeline.mode = mode;
+	pipeline.cacheKey = cacheKey;
+	pipeline.bVerify = bVerify;
+	pipeline.pProgress = pProgress;
+	pipeline.prepared.resize (nImages);
+	for (uint32 i=0; i<nImages; i++)
+	{
+		pipeline.prepared[i].pMapped = NULL;
+		pipeline.prepared[i].bELF = false;
+		pipeline.prepared[i].nFillBytes = 0;
+	}
+	pipeline.bAbort = false;
+	pipeline.errorMessage[0] = 0;
+	pipeline.bMismatch = false;
+	pipeline.bVerified = false;
+	pipeline.ramCrc = 0;
+	if (pProgress)
+	{
+		pProgress->imageIdx = 0;
+		pProgress->nImageBytes = 0;
+		pProgress->nDoneBytes = 0;
+		pProgress->errorMessage[0] = 0;
+	}
+
+	PlatformThread* pProducer = PLATFORM_StartThread (ProducerThread, pPipeline);
+	if (!pProducer)
+	{
+		Fail (pipeline, "Couldn't start the producer thread!");
+		delete pPipeline;
+		return false;
+	}
+
+	bool bSucceeded = false;
+	uint32 nSentBytes = 0;
+	UploadStats upload = { NULL, 0, 0, 0, 0, false };
+	uint64 uploadStartNS = 0;
+	uint32 uploadStartSent = 0;
+	for (;;)
+	{
+		PipelineItem item;
+		if (!pipeline.queue.Pop (item))
+		{
+			// Only happens while the first image is being prepared, or when the disk is slow.
+			PLATFORM_SleepMS (0);
+			continue;
+		}
+
+		if (item.type == ITEM_ERROR)
+		{
+			Fail (pipeline, "%s", pipeline.errorMessage);
+			break;
+		}
+
+		// Statistics per image; the comm layer only counts the bytes when -stats is on.
+		if (item.type == ITEM_BEGIN)
+		{
+			upload.description = pImages[item.imageIdx].description;
+			upload.nBytes = item.nBytes;
+			upload.nRetries = nRetries;
+			uploadStartNS = PLATFORM_GetTimeNS ();
+			uploadStartSent = COMM_GetTelemetry ().sendByteNS.GetCount ();
+		}
+
+		bool bConsumed = ConsumeItem (pipeline, item, nRetries, nSentBytes);
+		if (!bConsumed || item.type == ITEM_END)
+		{
+			upload.nSentBytes = COMM_GetTelemetry ().sendByteNS.GetCount () - uploadStartSent;
+			upload.nRetries = nRetries - upload.nRetries;
+			upload.elapsedNS = PLATFORM_GetTimeNS () - uploadStartNS;
+			upload.bSucceeded = bConsumed;
+			if (!pProgress)
+				STATS_AddUpload (upload);
+		}
+
+		if (!bConsumed)
+		{
+			Report (pipeline, "\n");
+			if (pipeline.bMismatch)
+				Fail (pipeline, "Verify of %s failed: the CRC in ram is 0x%08x instead of 0x%08x.", pImages[item.imageIdx].description, pipeline.ramCrc, item.crc);
+			else
+				Fail (pipeline, "Upload to %s timed out.", pImages[item.imageIdx].description);
+			break;
+		}
+
+		if (pProgress)
+		{
+			// Blocks are sent in order, except for delta uploads, where this is only a rough guide.
+			if (item.type == ITEM_BEGIN)
+			{
+				pProgress->nDoneBytes = 0;
+				pProgress->nImageBytes = item.nBytes;
+				pProgress->imageIdx = item.imageIdx;
+			}
+			else if (item.type == ITEM_BLOCK || item.type == ITEM_SEGMENT || item.type == ITEM_FILL)
+				pProgress->nDoneBytes = item.offset + item.nBytes;
+			else if (item.type == ITEM_END)
+				pProgress->nDoneBytes = item.nBytes;
+		}
+
+		if (item.type == ITEM_END && item.imageIdx == nImages - 1)
+		{
+			bSucceeded = true;
+			break;
+		}
+	}
+
+	pipeline.bAbort = true;
+	PLATFORM_JoinThread (pProducer);
+
+	for (uint32 i=0; i<nImages; i++)
+	{
+		PreparedImage& prepared = pipeline.prepared[i];
+		if (!prepared.pMapped)
+			continue;
+
+		if (bSucceeded && cacheKey && !pImages[i].address && !prepared.bELF)
+			SETTINGS_SaveCachedImage (cacheKey, pImages[i].target == BLOCK_TARGET_MAIN ? "main" : "sub", prepared.pMapped, prepared.nBytes);
+		PLATFORM_UnmapFile (prepared.pMapped, prepared.nBytes);
+	}
+
+	delete pPipeline;
+	return bSucceeded;
+}
@@ -0,0 +1,48 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <Platform.h>
+
+// How images are sent to the bootloader.
+enum UploadMode
+{
+	UPLOAD_PLAIN,      // Plain upload commands, nothing is checked.
+	UPLOAD_FRAMED,     // CRC checked blocks, only damaged blocks are resent. Needs bootloader V0.9C.
+	UPLOAD_COMPRESSED, // LZ compressed, checked after unpacking. Needs bootloader V0.9C.
+};
+
+struct PipelineImage
+{
+	const char* fileName;
+	const char* description; // For messages, e.g. "main ram".
+	uint8 target;            // BLOCK_TARGET_MAIN or BLOCK_TARGET_SUB.
+	uint32 address;          // Non-zero for a segment (see manifest.h); target is ignored then.
+};
+
+// Progress of an upload, for callers that show it themselves, like when several boards are uploaded to at once.
+// The counters are updated by the comm thread, and can be read from any thread while the upload runs.
+struct PipelineProgress
+{
+	volatile uint32 imageIdx;
+	volatile uint32 nImageBytes;
+	volatile uint32 nDoneBytes;   // Of the current image.
+	char errorMessage[512];       // Why the upload failed, once PIPELINE_Upload returns.
+};
+
+// Uploads the images in order. A producer thread maps, validates and prepares the images (splitting them
+// into blocks, or compressing them) and hands them over through a lock-free queue, so the calling thread
+// only talks to the bootloader; the next image is prepared while the previous one is being sent.
+// Call this from the comm thread.
+// With a cache key, only the changes since the images cached for that key are sent (see delta.h), and the
+// cache is updated once everything is in ram.
+// Segments are always sent with COMMAND_UPLOADADDRESS, whatever the mode, and are never cached.
+// Images in ELF format (see elf.h) are sent like segments, to wherever their program headers say. Only the
+// file contents go over the wire; .bss and longer runs of zeros are filled in with COMMAND_FILLREGION.
+// With bVerify, the bootloader calculates the CRC of every image once it's in ram (see CheckAddress), which has
+// to match the one of the file. Delta uploads are checked like that anyway.
+// Prints progress, and the reason on failure. Resends are added to nRetries.
+// With pProgress, nothing is printed and no statistics are recorded (see stats.h), so several uploads can run
+// side by side.
+bool PIPELINE_Upload (const PipelineImage* pImages, uint32 nImages, UploadMode mode, const char* cacheKey, bool bVerify, uint32& nRetries, PipelineProgress* pProgress = NULL);
+
+#endif // __PIPELINE_H__
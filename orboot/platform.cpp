@@ -0,0 +1,237 @@
+#include <Platform.h>
+
+// Mapping an empty file fails, so we hand out this instead.
+static const uint8 s_emptyFile[1] = { 0 };
+
+#ifdef _WIN32
+
+static LARGE_INTEGER s_qpcFreq = { 0 };
+
+uint64 PLATFORM_GetTimeNS ()
+{
+	// QueryPerformanceCounter is about as accurate as we will get.
+	if (!s_qpcFreq.QuadPart)
+	{
+		BOOL qpfSucceeded = QueryPerformanceFrequency (&s_qpcFreq); // Well, this shouldn't fail.
+		DEBUG_ASSERT(qpfSucceeded && s_qpcFreq.QuadPart);
+	}
+
+	LARGE_INTEGER count;
+	QueryPerformanceCounter (&count);
+
+	// Split the conversion, so we don't overflow after a couple of hours of uptime.
+	uint64 seconds = count.QuadPart / s_qpcFreq.QuadPart;
+	uint64 remainder = count.QuadPart % s_qpcFreq.QuadPart;
+	return seconds * 1000000000 + (remainder * 1000000000) / s_qpcFreq.QuadPart;
+}
+
+uint32 PLATFORM_GetTickCountMS ()            { return GetTickCount (); }
+void   PLATFORM_SleepMS (uint32 milliseconds) { Sleep (milliseconds); }
+uint64 PLATFORM_GetCurrentThreadID ()         { return GetCurrentThreadId (); }
+void   PLATFORM_PinCurrentThread (uint32 cpu) { SetThreadAffinityMask (GetCurrentThread(), (DWORD_PTR)1 << cpu); }
+void   PLATFORM_SetLowPriority ()             { SetThreadPriority (GetCurrentThread(), THREAD_PRIORITY_LOWEST); }
+
+uint32 PLATFORM_GetNumCPUs ()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo (&info);
+	return info.dwNumberOfProcessors;
+}
+
+struct PlatformThread
+{
+	HANDLE handle;
+	PlatformThreadFunc pFunc;
+	void* pParam;
+};
+
+static DWORD WINAPI ThreadEntry (LPVOID pParam)
+{
+	PlatformThread* pThread = (PlatformThread*)pParam;
+	pThread->pFunc (pThread->pParam);
+	return 0;
+}
+
+PlatformThread* PLATFORM_StartThread (PlatformThreadFunc pFunc, void* pParam)
+{
+	PlatformThread* pThread = new PlatformThread;
+	pThread->pFunc = pFunc;
+	pThread->pParam = pParam;
+	pThread->handle = CreateThread (NULL, 0, ThreadEntry, pThread, 0, NULL);
+	if (!pThread->handle)
+	{
+		delete pThread;
+		return NULL;
+	}
+
+	return pThread;
+}
+
+void PLATFORM_JoinThread (PlatformThread* pThread)
+{
+	WaitForSingleObject (pThread->handle, INFINITE);
+	CloseHandle (pThread->handle);
+	delete pThread;
+}
+
+const uint8* PLATFORM_MapFile (const char* fileName, uint32& nBytes)
+{
+	HANDLE file = CreateFileA (fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	DWORD sizeHigh = 0;
+	DWORD size = GetFileSize (file, &sizeHigh);
+	if (size == INVALID_FILE_SIZE || sizeHigh)
+	{
+		CloseHandle (file);
+		return NULL;
+	}
+
+	nBytes = size;
+	if (!size)
+	{
+		CloseHandle (file);
+		return s_emptyFile;
+	}
+
+	// The view keeps the mapping and file open by itself.
+	HANDLE mapping = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle (file);
+	if (!mapping)
+		return NULL;
+
+	const uint8* pData = (const uint8*)MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle (mapping);
+	return pData;
+}
+
+void PLATFORM_UnmapFile (const uint8* pData, uint32 nBytes)
+{
+	if (pData != s_emptyFile)
+		UnmapViewOfFile (pData);
+}
+
+#else // _WIN32
+
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+uint64 PLATFORM_GetTimeNS ()
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((uint64)ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+uint32 PLATFORM_GetTickCountMS ()
+{
+	return (uint32)(PLATFORM_GetTimeNS () / 1000000);
+}
+
+void PLATFORM_SleepMS (uint32 milliseconds)
+{
+	struct timespec ts;
+	ts.tv_sec = milliseconds / 1000;
+	ts.tv_nsec = (milliseconds % 1000) * 1000000;
+	nanosleep (&ts, NULL);
+}
+
+uint64 PLATFORM_GetCurrentThreadID ()
+{
+	return (uint64)pthread_self ();
+}
+
+void PLATFORM_PinCurrentThread (uint32 cpu)
+{
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpu, &cpuSet);
+	pthread_setaffinity_np (pthread_self (), sizeof(cpuSet), &cpuSet);
+}
+
+uint32 PLATFORM_GetNumCPUs ()
+{
+	long nCPUs = sysconf (_SC_NPROCESSORS_ONLN);
+	return nCPUs > 0 ? (uint32)nCPUs : 1;
+}
+
+void PLATFORM_SetLowPriority ()
+{
+	// Only affects the calling thread on Linux.
+	setpriority (PRIO_PROCESS, 0, 19);
+}
+
+struct PlatformThread
+{
+	pthread_t thread;
+	PlatformThreadFunc pFunc;
+	void* pParam;
+};
+
+static void* ThreadEntry (void* pParam)
+{
+	PlatformThread* pThread = (PlatformThread*)pParam;
+	pThread->pFunc (pThread->pParam);
+	return NULL;
+}
+
+PlatformThread* PLATFORM_StartThread (PlatformThreadFunc pFunc, void* pParam)
+{
+	PlatformThread* pThread = new PlatformThread;
+	pThread->pFunc = pFunc;
+	pThread->pParam = pParam;
+	if (pthread_create (&pThread->thread, NULL, ThreadEntry, pThread) != 0)
+	{
+		delete pThread;
+		return NULL;
+	}
+
+	return pThread;
+}
+
+void PLATFORM_JoinThread (PlatformThread* pThread)
+{
+	pthread_join (pThread->thread, NULL);
+	delete pThread;
+}
+
+const uint8* PLATFORM_MapFile (const char* fileName, uint32& nBytes)
+{
+	int fd = open (fileName, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	struct stat st;
+	if (fstat (fd, &st) != 0 || !S_ISREG(st.st_mode) || (uint64)st.st_size > 0xffffffff)
+	{
+		close (fd);
+		return NULL;
+	}
+
+	nBytes = (uint32)st.st_size;
+	if (!nBytes)
+	{
+		close (fd);
+		return s_emptyFile;
+	}
+
+	// The mapping keeps the file open by itself.
+	void* pData = mmap (NULL, nBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	return pData == MAP_FAILED ? NULL : (const uint8*)pData;
+}
+
+void PLATFORM_UnmapFile (const uint8* pData, uint32 nBytes)
+{
+	if (pData != s_emptyFile)
+		munmap ((void*)pData, nBytes);
+}
+
+#endif // _WIN32
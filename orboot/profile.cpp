@@ -0,0 +1,263 @@
+#include <Platform.h>
+#include <algorithm>
+#include <ctype.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "profile.h"
+
+static const uint32 kNumCPUs = 2;
+
+struct ProfileSymbol
+{
+	uint32 address;
+	std::string name;
+};
+
+// Samples of one CPU, added up over all records.
+struct ProfileCPU
+{
+	bool bSeen;
+	uint8 shift;
+	uint32 base;
+	std::vector<uint64> buckets;
+	uint64 nOutside;
+	uint64 nSamples;
+};
+
+static bool SymbolBefore (const ProfileSymbol& a, const ProfileSymbol& b)
+{
+	return a.address < b.address;
+}
+
+static bool CountAbove (const std::pair<std::string, uint64>& a, const std::pair<std::string, uint64>& b)
+{
+	return a.second > b.second;
+}
+
+// Symbols from a GNU ld map file. Besides the symbol lines ("0x00060200  main"), the start of every .text
+// input section is taken as "(file.o)", so static functions at least end up with the right file.
+static bool LoadMap (const char* fileName, std::vector<ProfileSymbol>& symbols)
+{
+	FILE* pFile = fopen (fileName, "r");
+	if (!pFile)
+	{
+		printf ("Couldn't open map file '%s'!\n", fileName);
+		return false;
+	}
+
+	char line[1024];
+	bool bMemoryMap = false;
+	bool bTextSection = false; // The previous line named a .text input section, and the rest follows.
+	while (fgets (line, sizeof(line), pFile))
+	{
+		if (!bMemoryMap)
+		{
+			bMemoryMap = strncmp (line, "Linker script and memory map", 28) == 0;
+			continue;
+		}
+
+		char first[512], second[512], third[512], fourth[512];
+		int nFields = sscanf (line, "%511s %511s %511s %511s", first, second, third, fourth);
+		bool bIndented = line[0] == ' ';
+		if (bIndented && nFields == 1 && strncmp (first, ".text", 5) == 0)
+		{
+			bTextSection = true;
+			continue;
+		}
+
+		ProfileSymbol symbol;
+		char* pEnd;
+		if (bTextSection && nFields == 3 && strncmp (first, "0x", 2) == 0)
+		{
+			// Address, size and file of the section named on the previous line.
+			symbol.address = strtoul (first, &pEnd, 16);
+			if (strtoul (second, &pEnd, 16))
+			{
+				symbol.name = std::string ("(") + third + ")";
+				symbols.push_back (symbol);
+			}
+		}
+		else if (bIndented && nFields == 4 && strncmp (first, ".text", 5) == 0 && strncmp (second, "0x", 2) == 0)
+		{
+			symbol.address = strtoul (second, &pEnd, 16);
+			if (strtoul (third, &pEnd, 16))
+			{
+				symbol.name = std::string ("(") + fourth + ")";
+				symbols.push_back (symbol);
+			}
+		}
+		else if (bIndented && nFields == 2 && strncmp (first, "0x", 2) == 0 && (isalpha ((uint8)second[0]) || second[0] == '_'))
+		{
+			symbol.address = strtoul (first, &pEnd, 16);
+			symbol.name = second;
+			symbols.push_back (symbol);
+		}
+		bTextSection = false;
+	}
+	fclose (pFile);
+
+	// A symbol wins over the section it starts.
+	std::stable_sort (symbols.begin (), symbols.end (), SymbolBefore);
+	std::vector<ProfileSymbol> unique;
+	for (size_t i=0; i<symbols.size(); i++)
+	{
+		if (!unique.empty () && unique.back ().address == symbols[i].address && symbols[i].name[0] != '(')
+			unique.back () = symbols[i];
+		else if (unique.empty () || unique.back ().address != symbols[i].address)
+			unique.push_back (symbols[i]);
+	}
+	symbols.swap (unique);
+
+	if (symbols.empty ())
+	{
+		printf ("Map file '%s' has no symbols!\n", fileName);
+		return false;
+	}
+	return true;
+}
+
+// Adds up the records orboot -log wrote: a frame number, then the payload in hex.
+static bool LoadSamples (const char* fileName, ProfileCPU* pCPUs)
+{
+	FILE* pFile = fopen (fileName, "r");
+	if (!pFile)
+	{
+		printf ("Couldn't open profile log '%s'!\n", fileName);
+		return false;
+	}
+
+	char line[1024];
+	for (uint32 lineNumber=1; fgets (line, sizeof(line), pFile); lineNumber++)
+	{
+		uint8 payload[255];
+		uint32 nBytes = 0;
+		char* pText = line;
+		strtoul (pText, &pText, 10);
+		for (;;)
+		{
+			char* pEnd;
+			unsigned long value = strtoul (pText, &pEnd, 16);
+			if (pEnd == pText || nBytes == sizeof(payload))
+				break;
+			payload[nBytes++] = (uint8)value;
+			pText = pEnd;
+		}
+
+		if (nBytes < kProfileRecordHeader || (nBytes - kProfileRecordHeader) % 4 || payload[0] >= kNumCPUs)
+		{
+			printf ("%s(%u): not a profile record.\n", fileName, lineNumber);
+			fclose (pFile);
+			return false;
+		}
+
+		ProfileCPU& cpu = pCPUs[payload[0]];
+		uint32 base = (payload[2] << 24) | (payload[3] << 16) | (payload[4] << 8) | payload[5];
+		if (cpu.bSeen && (cpu.shift != payload[1] || cpu.base != base))
+		{
+			// The program was restarted with other buckets, so the earlier samples don't count.
+			cpu.buckets.clear ();
+			cpu.nOutside = 0;
+			cpu.nSamples = 0;
+		}
+		cpu.bSeen = true;
+		cpu.shift = payload[1];
+		cpu.base = base;
+
+		for (uint32 i=kProfileRecordHeader; i<nBytes; i+=4)
+		{
+			uint16 bucket = (uint16)((payload[i] << 8) | payload[i+1]);
+			uint16 count = (uint16)((payload[i+2] << 8) | payload[i+3]);
+			cpu.nSamples += count;
+			if (bucket == kProfileBucketOutside)
+			{
+				cpu.nOutside += count;
+				continue;
+			}
+
+			if (bucket >= cpu.buckets.size ())
+				cpu.buckets.resize (bucket + 1, 0);
+			cpu.buckets[bucket] += count;
+		}
+	}
+
+	fclose (pFile);
+	return true;
+}
+
+static void PrintProfile (const char* cpuName, const ProfileCPU& cpu, const std::vector<ProfileSymbol>& symbols)
+{
+	// Every bucket goes to the function its middle is in.
+	std::map<std::string, uint64> counts;
+	for (size_t i=0; i<cpu.buckets.size(); i++)
+	{
+		if (!cpu.buckets[i])
+			continue;
+
+		ProfileSymbol key;
+		key.address = cpu.base + ((uint32)i << cpu.shift) + ((1u << cpu.shift) >> 1);
+		std::vector<ProfileSymbol>::const_iterator it = std::upper_bound (symbols.begin (), symbols.end (), key, SymbolBefore);
+		counts[it == symbols.begin () ? "(before the first symbol)" : (it - 1)->name] += cpu.buckets[i];
+	}
+	if (cpu.nOutside)
+		counts["(outside the program)"] += cpu.nOutside;
+
+	std::vector<std::pair<std::string, uint64> > sorted (counts.begin (), counts.end ());
+	std::stable_sort (sorted.begin (), sorted.end (), CountAbove);
+
+	printf ("%s CPU: " FMT_U64 " samples, %u bytes per bucket.\n", cpuName, cpu.nSamples, 1u << cpu.shift);
+	printf ("   Samples       %%  Function\n");
+	for (size_t i=0; i<sorted.size(); i++)
+	{
+		// FMT_U64 can't take a width.
+		char count[32];
+		snprintf (count, sizeof(count), FMT_U64, sorted[i].second);
+		printf ("%10s  %5.1f%%  %s\n", count, sorted[i].second * 100.0 / cpu.nSamples, sorted[i].first.c_str ());
+	}
+}
+
+bool PROFILE_Report (const char* logFile, const char* mainMapFile, const char* subMapFile)
+{
+	ProfileCPU cpus[kNumCPUs];
+	for (uint32 i=0; i<kNumCPUs; i++)
+	{
+		cpus[i].bSeen = false;
+		cpus[i].shift = 0;
+		cpus[i].base = 0;
+		cpus[i].nOutside = 0;
+		cpus[i].nSamples = 0;
+	}
+
+	if (!LoadSamples (logFile, cpus))
+		return false;
+
+	const char* mapFiles[kNumCPUs] = { mainMapFile, subMapFile };
+	const char* cpuNames[kNumCPUs] = { "Main", "Sub" };
+	bool bPrinted = false;
+	for (uint32 i=0; i<kNumCPUs; i++)
+	{
+		if (!cpus[i].nSamples)
+			continue;
+		if (!mapFiles[i])
+		{
+			printf ("The log has samples of the %s CPU, but there is no map file for it.\n", i ? "sub" : "main");
+			continue;
+		}
+
+		std::vector<ProfileSymbol> symbols;
+		if (!LoadMap (mapFiles[i], symbols))
+			return false;
+
+		if (bPrinted)
+			printf ("\n");
+		PrintProfile (cpuNames[i], cpus[i], symbols);
+		bPrinted = true;
+	}
+
+	if (!bPrinted)
+		printf ("No samples in '%s'.\n", logFile);
+	return true;
+}
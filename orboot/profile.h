@@ -0,0 +1,19 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <Platform.h>
+
+// Flat profiles from the PC sampling profiler in the SDK (sdk/include/cpu0/profile.h). The program
+// sends its samples as log records on channel kProfileChannel, which orboot -log writes to
+// <prefix>-254.log. Those are added up here, and every bucket is given to the function it falls in,
+// according to the map file the linker wrote for that CPU.
+
+static const uint8 kProfileChannel = 0xFE;
+static const uint32 kProfileRecordHeader = 6;
+static const uint16 kProfileBucketOutside = 0xFFFF;
+
+// Prints the samples per function for each CPU that has any, busiest first. subMapFile may be NULL when
+// only the main CPU was profiled. Prints the reason on failure.
+bool PROFILE_Report (const char* logFile, const char* mainMapFile, const char* subMapFile);
+
+#endif // __PROFILE_H__
@@ -0,0 +1,146 @@
+#include <Platform.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "settings.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static std::string GetSettingsPath ()
+{
+#ifdef _WIN32
+	const char* pDir = getenv ("APPDATA");
+	return std::string (pDir ? pDir : ".") + "\\orboot.cfg";
+#else
+	const char* pDir = getenv ("HOME");
+	return std::string (pDir ? pDir : ".") + "/.orboot";
+#endif
+}
+
+static std::string GetCachePath (const char* portName, const char* imageName, bool bCreateFolder)
+{
+#ifdef _WIN32
+	const char* pDir = getenv ("APPDATA");
+	std::string path = std::string (pDir ? pDir : ".") + "\\orboot-cache";
+	if (bCreateFolder)
+		_mkdir (path.c_str());
+	path += "\\";
+#else
+	const char* pDir = getenv ("HOME");
+	std::string path = std::string (pDir ? pDir : ".") + "/.orboot-cache";
+	if (bCreateFolder)
+		mkdir (path.c_str(), 0755);
+	path += "/";
+#endif
+
+	// Port names are paths or contain colons, which don't make good file names.
+	for (const char* p=portName; *p; p++)
+		path += (*p == '/' || *p == '\\' || *p == ':') ? '_' : *p;
+	return path + "-" + imageName + ".bin";
+}
+
+// Reads all lines, without line endings.
+static void ReadLines (std::vector<std::string>& lines)
+{
+	FILE* pFile = fopen (GetSettingsPath().c_str(), "r");
+	if (!pFile)
+		return;
+
+	char line[512];
+	while (fgets (line, sizeof(line), pFile))
+	{
+		line[strcspn (line, "\r\n")] = 0;
+		if (line[0])
+			lines.push_back (line);
+	}
+
+	fclose (pFile);
+}
+
+// Port names can't contain spaces, so the value starts after the first one.
+static bool MatchPort (const std::string& line, const char* portName)
+{
+	size_t nameLength = strlen (portName);
+	return line.size() > nameLength && line.compare (0, nameLength, portName) == 0 && line[nameLength] == ' ';
+}
+
+bool SETTINGS_LoadTXDelay (const char* portName, uint64& txDelayNS)
+{
+	std::vector<std::string> lines;
+	ReadLines (lines);
+	for (size_t i=0; i<lines.size(); i++)
+		if (MatchPort (lines[i], portName))
+			return sscanf (lines[i].c_str() + strlen(portName) + 1, FMT_U64, &txDelayNS) == 1;
+
+	return false;
+}
+
+bool SETTINGS_SaveTXDelay (const char* portName, uint64 txDelayNS)
+{
+	DEBUG_ASSERT(!strchr (portName, ' '));
+	std::vector<std::string> lines;
+	ReadLines (lines);
+
+	char value[32];
+	sprintf (value, FMT_U64, txDelayNS);
+	std::string newLine = std::string (portName) + " " + value;
+
+	bool bReplaced = false;
+	for (size_t i=0; i<lines.size(); i++)
+	{
+		if (MatchPort (lines[i], portName))
+		{
+			lines[i] = newLine;
+			bReplaced = true;
+		}
+	}
+	if (!bReplaced)
+		lines.push_back (newLine);
+
+	FILE* pFile = fopen (GetSettingsPath().c_str(), "w");
+	if (!pFile)
+		return false;
+
+	for (size_t i=0; i<lines.size(); i++)
+		fprintf (pFile, "%s\n", lines[i].c_str());
+
+	return fclose (pFile) == 0;
+}
+
+bool SETTINGS_LoadCachedImage (const char* portName, const char* imageName, std::vector<uint8>& data)
+{
+	FILE* pFile = fopen (GetCachePath (portName, imageName, false).c_str(), "rb");
+	if (!pFile)
+		return false;
+
+	data.clear();
+	uint8 buffer[4096];
+	size_t nRead;
+	while ((nRead = fread (buffer, 1, sizeof(buffer), pFile)) != 0)
+		data.insert (data.end(), buffer, buffer + nRead);
+
+	bool bError = ferror (pFile) != 0;
+	fclose (pFile);
+	return !bError;
+}
+
+bool SETTINGS_SaveCachedImage (const char* portName, const char* imageName, const void* pData, uint32 nBytes)
+{
+	FILE* pFile = fopen (GetCachePath (portName, imageName, true).c_str(), "wb");
+	if (!pFile)
+		return false;
+
+	bool bWritten = fwrite (pData, 1, nBytes, pFile) == nBytes;
+	return (fclose (pFile) == 0) && bWritten;
+}
+
+void SETTINGS_ClearCachedImage (const char* portName, const char* imageName)
+{
+	remove (GetCachePath (portName, imageName, false).c_str());
+}
@@ -0,0 +1,25 @@
+#ifndef __SETTINGS_H__
+#define __SETTINGS_H__
+
+#include <Platform.h>
+#include <vector>
+
+// Persistent per port settings, stored as '<port> <txdelay>' lines in
+// %APPDATA%\orboot.cfg on Windows, or ~/.orboot elsewhere.
+// The port name identifies the backend and port, e.g. "ppdev:/dev/parport0".
+
+// Retrieves the calibrated TX delay for a port. Returns false if there is none.
+bool SETTINGS_LoadTXDelay (const char* portName, uint64& txDelayNS);
+
+// Stores the calibrated TX delay for a port, replacing the previous one.
+bool SETTINGS_SaveTXDelay (const char* portName, uint64 txDelayNS);
+
+// Copies of the last image uploaded to each port, for delta uploads. Stored in the orboot-cache folder
+// next to the settings file. The image name tells main and sub ram apart.
+bool SETTINGS_LoadCachedImage (const char* portName, const char* imageName, std::vector<uint8>& data);
+bool SETTINGS_SaveCachedImage (const char* portName, const char* imageName, const void* pData, uint32 nBytes);
+
+// Removes a cached image, for when we don't know what's in ram anymore.
+void SETTINGS_ClearCachedImage (const char* portName, const char* imageName);
+
+#endif // __SETTINGS_H__
@@ -0,0 +1,51 @@
+#ifndef __SPSCQUEUE_H__
+#define __SPSCQUEUE_H__
+
+#include <Platform.h>
+
+// Fixed size, lock-free queue for exactly one producer thread and one consumer thread.
+// Neither side ever blocks; Push fails when the queue is full and Pop fails when it's empty.
+// Each index is only written by one side, and the barriers make sure an item is complete
+// before the other side can see it.
+template <typename T, uint32 kCapacity>
+class SPSCQueue
+{
+public:
+	SPSCQueue () : m_head (0), m_tail (0) {}
+
+	// Producer side.
+	bool Push (const T& item)
+	{
+		uint32 tail = m_tail;
+		uint32 next = (tail + 1) % kCapacity;
+		if (next == m_head)
+			return false;
+
+		PLATFORM_MemoryBarrier ();
+		m_items[tail] = item;
+		PLATFORM_MemoryBarrier ();
+		m_tail = next;
+		return true;
+	}
+
+	// Consumer side.
+	bool Pop (T& item)
+	{
+		uint32 head = m_head;
+		if (head == m_tail)
+			return false;
+
+		PLATFORM_MemoryBarrier ();
+		item = m_items[head];
+		PLATFORM_MemoryBarrier ();
+		m_head = (head + 1) % kCapacity;
+		return true;
+	}
+
+private:
+	volatile uint32 m_head; // Next item to pop; written by the consumer.
+	volatile uint32 m_tail; // Next free slot; written by the producer.
+	T m_items[kCapacity];
+};
+
+#endif // __SPSCQUEUE_H__
@@ -0,0 +1,153 @@
+#include <Platform.h>
+#include <stdio.h>
+#include <vector>
+#include "comm.h"
+#include "stats.h"
+
+static std::vector<UploadStats> s_uploads;
+
+static const char* s_phaseNames[COMM_NUM_PHASES] = { "send ready", "send ack", "recv idle", "recv clock", "recv release" };
+static const char* s_phaseKeys[COMM_NUM_PHASES] = { "sendReady", "sendAck", "recvIdle", "recvClock", "recvRelease" };
+
+static const uint32 kNumPercentiles = 4;
+static const double s_percentiles[kNumPercentiles] = { 50.0, 90.0, 99.0, 99.9 };
+static const char* s_percentileKeys[kNumPercentiles] = { "p50", "p90", "p99", "p999" };
+
+void STATS_AddUpload (const UploadStats& upload)
+{
+	s_uploads.push_back (upload);
+}
+
+static double BytesPerSecond (uint32 nBytes, uint64 elapsedNS)
+{
+	return elapsedNS ? nBytes * 1e9 / elapsedNS : 0.0;
+}
+
+static void PrintRow (const char* name, const Histogram& histogram)
+{
+	// FMT_U64 doesn't take a width, and doubles are exact up to 2^53 nanoseconds.
+	printf ("  %-14s %8u %10.0f", name, histogram.GetCount (), (double)histogram.GetMin ());
+	for (uint32 i=0; i<kNumPercentiles; i++)
+		printf (" %10.0f", (double)histogram.GetPercentile (s_percentiles[i]));
+	printf (" %10.0f\n", (double)histogram.GetMax ());
+}
+
+// Bar per power of two, so the shape of the distribution (and any second hump) is visible.
+static void PrintBars (const char* name, const Histogram& histogram)
+{
+	if (!histogram.GetCount ())
+		return;
+
+	uint32 counts[64] = { 0 };
+	uint32 first = 64, last = 0, largest = 0;
+	for (uint32 i=0; i<Histogram::kNumBuckets; i++)
+	{
+		if (!histogram.GetBucketCount (i))
+			continue;
+		uint32 octave = 0;
+		while ((Histogram::GetBucketMin (i) >> octave) > 1)
+			octave++;
+		counts[octave] += histogram.GetBucketCount (i);
+		if (octave < first)
+			first = octave;
+		if (octave > last)
+			last = octave;
+	}
+	for (uint32 i=first; i<=last; i++)
+		if (counts[i] > largest)
+			largest = counts[i];
+
+	printf ("  %s (nanoseconds):\n", name);
+	for (uint32 i=first; i<=last; i++)
+	{
+		printf ("  %12.0f - %-12.0f %8u ", (double)(1ull << i), (double)((2ull << i) - 1), counts[i]);
+		uint32 width = (uint32)((uint64)counts[i] * 40 / largest);
+		for (uint32 j=0; j<width; j++)
+			putchar ('#');
+		printf ("\n");
+	}
+}
+
+static void PrintJSONString (const char* string)
+{
+	putchar ('"');
+	for (const char* p=string; *p; p++)
+	{
+		if (*p == '"' || *p == '\\')
+			putchar ('\\');
+		if ((uint8)*p >= 0x20)
+			putchar (*p);
+	}
+	putchar ('"');
+}
+
+static void PrintJSONHistogram (const char* key, const Histogram& histogram)
+{
+	printf ("\"%s\":{\"count\":%u,\"min\":" FMT_U64 ",\"mean\":" FMT_U64 "", key, histogram.GetCount (), histogram.GetMin (), histogram.GetMean ());
+	for (uint32 i=0; i<kNumPercentiles; i++)
+		printf (",\"%s\":" FMT_U64 "", s_percentileKeys[i], histogram.GetPercentile (s_percentiles[i]));
+	printf (",\"max\":" FMT_U64 "}", histogram.GetMax ());
+}
+
+static void PrintJSON (const char* portKey)
+{
+	const CommTelemetry& telemetry = COMM_GetTelemetry ();
+
+	printf ("{\"port\":");
+	PrintJSONString (portKey);
+	printf (",\"txDelayNS\":" FMT_U64 ",\"uploads\":[", COMM_GetTXDelayNS ());
+	for (size_t i=0; i<s_uploads.size(); i++)
+	{
+		const UploadStats& upload = s_uploads[i];
+		printf ("%s{\"description\":", i ? "," : "");
+		PrintJSONString (upload.description);
+		printf (",\"bytes\":%u,\"sentBytes\":%u,\"retries\":%u,\"elapsedNS\":" FMT_U64 ",\"bytesPerSecond\":%.1f,\"succeeded\":%s}",
+			upload.nBytes, upload.nSentBytes, upload.nRetries, upload.elapsedNS,
+			BytesPerSecond (upload.nBytes, upload.elapsedNS), upload.bSucceeded ? "true" : "false");
+	}
+	printf ("],\"phases\":{");
+	for (uint32 i=0; i<COMM_NUM_PHASES; i++)
+	{
+		if (i)
+			putchar (',');
+		PrintJSONHistogram (s_phaseKeys[i], telemetry.phaseNS[i]);
+	}
+	printf ("},");
+	PrintJSONHistogram ("sendByte", telemetry.sendByteNS);
+	putchar (',');
+	PrintJSONHistogram ("recvByte", telemetry.recvByteNS);
+	printf (",\"slackOffs\":%u,\"timeOuts\":%u}\n", telemetry.nSlackOffs, telemetry.nTimeOuts);
+}
+
+void STATS_Print (const char* portKey, bool bJSON)
+{
+	if (bJSON)
+	{
+		PrintJSON (portKey);
+		return;
+	}
+
+	const CommTelemetry& telemetry = COMM_GetTelemetry ();
+	printf ("\nTransfer statistics for %s, TX delay " FMT_U64 " nanoseconds:\n", portKey, COMM_GetTXDelayNS ());
+	if (!s_uploads.empty())
+	{
+		printf ("  %-14s %8s %8s %8s %10s %12s %12s\n", "Upload", "Bytes", "Sent", "Retries", "Seconds", "Bytes/s", "Sent/s");
+		for (size_t i=0; i<s_uploads.size(); i++)
+		{
+			const UploadStats& upload = s_uploads[i];
+			printf ("  %-14s %8u %8u %8u %10.3f %12.0f %12.0f%s\n", upload.description, upload.nBytes, upload.nSentBytes, upload.nRetries,
+				upload.elapsedNS / 1e9, BytesPerSecond (upload.nBytes, upload.elapsedNS), BytesPerSecond (upload.nSentBytes, upload.elapsedNS),
+				upload.bSucceeded ? "" : " (failed)");
+		}
+	}
+
+	printf ("  %-14s %8s %10s %10s %10s %10s %10s %10s\n", "Wait (ns)", "Count", "Min", "p50", "p90", "p99", "p99.9", "Max");
+	for (uint32 i=0; i<COMM_NUM_PHASES; i++)
+		PrintRow (s_phaseNames[i], telemetry.phaseNS[i]);
+	PrintRow ("send byte", telemetry.sendByteNS);
+	PrintRow ("recv byte", telemetry.recvByteNS);
+	printf ("  %u slack-off(s), %u timeout(s).\n", telemetry.nSlackOffs, telemetry.nTimeOuts);
+
+	PrintBars ("Send byte", telemetry.sendByteNS);
+	PrintBars ("Recv byte", telemetry.recvByteNS);
+}
@@ -0,0 +1,24 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <Platform.h>
+
+// Transfer statistics for -stats: one record per upload, plus the handshake telemetry of the comm layer
+// (see COMM_EnableTelemetry), printed as a table with percentiles or as a single line of JSON.
+
+struct UploadStats
+{
+	const char* description; // For example "main ram".
+	uint32 nBytes;           // Image size.
+	uint32 nSentBytes;       // Bytes that went over the wire, including commands, headers and resends.
+	uint32 nRetries;
+	uint64 elapsedNS;
+	bool bSucceeded;
+};
+
+void STATS_AddUpload (const UploadStats& upload);
+
+// portKey identifies the cabinet or cable, e.g. "ppdev:/dev/parport0".
+void STATS_Print (const char* portKey, bool bJSON);
+
+#endif // __STATS_H__
@@ -0,0 +1,74 @@
+#include <perf.h>
+#include "perfmeter.h"
+#include "text.h"
+
+#define PERFMETER_NAME_WIDTH  6
+#define PERFMETER_VBLANK      (262 - 224) // Lines after line 223 that aren't displayed.
+#define PERFMETER_GLYPH_FULL  ((TEXTGLYPH)0x1fd)
+#define PERFMETER_GLYPH_EMPTY TEXTGLYPH_PERIOD
+
+// Skips gray, which is the background of the bar.
+static const TEXTCOLOR s_perfmeter_colors[] = { TEXT_Green, TEXT_Yellow, TEXT_Cyan, TEXT_Purple, TEXT_Red, TEXT_White };
+
+static volatile uint16_t* PERFMETER_Put (volatile uint16_t* pDest, TEXTGLYPH glyph, TEXTCOLOR color)
+{
+	*pDest++ = (glyph & TEXT_GLYPH_MASK) | (color << 9) | 0x8000;
+	return pDest;
+}
+
+// Scanlines, right aligned in 4 characters.
+static volatile uint16_t* PERFMETER_PutLines (volatile uint16_t* pDest, uint16_t length, TEXTCOLOR color)
+{
+	uint16_t lines = (length + PERF_SUBLINES/2) / PERF_SUBLINES;
+	char digits[4] = { ' ', ' ', ' ', ' ' };
+	for (int8_t i=3; i>=0; i--)
+	{
+		digits[i] = '0' + (lines % 10);
+		lines /= 10;
+		if (!lines)
+			break;
+	}
+
+	for (uint8_t i=0; i<4; i++)
+		pDest = PERFMETER_Put (pDest, TEXT_GlyphFromASCII (digits[i]), color);
+	return pDest;
+}
+
+// The numbers come from perf.h, whose probe spins out the rest of an IRQ2 band in one frame out of every
+// PERF_SetProbeInterval: a program that is close to its frame budget will overrun that frame, and drop frames
+// while the meter runs. The bar shows where the sections ran in the frames they were measured in.
+void PERFMETER_Draw (uint8_t left, uint8_t top, uint8_t barWidth)
+{
+	const uint32_t frameLength = (uint32_t)PERF_FRAME_LINES * PERF_SUBLINES;
+	for (uint8_t i=0; i<PERF_GetNumSections (); i++)
+	{
+		const PerfSection* pSection = PERF_GetSection (i);
+		volatile uint16_t* pDest = TEXT_RAM_BASE + (top + i) * TEXT_SCREEN_WIDTH + left;
+		TEXTCOLOR color = s_perfmeter_colors[i % sizeof(s_perfmeter_colors)];
+
+		const char* pName = pSection->name;
+		for (uint8_t x=0; x<PERFMETER_NAME_WIDTH; x++)
+			pDest = PERFMETER_Put (pDest, TEXT_GlyphFromASCII ((pName && *pName) ? *pName++ : ' '), TEXT_White);
+
+		// A character is lit when its middle is in the section.
+		for (uint8_t x=0; x<barWidth; x++)
+		{
+			uint32_t middle = ((2 * x + 1) * frameLength) / (2 * barWidth);
+			if (pSection->nSamples && middle >= pSection->start && middle < pSection->end)
+				pDest = PERFMETER_Put (pDest, PERFMETER_GLYPH_FULL, color);
+			else
+				pDest = PERFMETER_Put (pDest, PERFMETER_GLYPH_EMPTY, (middle < PERFMETER_VBLANK * PERF_SUBLINES) ? TEXT_Blue : TEXT_Gray);
+		}
+
+		if (!pSection->nSamples)
+		{
+			for (uint8_t x=0; x<12; x++)
+				pDest = PERFMETER_Put (pDest, ' ', TEXT_Gray);
+			continue;
+		}
+
+		pDest = PERFMETER_PutLines (pDest, pSection->minLength, TEXT_Gray);
+		pDest = PERFMETER_PutLines (pDest, PERF_GetAverage (pSection), TEXT_White);
+		pDest = PERFMETER_PutLines (pDest, pSection->maxLength, TEXT_Gray);
+	}
+}
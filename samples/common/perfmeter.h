@@ -0,0 +1,21 @@
+#ifndef __PERFMETER_H__
+#define __PERFMETER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+#include <stdint.h>
+
+// On-screen frame budget meter for the sections measured with perf.h (PERF_Init etc. in the SDK).
+// Draws one row per section on the text layer, from (left, top): the name, a bar of barWidth characters for the
+// whole frame with the section's part of it lit, and its min/avg/max length in scanlines. The frame starts at
+// line 223 (IRQ4), so the blue start of the bar is vblank. Writes text RAM directly, and leaves the console
+// window, cursor and color alone. Rows are 18 + barWidth characters wide. Measuring costs frame time (see perf.h).
+void PERFMETER_Draw (uint8_t left, uint8_t top, uint8_t barWidth);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // __PERFMETER_H__
@@ -31,6 +31,25 @@ void UnpackTileMap (uint16_t* pDest, const uint16_t* pSrc)
 	}
 }
 
+// Queues the unpacking in the tile queue, so it's done in vblank, over as many frames as it takes.
+bool QueueUnpackTileMap (uint8_t pageIdx, const uint16_t* pSrc)
+{
+	// All or nothing, so find out how many columns there are first.
+	uint8_t nColumns = 0;
+	for (const uint16_t* pColumn=pSrc; nColumns<TILE_PAGE_WIDTH && *pColumn != (uint16_t)-1; pColumn += *pColumn + 1)
+		nColumns++;
+	if (nColumns > TILE_QueueGetFree ())
+		return false;
+
+	for (uint8_t x=0; x<nColumns; x++)
+	{
+		uint16_t count = *pSrc++;
+		TILE_QueueColumn (pageIdx, x, TILE_PAGE_HEIGHT-1, pSrc, count, true);
+		pSrc += count;
+	}
+	return true;
+}
+
 // Sequentially unpacks multiple tile maps. Also clears the pages.
 void UnpackTileMaps (uint8_t firstDestPage, const uint16_t** ppSrcPages, uint8_t nPages)
 {
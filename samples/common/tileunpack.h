@@ -16,6 +16,10 @@ void ClearTileMap (uint16_t* pDest);
 // Unpack without clearing.
 void UnpackTileMap (uint16_t* pDest, const uint16_t* pSrc);
 
+// Same, but through the tile queue (TILE_QueueInstall), which writes it during vblank. The packed data has to
+// stay put until it's done. Returns false, without queueing anything, when the queue doesn't have room.
+bool QueueUnpackTileMap (uint8_t pageIdx, const uint16_t* pSrc);
+
 // Sequentially unpacks multiple tile maps. Also clears the pages.
 void UnpackTileMaps (uint8_t firstDestPage, const uint16_t** ppSrcPages, uint8_t nPages);
 
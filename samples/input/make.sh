@@ -41,12 +41,16 @@ ${OUTRUN_GCC_PREFIX}ld "/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000/crtbeg
 
 echo "maincpu_ram.bin"
 ${OUTRUN_GCC_PREFIX}ld "/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000/crtbegin.o" $(cat ${OUTPUT_PATH}/main.link.in) ${OUTRUN_SDK_LIB}/outrun_sdk_cpu0.lib "/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000/crtend.o" -lc -lgcc  -L"/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000" -L"/opt/m68k/gcc-6.3.0/m68k-elf/lib/m68000" --script=${OUTRUN_SDK_LDSCRIPT}/outrun_main_ram.ld -o ${OUTPUT_PATH}/maincpu_ram.bin --Map=${OUTPUT_PATH}/maincpu_ram.map
+echo "maincpu_ram.elf"
+${OUTRUN_GCC_PREFIX}ld "/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000/crtbegin.o" $(cat ${OUTPUT_PATH}/main.link.in) ${OUTRUN_SDK_LIB}/outrun_sdk_cpu0.lib "/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000/crtend.o" -lc -lgcc  -L"/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000" -L"/opt/m68k/gcc-6.3.0/m68k-elf/lib/m68000" --script=${OUTRUN_SDK_LDSCRIPT}/outrun_main_ram.ld --oformat elf32-m68k -o ${OUTPUT_PATH}/maincpu_ram.elf
 
 if [[ -e "${OUTPUT_PATH}/sub.link.in" ]]; then
   echo "subcpu_rom.bin"
   ${OUTRUN_GCC_PREFIX}ld "/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000/crtbegin.o" $(cat ${OUTPUT_PATH}/sub.link.in) ${OUTRUN_SDK_LIB}/outrun_sdk_cpu1.lib "/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000/crtend.o" -lc -lgcc -L"/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000" -L"/opt/m68k/gcc-6.3.0/m68k-elf/lib/m68000" --script=${OUTRUN_SDK_LDSCRIPT}/outrun_sub_rom.ld -o ${OUTPUT_PATH}/subcpu_rom.bin --Map=${OUTPUT_PATH}/subcpu_rom.map
   echo "subcpu_ram.bin"
   ${OUTRUN_GCC_PREFIX}ld "/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000/crtbegin.o" $(cat ${OUTPUT_PATH}/sub.link.in) ${OUTRUN_SDK_LIB}/outrun_sdk_cpu1.lib "/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000/crtend.o" -lc -lgcc -L"/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000" -L"/opt/m68k/gcc-6.3.0/m68k-elf/lib/m68000" --script=${OUTRUN_SDK_LDSCRIPT}/outrun_sub_ram.ld -o ${OUTPUT_PATH}/subcpu_ram.bin --Map=${OUTPUT_PATH}/subcpu_ram.map
+  echo "subcpu_ram.elf"
+  ${OUTRUN_GCC_PREFIX}ld "/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000/crtbegin.o" $(cat ${OUTPUT_PATH}/sub.link.in) ${OUTRUN_SDK_LIB}/outrun_sdk_cpu1.lib "/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000/crtend.o" -lc -lgcc -L"/opt/m68k/gcc-6.3.0/lib/gcc/m68k-elf/6.3.0/m68000" -L"/opt/m68k/gcc-6.3.0/m68k-elf/lib/m68000" --script=${OUTRUN_SDK_LDSCRIPT}/outrun_sub_ram.ld --oformat elf32-m68k -o ${OUTPUT_PATH}/subcpu_ram.elf
 fi
 
 ls -sh ${OUTPUT_PATH}
@@ -0,0 +1,133 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "irq.h"
+#include "text.h"
+#include "hwinit.h"
+
+//=====================================================================================================================================================
+// IRQ time: how many cycles a frame the main program gets, with and without IRQ handlers.
+// The IRQ2 and IRQ4 lines stay up for a whole scanline. The SDK used to wait that out before running any handler;
+// now the handlers run in that time, and only what is left of the line is waited for. Each mode counts the turns
+// of an empty loop over a number of frames. The last two run the same handlers, the new way and the old way
+// (IRQ_SetWaitFirst), so the difference between them is what came back.
+//=====================================================================================================================================================
+
+#define FRAME_CYCLES     166667 // 10Mhz, 60 frames a second.
+#define SCANLINE_CYCLES  655
+#define MEASURE_FRAMES   64
+
+// About 700 cycles (dbra takes 10), a bit more than a scanline; like a sound update.
+#define WORK_LOOPS       70
+
+typedef enum
+{
+	MODE_NoHandlers,
+	MODE_Handlers,
+	MODE_HandlersWaitFirst,
+	MODE_Count,
+} Mode;
+
+static const char* s_modeNames[MODE_Count] =
+{
+	"No handlers    ",
+	"Handlers       ",
+	"Handlers, old  ",
+};
+
+static void Spin (uint16_t loops)
+{
+	__asm__ volatile ("1: dbra %0, 1b" : "+d" (loops));
+}
+
+static void Work ()
+{
+	Spin (WORK_LOOPS);
+}
+
+static void SetMode (Mode mode)
+{
+	IRQ2_RemoveHandler (Work);
+	IRQ4_RemoveHandler (Work);
+	IRQ_SetWaitFirst (mode == MODE_HandlersWaitFirst);
+
+	if (mode != MODE_NoHandlers)
+	{
+		IRQ2_AddHandler (Work, true);
+		IRQ4_AddHandler (Work, true);
+	}
+}
+
+// Turns of an empty loop over nFrames frames.
+static uint32_t CountLoops (uint16_t nFrames)
+{
+	IRQ4_Wait ();
+	uint16_t end = IRQ4_GetCounter () + nFrames;
+	uint32_t loops = 0;
+	while (IRQ4_GetCounter () != end)
+		loops++;
+	return loops;
+}
+
+static void WriteDecimal (uint32_t value, uint8_t width)
+{
+	char digits[11];
+	uint8_t n = 0;
+	do
+	{
+		digits[n++] = '0' + (value % 10);
+		value /= 10;
+	} while (value);
+
+	while (width-- > n)
+		TEXT_WriteChar (' ');
+	while (n)
+		TEXT_WriteChar (digits[--n]);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------------------
+
+int main ()
+{
+	HW_Init (HWINIT_Default, 0x000);
+	TEXT_InitDefaultPalette();
+
+	TEXT_SetWindow (TEXT_SCREEN_VISIBLE_XSTART+2, 1, TEXT_SCREEN_WIDTH-1, TEXT_SCREEN_HEIGHT, false);
+	TEXT_SetColor (TEXT_Cyan);
+	TEXT_Write ("IRQ TIME\n\n");
+	TEXT_SetColor (TEXT_Gray);
+	TEXT_Write ("Loops per frame, and cycles for\nthe program (estimated).\n\n");
+
+	uint32_t loopsPerFrame[MODE_Count] = { 0 };
+	for (;;)
+	{
+		for (uint8_t mode=0; mode<MODE_Count; mode++)
+		{
+			SetMode ((Mode)mode);
+			loopsPerFrame[mode] = CountLoops (MEASURE_FRAMES) / MEASURE_FRAMES;
+		}
+		SetMode (MODE_NoHandlers);
+
+		// Without handlers, the four interrupts a frame still take about a scanline each.
+		const uint32_t freeCycles = FRAME_CYCLES - 4 * SCANLINE_CYCLES;
+		const uint32_t cyclesPerLoop100 = loopsPerFrame[MODE_NoHandlers] ? (freeCycles * 100) / loopsPerFrame[MODE_NoHandlers] : 0;
+
+		TEXT_GotoXY (0, 5);
+		for (uint8_t mode=0; mode<MODE_Count; mode++)
+		{
+			TEXT_SetColor (TEXT_White);
+			TEXT_Write (s_modeNames[mode]);
+			TEXT_SetColor (TEXT_Yellow);
+			WriteDecimal (loopsPerFrame[mode], 7);
+			WriteDecimal ((loopsPerFrame[mode] * cyclesPerLoop100) / 100, 8);
+			TEXT_Write ("\n");
+		}
+
+		// What the handlers get back by working while the line is up, instead of after it.
+		int32_t reclaimed = (int32_t)(loopsPerFrame[MODE_Handlers] - loopsPerFrame[MODE_HandlersWaitFirst]);
+		TEXT_SetColor (TEXT_Green);
+		TEXT_Write ("\nReclaimed cycles per frame");
+		WriteDecimal (reclaimed > 0 ? (reclaimed * cyclesPerLoop100) / 100 : 0, 8);
+		TEXT_SetColor (TEXT_Gray);
+		TEXT_Write ("\nExpected about 4 x 655 = 2620\n");
+	}
+}
@@ -72,6 +72,9 @@ if ERRORLEVEL 1 goto error
 echo maincpu_ram.bin
 %OUTRUN_GCC_PREFIX%ld "%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000/crtbegin.o" @!OUTPUT_PATH!/main.link.in !OUTRUN_SDK_LIB!/outrun_sdk_cpu0.lib -lgcc "%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000/crtend.o" -L"%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000" --script=%OUTRUN_SDK_LDSCRIPT%/outrun_main_ram.ld -o !OUTPUT_PATH!/maincpu_ram.bin --Map=!OUTPUT_PATH!/maincpu_ram.map
 if ERRORLEVEL 1 goto error
+echo maincpu_ram.elf
+%OUTRUN_GCC_PREFIX%ld "%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000/crtbegin.o" @!OUTPUT_PATH!/main.link.in !OUTRUN_SDK_LIB!/outrun_sdk_cpu0.lib -lgcc "%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000/crtend.o" -L"%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000" --script=%OUTRUN_SDK_LDSCRIPT%/outrun_main_ram.ld --oformat elf32-m68k -o !OUTPUT_PATH!/maincpu_ram.elf
+if ERRORLEVEL 1 goto error
 
 if exist "!OUTPUT_PATH!\sub.link.in" (
   echo subcpu_rom.bin
@@ -80,6 +83,9 @@ if exist "!OUTPUT_PATH!\sub.link.in" (
   echo subcpu_ram.bin
   %OUTRUN_GCC_PREFIX%ld "%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000/crtbegin.o" @!OUTPUT_PATH!/sub.link.in !OUTRUN_SDK_LIB!/outrun_sdk_cpu1.lib -lgcc "%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000/crtend.o" -L"%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000" --script=%OUTRUN_SDK_LDSCRIPT%/outrun_sub_ram.ld -o !OUTPUT_PATH!/subcpu_ram.bin --Map=!OUTPUT_PATH!/subcpu_ram.map
   if ERRORLEVEL 1 goto error
+  echo subcpu_ram.elf
+  %OUTRUN_GCC_PREFIX%ld "%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000/crtbegin.o" @!OUTPUT_PATH!/sub.link.in !OUTRUN_SDK_LIB!/outrun_sdk_cpu1.lib -lgcc "%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000/crtend.o" -L"%OUTRUN_GCC_PATH%/lib/gcc/m68k-elf/4.9.0/m68000" --script=%OUTRUN_SDK_LDSCRIPT%/outrun_sub_ram.ld --oformat elf32-m68k -o !OUTPUT_PATH!/subcpu_ram.elf
+  if ERRORLEVEL 1 goto error
 )
 
 rem delete linker input lists
@@ -115,7 +121,7 @@ for %%i in (epr-10327a.76 epr-10329a.58 epr-10328a.75 epr-10330a.57) do (
   if exist "!OUTPUT_PATH!\%%i" del "!OUTPUT_PATH!\%%i"
 )
 
-for %%i in (main.link.in sub.link.in maincpu_ram.bin maincpu_ram.map maincpu_rom.bin maincpu_rom.map subcpu_ram.bin subcpu_ram.map subcpu_rom.bin subcpu_rom.map) do (
+for %%i in (main.link.in sub.link.in maincpu_ram.bin maincpu_ram.elf maincpu_ram.map maincpu_rom.bin maincpu_rom.map subcpu_ram.bin subcpu_ram.elf subcpu_ram.map subcpu_rom.bin subcpu_rom.map) do (
   if exist "!OUTPUT_PATH!\%%i" del "!OUTPUT_PATH!\%%i"
 )
 goto end
@@ -1707,6 +1707,9 @@ void main ()
 	}
 	*(--pDest) = 0xaaaaaaaa; // ?
 
+	// From here on the shadow list keeps sprite RAM up to date.
+	SPRITE_ShadowInit ();
+	const uint8_t userSpriteIdx = SPRITE_ShadowAlloc ();
 	
 	for (;;)
 	{
@@ -1819,11 +1822,10 @@ och zucht
 
 //		*pSprite = g_userSpriteData;
 
-		// Now write to buffer.
-		memcpy (&SpriteList[0], pSprite, sizeof(SpriteData));
-		*((uint16_t*)&SpriteList[1]) = 0xffff; // TERMINATE
+		// Now write to the shadow list; the commit writes it and the terminator to sprite RAM.
+		*SPRITE_ShadowEdit (userSpriteIdx) = *pSprite;
 		
 		IRQ4_Wait ();
-		SPRITE_SwapBuffers ();
+		SPRITE_ShadowCommit ();
 	}
 }
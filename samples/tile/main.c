@@ -5,6 +5,8 @@
 #include <irq.h>
 #include <stdint.h>
 #include "tileunpack.h"
+#include "perf.h"
+#include "perfmeter.h"
 
 extern const TileGraphics CloudGraphics;
 extern const TileGraphics ShoreGraphics;
@@ -78,14 +80,21 @@ void main ()
 	TileRegisters.ForegroundMapPages.Pages = 0x0047;
 	TileRegisters.ForegroundScrollY.Y = 4*8;
 	
+	// Frame budget: one bar per section, at the bottom of the screen.
+	static const char* const s_perfSections[] = { "Scroll", "Stats", "Meter" };
+	PERF_Init (s_perfSections, 3);
+
 	// Wait.	
 	uint16_t x = 0;
 	for (;;)
 	{
+		PERF_BeginFrame ();
+
 		// Update scroll position.
 		++x;
 		TileRegisters.BackgroundScrollX.X = (x >> 1);
 		TileRegisters.ForegroundScrollX.X++;
+		PERF_EndSection (0);
 		
 		// Display stats.
 		TEXT_GotoXY (2,3);
@@ -94,6 +103,10 @@ void main ()
 		TEXT_GotoXY (2,4);
 		TEXT_Write ("\010Fore\006"); // Their most accomplished album.
 		PrintScrollValue (TileRegisters.ForegroundScrollX.X);
+		PERF_EndSection (1);
+
+		PERFMETER_Draw (TEXT_SCREEN_VISIBLE_XSTART+2, 24, 16);
+		PERF_EndSection (2);
 		
 		IRQ4_Wait ();
 	}
@@ -2,6 +2,7 @@
 #define __IRQ_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" 
@@ -27,10 +28,28 @@ extern uint8_t IRQ_WaitAny ();
 
 // User defined IRQ handlers.
 // These are executed in user mode.
+// All registers are saved around them. They run while the interrupt line is still up, time the handlers would
+// otherwise spend waiting, so the IRQ4 one starts on line 223, the last visible one.
 typedef void IRQFUNC (void);
 extern void IRQ2_SetHandler (IRQFUNC* pFunc);
 extern void IRQ4_SetHandler (IRQFUNC* pFunc);
 
+// Handler chains, for per-frame work like sound, input and sprite updates that shouldn't have to share the one
+// handler above. Up to IRQ_MAX_HANDLERS handlers per level run after it, in the order they were added.
+// Light handlers have to be C functions, or follow the C calling convention: only D0-D1/A0-A1 are saved
+// for them, instead of all 15 registers. As long as all handlers of a level are light, that's all that is saved.
+// Adding returns false when the chain is full, or pFunc is already in it.
+#define IRQ_MAX_HANDLERS 4
+extern bool IRQ2_AddHandler (IRQFUNC* pFunc, bool bLight);
+extern bool IRQ4_AddHandler (IRQFUNC* pFunc, bool bLight);
+extern void IRQ2_RemoveHandler (IRQFUNC* pFunc);
+extern void IRQ4_RemoveHandler (IRQFUNC* pFunc);
+
+// For measuring what working while the line is up brings (samples/irqtime): when set, the handlers wait out
+// the scanline before doing any work and return with a plain rte, the way they used to. Off by default; when
+// off it costs two tests per interrupt.
+extern void IRQ_SetWaitFirst (bool bWaitFirst);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
@@ -0,0 +1,66 @@
+#ifndef __LOG_H__
+#define __LOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+/*
+	Structured logging to the host (orboot -log).
+
+	LOG_Write only copies a record into a ring buffer in RAM, so it's cheap enough to leave in hot code.
+	LOG_Flush sends buffered bytes in nibble mode, the same way the bootloader replies, but only while
+	the host is listening; without a host it returns right away. Call it once a frame, for example from
+	the main loop after IRQ4_Wait.
+
+	Records on the wire:
+		0xA5                          Sync
+		channel                       0..254, the meaning is up to the program
+		frame (high, low)             IRQ4_GetCounter when the record was written
+		length                        Payload size, 0..255
+		check                         XOR of channel, both frame bytes and length
+		payload
+
+	Bytes outside records are printed by orboot as before, so plain console output still works.
+	While flushing, the digital outputs are driven like the bootloader does (external mute on).
+
+	There can only be one writer and one flusher at a time; e.g. write from the main loop and flush
+	from the IRQ4 handler, but don't write from both without disabling interrupts.
+*/
+
+#define LOG_RECORD_SYNC     0xA5
+#define LOG_HEADER_SIZE     6
+#define LOG_BUFFER_SIZE     1024 // Power of two.
+
+// Reserved channel. When records are dropped because the buffer is full, a record on this channel
+// holding the number of dropped records (16 bit) is written ahead of the next record that fits.
+#define LOG_CHANNEL_DROPPED 0xFF
+
+// Buffers a record with nBytes of payload. Returns false (and counts it as dropped) if it doesn't fit.
+bool LOG_Write (uint8_t channel, const void* pData, uint8_t nBytes);
+
+// Buffers a zero terminated string, cut off at 255 characters.
+bool LOG_Print (uint8_t channel, const char* pText);
+
+// Buffers a single 32 bit value, for counters and timings.
+bool LOG_Value (uint8_t channel, uint32_t value);
+
+// Sends up to maxBytes buffered bytes, as long as the host keeps asserting HostBusy. Returns early when the
+// host doesn't take the first nibble of a byte in time; that byte is sent by the next call. A byte that was
+// started is always finished, so the host never gets out of step; if the host goes away in the middle of
+// one, this waits until it comes back, or until the watchdog resets the board.
+// Returns the number of bytes sent.
+uint16_t LOG_Flush (uint16_t maxBytes);
+
+// Number of buffered bytes that haven't been sent yet.
+uint16_t LOG_GetPending ();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // __LOG_H__
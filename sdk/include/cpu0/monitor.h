@@ -0,0 +1,59 @@
+#ifndef __MONITOR_H__
+#define __MONITOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+/*
+	Resident monitor, so orboot can push assets into palette, text, tile and sprite ram while the program
+	runs (orboot -push), instead of going through a reboot.
+
+	MONITOR_Install adds MONITOR_Poll to the IRQ2 handler chain, as a light handler. A poll returns right away when the host
+	isn't sending anything; otherwise it receives up to maxBytesPerPoll bytes. A complete packet is held in
+	a buffer until MONITOR_Apply copies it to video ram, so call that once a frame during vblank, for example
+	right after IRQ4_Wait. Programs can also call MONITOR_Poll from their own IRQ2 handler instead.
+
+	Packets are the framed address upload of the bootloader (_uploadaddress in boot.s), so orboot uses the
+	same code for both:
+		0x08                          Command
+		address (long), length (long) Destination and size, 1..MONITOR_MAX_PACKET bytes
+		check                         XOR of the previous 8 bytes
+		                              -> ACK or NAK
+		payload
+		CRC32 (long)                  Of the header (without the check byte) and the payload
+		                              -> ACK or NAK
+	Anything else, like a NOP (0x00), is ignored. Replies are sent in nibble mode like the bootloader does,
+	but the monitor gives up on a reply when the host doesn't pick it up in time.
+
+	While installed, the digital outputs are driven like the bootloader does (external mute on), with BUSY
+	low whenever the monitor can take a byte. Don't flush the log (log.h) while the host is pushing assets,
+	since both reply through the same lines.
+*/
+
+#define MONITOR_COMMAND    0x08 // COMMAND_UPLOADADDRESS in the bootloader.
+#define MONITOR_MAX_PACKET 1024 // Same as kSegmentBlockSize in orboot.
+
+// Installs the monitor in the IRQ2 handler chain. Each byte takes about 150 microseconds with
+// the default orboot timing, so keep maxBytesPerPoll low enough for the frame budget.
+void MONITOR_Install (uint16_t maxBytesPerPoll);
+void MONITOR_Uninstall ();
+
+// Receives whatever the host is sending, without waiting for it. Called from the IRQ2 handler.
+void MONITOR_Poll ();
+
+// Writes a received packet to video ram. Returns false if there was none.
+bool MONITOR_Apply ();
+
+// Number of packets written so far, so the program can tell when to pick up new assets.
+uint16_t MONITOR_GetApplied ();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // __MONITOR_H__
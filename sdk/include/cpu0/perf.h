@@ -0,0 +1,75 @@
+#ifndef __PERF_H__
+#define __PERF_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+/*
+	Frame budget meter: how many scanlines each part of a frame takes, measured on the hardware instead of
+	guessed. A frame is split into sections that run one after the other: PERF_BeginFrame starts the first
+	one, right after IRQ4_Wait, and PERF_EndSection (idx) ends section idx, which starts the next one.
+
+	There's no timer to read, so a position in the frame comes from the IRQ counters: IRQ4 resets at line 223
+	and IRQ2 counts the bands that start at lines 65, 129 and 193. Within a band, a calibrated busy loop fills
+	in the rest: the mark spins until the band ends, counting, and the count tells how many lines were left.
+	There's nothing else to count with, so the spin can't be cut short without losing the position.
+
+	The spin costs the rest of the band the mark is in: up to 104 lines (40% of a frame) in the first band,
+	and up to 64 in the others. So only one mark a frame is measured this way, taking turns; each section is
+	updated every nSections + 1 measured frames. Everything after the measured mark runs that much later,
+	and a frame that used most of its budget already runs past the next IRQ4 and misses a vblank: while a
+	meter runs, such a program drops to half its framerate every time the probe comes by. PERF_SetProbeInterval
+	spaces the measured frames out, so that happens less often. A section's length is the difference of its
+	two marks, measured in different frames, so it's only right while the frames run about the same.
+
+	Positions and lengths are in 1/PERF_SUBLINES of a scanline, counted from line 223 (IRQ4). A section that
+	ends in a later frame than it started counts PERF_FRAME_LINES for each frame in between.
+*/
+
+#define PERF_MAX_SECTIONS 8
+#define PERF_FRAME_LINES  262
+#define PERF_SUBLINES     16
+
+typedef struct
+{
+	const char* name;
+	uint16_t start;      // Where it started and ended, the last time both were measured.
+	uint16_t end;
+	uint16_t minLength;
+	uint16_t maxLength;
+	uint32_t sumLength;  // Over nSamples, for the average.
+	uint16_t nSamples;
+} PerfSection;
+
+// Calibrates the busy loop and clears the statistics. Call it with the interrupt handlers the program
+// runs with installed, since they slow the loop down too. Takes a few frames.
+void PERF_Init (const char* const* pNames, uint8_t nSections);
+
+// Starts a frame, and section 0. Call it right after IRQ4_Wait.
+void PERF_BeginFrame ();
+
+// Ends section idx; the next one starts here.
+void PERF_EndSection (uint8_t idx);
+
+// Only measures a mark every nFrames frames (default 1), and leaves the frames in between alone.
+void PERF_SetProbeInterval (uint8_t nFrames);
+
+// Clears min, max and average, e.g. when the scene changes.
+void PERF_ResetStats ();
+
+uint8_t PERF_GetNumSections ();
+const PerfSection* PERF_GetSection (uint8_t idx);
+
+// Average length, in 1/PERF_SUBLINES of a scanline.
+uint16_t PERF_GetAverage (const PerfSection* pSection);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // __PERF_H__
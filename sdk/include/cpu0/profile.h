@@ -0,0 +1,66 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+/*
+	Statistical profiler. While started, the IRQ2 and IRQ4 handlers add the PC they interrupted to a
+	histogram in RAM: four samples a frame, 240 a second. PROFILE_Send streams what was counted to the
+	host as log records (log.h), and orboot -profile turns those into a flat per-function profile, using
+	the map file the linker writes next to the binary (maincpu_ram.map).
+
+	The sub CPU samples from its IRQ4 handler only (see cpu1/profile.h), into a histogram in sub RAM.
+	The main program can send that one too, through SUB_RAM_BASE, when both programs agree on where it is.
+
+	Records on LOG_CHANNEL_PROFILE:
+		cpu                           0 = main, 1 = sub; which map file to use
+		shift                         Each bucket covers 1 << shift bytes
+		base (long)                   Address of bucket 0
+		bucket, count (words)         Up to PROFILE_MAX_PAIRS of them; bucket 0xFFFF counts nOutside
+	Counts are what was sampled since the previous record for that bucket, so the host adds them up.
+*/
+
+#define LOG_CHANNEL_PROFILE       0xFE
+#define PROFILE_RECORD_HEADER     6
+#define PROFILE_MAX_PAIRS         62
+#define PROFILE_BUCKET_OUTSIDE    0xFFFF
+
+// Layout is shared with _profile_sample in irq.s.
+typedef struct
+{
+	uint32_t base;                // Start of the program (_stext in the linker script).
+	uint16_t nBuckets;
+	uint8_t shift;
+	uint8_t cpu;
+	uint16_t nOutside;            // Samples outside the buckets, like in the bootloader or the data.
+	uint16_t sendCursor;          // Where PROFILE_Send goes on.
+	uint16_t buckets[];           // Sample counts; they stop at 0xFFFF.
+} ProfileHistogram;
+
+// Bytes needed for a histogram, e.g. static uint16_t s_profile[PROFILE_SIZE(1024) / 2].
+#define PROFILE_SIZE(nBuckets)    (sizeof (ProfileHistogram) + (nBuckets) * sizeof (uint16_t))
+
+// Clears the histogram and starts sampling. The buckets are spread over the whole program, from _stext
+// to _etext, in the smallest power of two that fits; 1024 buckets give 32 bytes each for 32KB of code.
+void PROFILE_Start (ProfileHistogram* pHistogram, uint16_t nBuckets);
+
+// Stops sampling. The histogram can still be sent afterwards.
+void PROFILE_Stop ();
+
+// Writes up to maxRecords records with the samples counted since the last call, and takes them out of
+// the histogram. Stops early when the log buffer is full. Call it from the main loop, like LOG_Flush.
+// Works for the histogram of the sub CPU too; a sample it counts while this runs may get lost.
+// Returns the number of records written.
+uint8_t PROFILE_Send (volatile ProfileHistogram* pHistogram, uint8_t maxRecords);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // __PROFILE_H__
@@ -116,6 +116,44 @@ static inline void SPRITE_SwapBuffers (void) { __asm__("not.w 0x140070.l"); }
 // They're not currently being emulated in MAME.
 // Add PPI wrapper functions here, if necessary.
 
+/*
+	Shadow sprite list: the program keeps its sprites in main RAM and SPRITE_ShadowCommit writes only what
+	changed to sprite RAM, once a frame. Scenes where most sprites stand still then cost a few entries of
+	sprite RAM writes a frame instead of all of them.
+
+	Entries are allocated and freed by index and keep it, so the list never moves around; a freed entry
+	stays in the list as a hidden sprite, and the terminator goes after the highest allocated one. Changing
+	an entry goes through SPRITE_ShadowEdit, which marks it dirty.
+
+	Sprite RAM is double buffered: the CPU writes one half while the generator reads the other, and
+	SPRITE_SwapBuffers flips them. So each half has its own dirty bits, and an edit is written twice, once
+	in each of the next two commits. Don't call SPRITE_SwapBuffers yourself when using the shadow list, or
+	it loses track of which half is which.
+*/
+
+#define SPRITE_SHADOW_NONE 0xff
+
+// Frees all entries. Doesn't touch sprite RAM; the next two commits write both halves.
+void SPRITE_ShadowInit ();
+
+// Returns the lowest free entry, or SPRITE_SHADOW_NONE when all SPRITE_LIMIT are taken. The entry comes
+// back hidden, with the rest of it as it was; fill it in through SPRITE_ShadowEdit and clear Hidden.
+uint8_t SPRITE_ShadowAlloc ();
+
+// Hides the entry, and gives it back.
+void SPRITE_ShadowFree (uint8_t idx);
+
+// Marks the entry dirty and returns it, to change. Changes made through an older pointer after the
+// next commit are not written unless the entry is edited again.
+SpriteData* SPRITE_ShadowEdit (uint8_t idx);
+
+// Writes the dirty entries and the terminator to the CPU half of sprite RAM, then swaps the halves.
+// Call it once a frame, where the program would call SPRITE_SwapBuffers.
+void SPRITE_ShadowCommit ();
+
+// Entries up to the terminator, i.e. the highest allocated one + 1.
+uint8_t SPRITE_ShadowGetCount ();
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
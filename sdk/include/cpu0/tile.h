@@ -66,6 +66,7 @@
 
 #include "maincpu.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" 
@@ -182,6 +183,59 @@ static inline uint16_t* TILE_GetPagePtr (uint8_t pageIdx)
 // Also resets all tile registers.
 void TILE_Reset ();
 
+/*
+	Tile write queue. Writing tile ram while the screen is drawn tears, and a big map update eats a chunk
+	of whatever frame it happens in. Queued writes are done by the IRQ4 handler instead, after its user
+	handlers, up to a budget per frame; what doesn't fit is picked up in the next frame. The handler starts
+	on line 223, the last visible one, so without other handlers the first few writes can still show there.
+
+	Tiles are addressed as (page, x, y), in 8x8 tiles. Sources aren't copied, so they have to stay put
+	until the queue has written them; TILE_QueueSync waits for that. A write that would go past the end
+	of the page is refused.
+
+	A push returns false when the write can't be queued: the queue is full (TILE_QUEUE_SIZE writes) or it
+	doesn't fit in the page. The queue only runs while installed, but writes can be queued before that.
+*/
+
+#define TILE_QUEUE_SIZE             128   // Writes of any size, minus one, that can be waiting. Enough for a page of columns.
+#define TILE_QUEUE_CYCLES_PER_WORD  32    // What the budget assumes one tile costs; a column tile is the slowest.
+#define TILE_QUEUE_CYCLES_PER_WRITE 256   // And the overhead of every slice of a write.
+#define TILE_QUEUE_DEFAULT_BUDGET   12000 // About half of vblank (38 lines of 655 cycles).
+
+typedef struct
+{
+	uint16_t nPending;        // Writes still queued.
+	uint32_t nPendingWords;   // Tiles still to be written.
+	uint32_t maxPendingWords; // The most that was ever waiting.
+	uint32_t nWordsWritten;   // Tiles written by the queue so far.
+	uint16_t nBusyFrames;     // Frames that used up the budget and left work for the next one.
+	uint16_t nRefused;        // Pushes that returned false.
+} TileQueueStats;
+
+// Starts running the queue from the IRQ4 handler, for up to cyclesPerFrame (0 for the default) a frame.
+void TILE_QueueInstall (uint16_t cyclesPerFrame);
+void TILE_QueueUninstall ();
+
+// Fills count tiles from (x, y) onwards, wrapping to the next rows. A whole page is 0, 0, 2048 tiles.
+bool TILE_QueueFill (uint8_t pageIdx, uint8_t x, uint8_t y, uint16_t count, uint16_t tileIdx);
+
+// Copies count tiles to (x, y) onwards, wrapping to the next rows like TILE_QueueFill.
+bool TILE_QueueCopy (uint8_t pageIdx, uint8_t x, uint8_t y, const uint16_t* pSrc, uint16_t count);
+
+// Patches a single row, from x to the right. Doesn't wrap.
+bool TILE_QueueRow (uint8_t pageIdx, uint8_t x, uint8_t y, const uint16_t* pSrc, uint8_t count);
+
+// Patches a single column, from y down; with bUp from y up, which is how UnpackTileMap stores them.
+bool TILE_QueueColumn (uint8_t pageIdx, uint8_t x, uint8_t y, const uint16_t* pSrc, uint8_t count, bool bUp);
+
+// Writes that can still be pushed.
+uint16_t TILE_QueueGetFree ();
+
+// Waits for all queued writes to be done. Only while installed, and with interrupts on.
+void TILE_QueueSync ();
+
+void TILE_QueueGetStats (TileQueueStats* pStats);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
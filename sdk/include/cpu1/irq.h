@@ -16,6 +16,8 @@ extern void IRQ4_Wait ();
 
 // User defined IRQ handler.
 // This should be executed in user mode.
+// All registers are saved around it. It runs while the interrupt line is still up (the rest of line 223), time
+// the handler would otherwise spend waiting.
 typedef void IRQFUNC (void);
 extern void IRQ4_SetHandler (IRQFUNC* pFunc);
 
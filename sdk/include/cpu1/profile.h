@@ -0,0 +1,45 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+/*
+	Statistical profiler for the sub CPU, like the one of the main CPU (see cpu0/profile.h). The IRQ4
+	handler adds the PC it interrupted to a histogram in RAM, once a frame. The sub CPU can't reach the
+	host, so the main program sends the histogram with PROFILE_Send, through SUB_RAM_BASE. Put it at an
+	address both programs know, for example:
+		sub:  #define SUB_PROFILE ((ProfileHistogram*)0x067000)
+		main: #define SUB_PROFILE ((volatile ProfileHistogram*)((uint32_t)SUB_RAM_BASE + 0x7000))
+	and keep that part of sub RAM clear of the program and the stacks.
+*/
+
+// Layout is shared with _profile_sample in irq.s, and with cpu0/profile.h.
+typedef struct
+{
+	uint32_t base;                // Start of the program (_stext in the linker script).
+	uint16_t nBuckets;
+	uint8_t shift;
+	uint8_t cpu;
+	uint16_t nOutside;            // Samples outside the buckets.
+	uint16_t sendCursor;          // Used by PROFILE_Send on the main CPU.
+	uint16_t buckets[];           // Sample counts; they stop at 0xFFFF.
+} ProfileHistogram;
+
+#define PROFILE_SIZE(nBuckets)    (sizeof (ProfileHistogram) + (nBuckets) * sizeof (uint16_t))
+
+// Clears the histogram and starts sampling, spread over the program from _stext to _etext.
+void PROFILE_Start (ProfileHistogram* pHistogram, uint16_t nBuckets);
+
+// Stops sampling.
+void PROFILE_Stop ();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // __PROFILE_H__
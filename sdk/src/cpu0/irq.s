@@ -5,8 +5,12 @@
 	- IRQ enable/disable: Functionality to control whether interrupts are enabled from the user code.
 	- IRQ waiting:        Wait for a flag to be reset upon interrupt from user code.
 	- User Handler:       User function (C) to be invoked upon interrupt. Optional.
+	- Handler chains:     Up to IRQ_MAX_HANDLERS more per level. Light ones only get the C scratch registers saved.
 	- Watchdog Reset:     Handles automatic watchdog reset once a frame, when enabled.
 	- Clock:              Frame counter. Runs for about 1092 seconds, then wraps. Can be used as 60Hz clock.
+	- Tile queue:         Queued tile ram writes (tile.h), done in vblank when installed.
+	- Scanline wait:      The interrupt lines stay up for a whole scanline. The handlers do their work in that
+	                      time and only wait out what is left of it, by returning through a resume stub.
 */
 
 /* Note: we need to force this object file into linking, unfortunately, by referencing it from startup.s */
@@ -24,6 +28,13 @@
 .global IRQ_WaitAny
 .global IRQ2_SetHandler
 .global IRQ4_SetHandler
+.global IRQ2_AddHandler
+.global IRQ4_AddHandler
+.global IRQ2_RemoveHandler
+.global IRQ4_RemoveHandler
+.global IRQ_SetWaitFirst
+.global _profile_histogram
+.global _tile_queue_flush
 
 .bss
 
@@ -39,11 +50,31 @@ _irq4_wait_ack:
 _irq2_counter:
 .byte 0
 
+/* Set by IRQ_SetWaitFirst: wait out the scanline before the work, like the handlers used to. */
+_irq_wait_first:
+.byte 0
+
 /* Incremented by IRQ4. */
 .align 2
 _irq4_counter:
 .word 0
 
+/* Histogram of the PC sampling profiler, set by PROFILE_Start. */
+.align 4
+_profile_histogram:
+.int 0
+
+/* Runs the tile queue, set by TILE_QueueInstall. */
+_tile_queue_flush:
+.int 0
+
+/* Where the interrupted code goes on, see _irq2_resume */
+.align 4
+_irq2_return_pc:
+.int 0
+_irq4_return_pc:
+.int 0
+
 /* User defined IRQ functions */
 .align 4
 _irq2_userhandler:
@@ -51,29 +82,103 @@ _irq2_userhandler:
 _irq4_userhandler:
 .int 0
 
+/* Handler chains. Keep IRQ_MAX_HANDLERS in sync with irq.h, and with RUN_CHAIN.
+   A chain is IRQ_MAX_HANDLERS pointers and a zero, the same for the flags (set for handlers that want all
+   registers saved), and the number of those. */
+.equ IRQ_MAX_HANDLERS, 4
+.equ CHAIN_FLAGS,      4 * (IRQ_MAX_HANDLERS + 1)
+.equ CHAIN_NFULL,      CHAIN_FLAGS + IRQ_MAX_HANDLERS + 1
+.equ CHAIN_SIZE,       CHAIN_NFULL + 1
+
+.align 4
+_irq2_handlers:
+.space CHAIN_SIZE
+.align 4
+_irq4_handlers:
+.space CHAIN_SIZE
+
+/* Calls the handlers in a chain, up to the first empty slot. Only touches the scratch registers. */
+.macro RUN_CHAIN chain
+	.irp slot, 0, 1, 2, 3
+	move.l   \chain+4*\slot, %D0
+	beq      9f
+	movea.l  %D0, %A0
+	jsr      (%A0)
+	.endr
+9:
+.endm
+
+/* Runs a chain, saving everything if any of its handlers needs that. Ends up at done. */
+.macro CALL_CHAIN chain, full, done
+	tst.l    \chain
+	beq      \done
+	tst.b    \chain+CHAIN_NFULL
+	bne      \full
+	movem.l  %D0-%D1/%A0-%A1, -(%A7)
+	RUN_CHAIN \chain
+	movem.l  (%A7)+, %D0-%D1/%A0-%A1
+	bra      \done
+\full:
+	movem.l  %D0-%D7/%A0-%A6, -(%A7)
+	RUN_CHAIN \chain
+	movem.l  (%A7)+, %D0-%D7/%A0-%A6
+.endm
+
+/* The interrupt line stays up for the rest of the scanline (654.8 cycles @ 10Mhz; 262 lines @ 60fps), so the
+   interrupt would trigger again on rte. Instead of waiting that out before doing anything, a handler does its
+   work and then returns through a resume stub. If the line is still up, the interrupt comes back right away
+   with the stub as the PC, and the handler just returns to it again: that's the wait, and it only takes what
+   the work didn't. Once the line is down, the stub goes on to where the code was interrupted. */
+.macro RETURN_VIA resume, pc
+	move.l   (2, %A7), \pc
+	move.l   #\resume, (2, %A7)
+	rte
+.endm
+
+/* Jumps to the saved PC without touching any registers or flags: subq to an address register and movem
+   leave the condition codes alone. */
+.macro RESUME pc
+	subq.l   #4, %A7               /* Room for the return address */
+	movem.l  %A0, -(%A7)
+	movem.l  \pc, %A0
+	movem.l  %A0, (4, %A7)
+	movem.l  (%A7)+, %A0
+	rts
+.endm
+
 .text
 
 __irq_2_handler:
 
+	/* Back while the line is still up */
+	cmpi.l   #_irq2_resume, (2, %A7)
+	beq      _irq2_retrigger
+
+	/* Profiler; has to come before anything goes on the stack */
+	tst.l    _profile_histogram
+	beq      _irq2_sampled
+	bsr      _profile_sample
+_irq2_sampled:
+
 	/* Update counters: Increment IRQ 2 counter (0..1..2..3) */
 	addb #1, _irq2_counter
 
 	/* Reset wait */
 	clr.b    _irq2_wait_ack
-	
-	/* Wait out the rest of the scanline so the interrupt doesn't trigger twice.
-	   we have 262 scanlines @ 60fps = 15720 scanlines per second. So one scanline is 654,8 cycles @ 10Mhz.
-	   Since dbra takes at least 10 cycles, we can loop 66x to waste at least 660 cycles */
+
+	/* The old way, for comparison: wait out the rest of the scanline (66 dbra loops of 10 cycles) first */
+	tst.b    _irq_wait_first
+	beq      _irq2_nowait
 	move.l   %D0, -(%A7)
-	clr.l    %D0
-	move.b   #66, %D0
+	moveq    #66, %D0
 _irq2_wait:
 	dbra     %D0, _irq2_wait
 	move.l   (%A7)+, %D0
-	
+_irq2_nowait:
+
 	/* User function */
 	tst.l    _irq2_userhandler
-	beq      _irq2_done
+	beq      _irq2_chain
 	
 	/* Store registers on the stack */
 	movem.l %D0-%D7/%A0-%A6, -(%A7)
@@ -86,11 +191,31 @@ _irq2_wait:
 	/* Restore registers from the stack */
 	movem.l (%A7)+, %D0-%D7/%A0-%A6
 
+_irq2_chain:
+	CALL_CHAIN _irq2_handlers, _irq2_chain_full, _irq2_done
+
 _irq2_done:
+	tst.b    _irq_wait_first       /* The line is down already */
+	bne      _irq2_retrigger
+	RETURN_VIA _irq2_resume, _irq2_return_pc
+_irq2_retrigger:
 	rte
+
+_irq2_resume:
+	RESUME _irq2_return_pc
 	
 __irq_4_handler:
 
+	/* Back while the line is still up */
+	cmpi.l   #_irq4_resume, (2, %A7)
+	beq      _irq4_retrigger
+
+	/* Profiler; has to come before anything goes on the stack */
+	tst.l    _profile_histogram
+	beq      _irq4_sampled
+	bsr      _profile_sample
+_irq4_sampled:
+
 	/* Watchdog clear, could be optional */
 	tst.w 0x140060.l 
 
@@ -100,31 +225,74 @@ __irq_4_handler:
 
 	/* Reset wait */
 	clr.b    _irq4_wait_ack
-	
-	/* Wait out the rest of the scanline so the interrupt doesn't trigger twice.
-	   we have 262 scanlines @ 60fps = 15720 scanlines per second. So one scanline is 654,8 cycles @ 10Mhz.
-	   Since dbra takes at least 10 cycles, we can loop 66x to waste at least 660 cycles */
+
+	/* The old way, for comparison: wait out the rest of the scanline (66 dbra loops of 10 cycles) first */
+	tst.b    _irq_wait_first
+	beq      _irq4_nowait
 	move.l   %D0, -(%A7)
-	clr.l    %D0
-	move.b   #66, %D0
+	moveq    #66, %D0
 _irq4_wait:
 	dbra     %D0, _irq4_wait
-	/* We are now at scanline 224 (invisible) */
 	move.l   (%A7)+, %D0
-
-	/* Check for user function */
-	
-	/* Store registers on the stack */
-	/*movem.l %D0-%D7/%A0-%A6, -(%A7) */
-
-	/* Run user handlers */
-	/* ... */
-
-	/* Restore registers from the stack */
-	/* movem.l (%A7)+, %D0-%D7/%A0-%A6 */
-
+_irq4_nowait:
+
+	/* User function. This starts on line 223, the last visible one; vblank follows */
+	tst.l    _irq4_userhandler
+	beq      _irq4_chain
+	movem.l  %D0-%D7/%A0-%A6, -(%A7)
+	move.l   _irq4_userhandler, %A0
+	jsr      (%A0)
+	movem.l  (%A7)+, %D0-%D7/%A0-%A6
+
+_irq4_chain:
+	CALL_CHAIN _irq4_handlers, _irq4_chain_full, _irq4_chained
+_irq4_chained:
+
+	/* Tile queue, after the handlers, so sprite and scroll updates go first and the writes get into vblank;
+	   a C function, so only the scratch registers need saving */
+	tst.l    _tile_queue_flush
+	beq      _irq4_flushed
+	movem.l  %D0-%D1/%A0-%A1, -(%A7)
+	movea.l  _tile_queue_flush, %A0
+	jsr      (%A0)
+	movem.l  (%A7)+, %D0-%D1/%A0-%A1
+_irq4_flushed:
+	tst.b    _irq_wait_first
+	bne      _irq4_retrigger
+	RETURN_VIA _irq4_resume, _irq4_return_pc
+_irq4_retrigger:
 	rte
 
+_irq4_resume:
+	RESUME _irq4_return_pc
+
+/* Adds the interrupted PC to the histogram at _profile_histogram (ProfileHistogram in profile.h).
+   Called first thing in a handler, so our return address is followed by the SR and PC of the exception frame. */
+_profile_sample:
+	movem.l  %D0-%D1/%A0, -(%A7)
+	movea.l  _profile_histogram, %A0
+	move.l   (18, %A7), %D0        /* 12 bytes of registers, the return address and the SR */
+	sub.l    (%A0), %D0            /* base */
+	bcs      _profile_sample_outside
+	move.b   (6, %A0), %D1         /* shift */
+	lsr.l    %D1, %D0
+	moveq    #0, %D1
+	move.w   (4, %A0), %D1         /* nBuckets */
+	cmp.l    %D1, %D0
+	bcc      _profile_sample_outside
+	add.l    %D0, %D0
+	addq.w   #1, (12, %A0, %D0.l)  /* buckets */
+	bcc      _profile_sample_done
+	subq.w   #1, (12, %A0, %D0.l)  /* Saturate */
+	bra      _profile_sample_done
+_profile_sample_outside:
+	addq.w   #1, (8, %A0)          /* nOutside */
+	bcc      _profile_sample_done
+	subq.w   #1, (8, %A0)
+_profile_sample_done:
+	movem.l  (%A7)+, %D0-%D1/%A0
+	rts
+
 __dummy_irq_handler:
 	rte
 
@@ -202,3 +370,103 @@ IRQ4_SetHandler:
 	and.w #7, %D0
 	trap #0
 	rts
+
+IRQ_SetWaitFirst:
+	move.b   (7, %A7), _irq_wait_first  /* bWaitFirst; the bool argument is in the low byte of its long */
+	rts
+
+IRQ2_AddHandler:
+	lea      _irq2_handlers, %A0
+	bra      _irq_add_handler
+
+IRQ4_AddHandler:
+	lea      _irq4_handlers, %A0
+	bra      _irq_add_handler
+
+IRQ2_RemoveHandler:
+	lea      _irq2_handlers, %A0
+	bra      _irq_remove_handler
+
+IRQ4_RemoveHandler:
+	lea      _irq4_handlers, %A0
+	bra      _irq_remove_handler
+
+/* Appends pFunc to the chain at A0. Arguments as for IRQx_AddHandler, still on the stack. */
+_irq_add_handler:
+	/* Save old IRQ flags and disable all interrupts, like IRQ2_SetHandler */
+	move.w   %SR, -(%SP)
+	moveq    #7, %D0
+	trap     #0
+
+	/* Find the end of the chain; pFunc shouldn't be in it yet */
+	move.l   (6, %A7), %D1         /* pFunc */
+	movea.l  %A0, %A1
+_irq_add_find:
+	move.l   (%A1), %D0
+	beq      _irq_add_found
+	cmp.l    %D0, %D1
+	beq      _irq_add_fail
+	addq.l   #4, %A1
+	bra      _irq_add_find
+_irq_add_found:
+	move.l   %A1, %D0
+	sub.l    %A0, %D0
+	cmp.w    #4 * IRQ_MAX_HANDLERS, %D0
+	beq      _irq_add_fail         /* That's the terminator: full */
+	lsr.w    #2, %D0
+	tst.b    (13, %A7)             /* bLight; the bool argument is in the low byte of its long */
+	seq      (CHAIN_FLAGS, %A0, %D0.w)
+	bne      _irq_add_light
+	addq.b   #1, (CHAIN_NFULL, %A0)
+_irq_add_light:
+	move.l   %D1, (%A1)
+	movea.w  #1, %A1               /* Return true; D0 and D1 go to the trap */
+	bra      _irq_add_done
+_irq_add_fail:
+	suba.l   %A1, %A1
+_irq_add_done:
+
+	/* Restore previous interrupt state */
+	move.w   (%SP)+, %D0
+	lsr.w    #8, %D0
+	and.w    #7, %D0
+	trap     #0
+	move.l   %A1, %D0
+	rts
+
+/* Takes pFunc out of the chain at A0, and moves the ones after it up. */
+_irq_remove_handler:
+	move.w   %SR, -(%SP)
+	moveq    #7, %D0
+	trap     #0
+
+	move.l   (6, %A7), %D1         /* pFunc */
+	movea.l  %A0, %A1
+_irq_remove_find:
+	move.l   (%A1), %D0
+	beq      _irq_remove_done
+	cmp.l    %D0, %D1
+	beq      _irq_remove_found
+	addq.l   #4, %A1
+	bra      _irq_remove_find
+_irq_remove_found:
+	move.l   %A1, %D0
+	sub.l    %A0, %D0
+	lsr.w    #2, %D0
+	tst.b    (CHAIN_FLAGS, %A0, %D0.w)
+	beq      _irq_remove_shift
+	subq.b   #1, (CHAIN_NFULL, %A0)
+_irq_remove_shift:
+	/* Up to and including the terminating zero, which is always there */
+	move.b   (CHAIN_FLAGS + 1, %A0, %D0.w), (CHAIN_FLAGS, %A0, %D0.w)
+	addq.w   #1, %D0
+	move.l   (4, %A1), (%A1)+
+	bne      _irq_remove_shift
+_irq_remove_done:
+
+	/* Restore previous interrupt state */
+	move.w   (%SP)+, %D0
+	lsr.w    #8, %D0
+	and.w    #7, %D0
+	trap     #0
+	rts
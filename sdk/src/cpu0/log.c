@@ -0,0 +1,148 @@
+#include "io.h"
+#include "irq.h"
+#include "log.h"
+
+#define LOG_BUFFER_MASK (LOG_BUFFER_SIZE-1)
+
+// HostBusy (nAUTOFEED) shows up on the Test input, active low.
+#define LOG_HOSTBUSY_MASK DIGITAL_INPUT_1_Test
+#define LOG_DIGITAL_IN_1  (((volatile uint8_t*)IO_DIGITAL_INPUT_BASE)[1])
+#define LOG_DIGITAL_OUT   (*((volatile uint8_t*)(IO_DIGITAL_OUT_ADDR+1)))
+
+// How long to wait for the host to take the first nibble of a byte, like MONITOR_REPLY_SPINS.
+#define LOG_NIBBLE_SPINS  1000
+
+static uint8_t s_log_buffer[LOG_BUFFER_SIZE];
+static volatile uint16_t s_log_head = 0; // Written by LOG_Write only.
+static volatile uint16_t s_log_tail = 0; // Written by LOG_Flush only.
+static uint16_t s_log_nDropped = 0;
+
+static bool LOG_PutRecord (uint8_t channel, const uint8_t* pData, uint8_t nBytes)
+{
+	uint16_t head = s_log_head;
+	uint16_t nFree = (s_log_tail - head - 1) & LOG_BUFFER_MASK;
+	if (nBytes + LOG_HEADER_SIZE > nFree)
+		return false;
+
+	uint16_t frame = IRQ4_GetCounter ();
+	uint8_t frameHigh = frame >> 8;
+	uint8_t frameLow = frame;
+
+	s_log_buffer[head] = LOG_RECORD_SYNC;  head = (head+1) & LOG_BUFFER_MASK;
+	s_log_buffer[head] = channel;          head = (head+1) & LOG_BUFFER_MASK;
+	s_log_buffer[head] = frameHigh;        head = (head+1) & LOG_BUFFER_MASK;
+	s_log_buffer[head] = frameLow;         head = (head+1) & LOG_BUFFER_MASK;
+	s_log_buffer[head] = nBytes;           head = (head+1) & LOG_BUFFER_MASK;
+	s_log_buffer[head] = channel ^ frameHigh ^ frameLow ^ nBytes; head = (head+1) & LOG_BUFFER_MASK;
+
+	// Copy in at most two runs, so the loops don't have to wrap.
+	uint16_t nFirst = LOG_BUFFER_SIZE - head;
+	if (nFirst > nBytes)
+		nFirst = nBytes;
+	uint8_t* pDest = s_log_buffer + head;
+	for (uint16_t i=0; i<nFirst; i++)
+		*pDest++ = *pData++;
+	pDest = s_log_buffer;
+	for (uint16_t i=nFirst; i<nBytes; i++)
+		*pDest++ = *pData++;
+
+	// Publish the record in one go.
+	s_log_head = (head + nBytes) & LOG_BUFFER_MASK;
+	return true;
+}
+
+bool LOG_Write (uint8_t channel, const void* pData, uint8_t nBytes)
+{
+	// Report earlier drops first, so the host knows where the gap is.
+	if (s_log_nDropped)
+	{
+		uint16_t nDropped = s_log_nDropped;
+		if (!LOG_PutRecord (LOG_CHANNEL_DROPPED, (const uint8_t*)&nDropped, sizeof (nDropped)))
+		{
+			if (s_log_nDropped != 0xffff)
+				s_log_nDropped++;
+			return false;
+		}
+		s_log_nDropped = 0;
+	}
+
+	if (!LOG_PutRecord (channel, (const uint8_t*)pData, nBytes))
+	{
+		s_log_nDropped++;
+		return false;
+	}
+
+	return true;
+}
+
+bool LOG_Print (uint8_t channel, const char* pText)
+{
+	uint16_t nBytes = 0;
+	while (pText[nBytes] && nBytes < 255)
+		nBytes++;
+	return LOG_Write (channel, pText, (uint8_t)nBytes);
+}
+
+bool LOG_Value (uint8_t channel, uint32_t value)
+{
+	// Big endian, like everything else on the wire.
+	return LOG_Write (channel, &value, sizeof (value));
+}
+
+// Sends the low nibble in the same way as SEND_NIBBLE in the bootloader. With bMayGiveUp set it gives up
+// when the host doesn't ask for it in time, which is only safe before PtrClk goes low: from then on the host
+// may have the nibble, and the rest of the byte has to follow or the host is a nibble out of step for good.
+static bool LOG_SendNibble (uint8_t nibble, bool bMayGiveUp)
+{
+	// Keep the external mute and PtrClk (nACK) high.
+	uint8_t out = (nibble & 0xf) | 0x90;
+
+	uint16_t spins = LOG_NIBBLE_SPINS;
+	while (LOG_DIGITAL_IN_1 & LOG_HOSTBUSY_MASK)
+		if (bMayGiveUp && !spins--)
+			return false;
+
+	// Give the status lines ~50 microseconds to settle.
+	LOG_DIGITAL_OUT = out;
+	uint16_t settle = 50;
+	__asm__ volatile ("1: dbra %0, 1b" : "+d" (settle));
+
+	// Pull PtrClk low, and wait for the host to release HostBusy once it has read the nibble.
+	LOG_DIGITAL_OUT = out & ~0x10;
+	while (!(LOG_DIGITAL_IN_1 & LOG_HOSTBUSY_MASK))
+		;
+	LOG_DIGITAL_OUT = out;
+	return true;
+}
+
+uint16_t LOG_Flush (uint16_t maxBytes)
+{
+	uint16_t tail = s_log_tail;
+	uint16_t head = s_log_head;
+	uint16_t nSent = 0;
+
+	// Only start a byte while the host is waiting for one. If the host doesn't take the first nibble, the byte
+	// stays in the buffer for the next flush. Once it has, the byte is finished however long the host takes;
+	// a host that goes away halfway stalls the program until it comes back, or the watchdog resets the board.
+	while (tail != head && nSent < maxBytes && !(LOG_DIGITAL_IN_1 & LOG_HOSTBUSY_MASK))
+	{
+		uint8_t byte = s_log_buffer[tail];
+		bool bStarted = LOG_SendNibble (byte, true);
+		if (bStarted)
+			LOG_SendNibble (byte >> 4, false);
+		LOG_DIGITAL_OUT = 0x98;
+		if (!bStarted)
+			break;
+
+		tail = (tail+1) & LOG_BUFFER_MASK;
+		s_log_tail = tail;
+		nSent++;
+	}
+
+	return nSent;
+}
+
+uint16_t LOG_GetPending ()
+{
+	return (s_log_head - s_log_tail) & LOG_BUFFER_MASK;
+}
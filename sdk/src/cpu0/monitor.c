@@ -0,0 +1,299 @@
+#include "io.h"
+#include "irq.h"
+#include "monitor.h"
+
+// nSTROBE shows up on bit 0 of digital input 1 and HostBusy (nAUTOFEED) on the Test input, both active low.
+// The data lines are on digital input 2.
+#define MONITOR_STROBE_MASK    0x01
+#define MONITOR_HOSTBUSY_MASK  DIGITAL_INPUT_1_Test
+#define MONITOR_DIGITAL_IN_1   (((volatile uint8_t*)IO_DIGITAL_INPUT_BASE)[1])
+#define MONITOR_DIGITAL_IN_2   (((volatile uint8_t*)IO_DIGITAL_INPUT_BASE)[3])
+#define MONITOR_DIGITAL_OUT    (*((volatile uint8_t*)(IO_DIGITAL_OUT_ADDR+1)))
+
+// Output register values, as in _readchar.
+#define MONITOR_OUT_READY      0x90 // BUSY low: we can take a byte.
+#define MONITOR_OUT_IDLE       0x98 // BUSY and nACK high.
+#define MONITOR_OUT_ACK        0x88 // Byte read: nACK pulsed low.
+
+// Wait loop iterations are a few microseconds each. The host sends a byte every ~150 microseconds
+// during a packet, and starts reading a reply right after sending the last byte.
+#define MONITOR_BYTE_SPINS     100
+#define MONITOR_RELEASE_SPINS  200
+#define MONITOR_REPLY_SPINS    1000
+
+#define MONITOR_REPLY_ACK      0x06
+#define MONITOR_REPLY_NAK      0x15
+#define MONITOR_HEADER_SIZE    9
+
+// MONITOR_ReadByte results besides a byte.
+#define MONITOR_READ_NONE      -1   // The host didn't strobe.
+#define MONITOR_READ_STUCK     -2   // The host didn't release STROBE; the byte may come again.
+
+typedef enum
+{
+	MONITOR_STATE_COMMAND,
+	MONITOR_STATE_HEADER,
+	MONITOR_STATE_DATA,
+	MONITOR_STATE_CRC,
+} MonitorState;
+
+// Video ram we may write to: start, end (exclusive). Tile and text ram are adjacent.
+static const uint32_t s_monitor_regions[][2] =
+{
+	{ 0x100000, 0x111000 }, // Tile and text ram
+	{ 0x120000, 0x122000 }, // Palette ram
+	{ 0x130000, 0x131000 }, // Sprite ram
+};
+
+// CRC32 (0xedb88320) a nibble at a time, which is small enough to keep around in a program.
+static const uint32_t s_monitor_crc_table[16] =
+{
+	0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+	0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+static uint8_t s_monitor_buffer[MONITOR_MAX_PACKET];
+static uint8_t s_monitor_header[MONITOR_HEADER_SIZE];
+static uint8_t s_monitor_state = MONITOR_STATE_COMMAND;
+static uint16_t s_monitor_received = 0;
+static uint16_t s_monitor_length = 0;
+static uint32_t s_monitor_address = 0;
+static uint32_t s_monitor_crc = 0;
+static uint32_t s_monitor_hostCRC = 0;
+static uint16_t s_monitor_bytesPerPoll = 0;
+static uint16_t s_monitor_nApplied = 0;
+static volatile bool s_monitor_bPending = false; // Set by MONITOR_Poll, cleared by MONITOR_Apply.
+static bool s_monitor_bStuck = false;            // STROBE hasn't been seen high since a release timed out.
+
+static uint32_t MONITOR_UpdateCRC (uint32_t crc, uint8_t byte)
+{
+	crc ^= byte;
+	crc = (crc >> 4) ^ s_monitor_crc_table[crc & 0xf];
+	crc = (crc >> 4) ^ s_monitor_crc_table[crc & 0xf];
+	return crc;
+}
+
+// Like _readchar, but gives up when the host doesn't strobe within the given number of spins.
+// Returns MONITOR_READ_NONE then, with BUSY low so the host can go on whenever it's ready. When the host
+// doesn't release STROBE after the byte, we can't tell it from the next one: that returns MONITOR_READ_STUCK,
+// with BUSY left high.
+static int16_t MONITOR_ReadByte (uint16_t spins)
+{
+	MONITOR_DIGITAL_OUT = MONITOR_OUT_READY;
+	while (MONITOR_DIGITAL_IN_1 & MONITOR_STROBE_MASK)
+		if (!spins--)
+			return MONITOR_READ_NONE;
+
+	MONITOR_DIGITAL_OUT = MONITOR_OUT_IDLE;
+	uint8_t byte = MONITOR_DIGITAL_IN_2;
+	MONITOR_DIGITAL_OUT = MONITOR_OUT_ACK;
+
+	// The host releases STROBE as soon as it sees BUSY high.
+	spins = MONITOR_RELEASE_SPINS;
+	while (!(MONITOR_DIGITAL_IN_1 & MONITOR_STROBE_MASK))
+	{
+		if (!spins--)
+		{
+			MONITOR_DIGITAL_OUT = MONITOR_OUT_IDLE;
+			return MONITOR_READ_STUCK;
+		}
+	}
+	MONITOR_DIGITAL_OUT = MONITOR_OUT_IDLE;
+	return byte;
+}
+
+// Like SEND_NIBBLE in the bootloader, but gives up when the host doesn't answer in time.
+static bool MONITOR_SendNibble (uint8_t nibble)
+{
+	// Keep the external mute and PtrClk (nACK) high.
+	uint8_t out = (nibble & 0xf) | 0x90;
+
+	uint16_t spins = MONITOR_REPLY_SPINS;
+	while (MONITOR_DIGITAL_IN_1 & MONITOR_HOSTBUSY_MASK)
+		if (!spins--)
+			return false;
+
+	// Give the status lines ~50 microseconds to settle, then pull PtrClk low.
+	MONITOR_DIGITAL_OUT = out;
+	uint16_t settle = 50;
+	__asm__ volatile ("1: dbra %0, 1b" : "+d" (settle));
+	MONITOR_DIGITAL_OUT = out & ~0x10;
+
+	// Release PtrClk once the host has read the nibble, or when it went away.
+	bool bRead = true;
+	spins = MONITOR_REPLY_SPINS;
+	while (bRead && !(MONITOR_DIGITAL_IN_1 & MONITOR_HOSTBUSY_MASK))
+		bRead = spins--;
+
+	MONITOR_DIGITAL_OUT = out;
+	return bRead;
+}
+
+static bool MONITOR_Reply (uint8_t reply)
+{
+	bool bSent = MONITOR_SendNibble (reply) && MONITOR_SendNibble (reply >> 4);
+	MONITOR_DIGITAL_OUT = MONITOR_OUT_IDLE;
+	return bSent;
+}
+
+static bool MONITOR_IsWritable (uint32_t address, uint32_t nBytes)
+{
+	for (uint16_t i=0; i<sizeof(s_monitor_regions)/sizeof(s_monitor_regions[0]); i++)
+		if (address >= s_monitor_regions[i][0] && address + nBytes <= s_monitor_regions[i][1])
+			return true;
+	return false;
+}
+
+static void MONITOR_OnHeader ()
+{
+	const uint8_t* h = s_monitor_header;
+	uint8_t check = 0;
+	for (uint16_t i=0; i<MONITOR_HEADER_SIZE-1; i++)
+		check ^= h[i];
+
+	uint32_t address = ((uint32_t)h[0] << 24) | ((uint32_t)h[1] << 16) | ((uint32_t)h[2] << 8) | h[3];
+	uint32_t nBytes = ((uint32_t)h[4] << 24) | ((uint32_t)h[5] << 16) | ((uint32_t)h[6] << 8) | h[7];
+	if (check != h[8] || !nBytes || nBytes > MONITOR_MAX_PACKET || !MONITOR_IsWritable (address, nBytes))
+	{
+		s_monitor_state = MONITOR_STATE_COMMAND;
+		MONITOR_Reply (MONITOR_REPLY_NAK);
+		return;
+	}
+
+	s_monitor_address = address;
+	s_monitor_length = (uint16_t)nBytes;
+	s_monitor_crc = 0xffffffff;
+	for (uint16_t i=0; i<MONITOR_HEADER_SIZE-1; i++)
+		s_monitor_crc = MONITOR_UpdateCRC (s_monitor_crc, h[i]);
+
+	// If the host missed the ACK, it starts over with a new command.
+	s_monitor_received = 0;
+	s_monitor_state = MONITOR_Reply (MONITOR_REPLY_ACK) ? MONITOR_STATE_DATA : MONITOR_STATE_COMMAND;
+}
+
+static void MONITOR_OnByte (uint8_t byte)
+{
+	switch (s_monitor_state)
+	{
+	case MONITOR_STATE_COMMAND:
+		if (byte == MONITOR_COMMAND)
+		{
+			s_monitor_received = 0;
+			s_monitor_state = MONITOR_STATE_HEADER;
+		}
+		break;
+
+	case MONITOR_STATE_HEADER:
+		s_monitor_header[s_monitor_received++] = byte;
+		if (s_monitor_received == MONITOR_HEADER_SIZE)
+			MONITOR_OnHeader ();
+		break;
+
+	case MONITOR_STATE_DATA:
+		s_monitor_buffer[s_monitor_received++] = byte;
+		s_monitor_crc = MONITOR_UpdateCRC (s_monitor_crc, byte);
+		if (s_monitor_received == s_monitor_length)
+		{
+			s_monitor_crc = ~s_monitor_crc;
+			s_monitor_received = 0;
+			s_monitor_state = MONITOR_STATE_CRC;
+		}
+		break;
+
+	case MONITOR_STATE_CRC:
+		// High byte first.
+		s_monitor_hostCRC = (s_monitor_hostCRC << 8) | byte;
+		if (++s_monitor_received < 4)
+			break;
+
+		// The packet waits for MONITOR_Apply; until then we don't take any bytes.
+		s_monitor_state = MONITOR_STATE_COMMAND;
+		s_monitor_bPending = s_monitor_hostCRC == s_monitor_crc;
+		MONITOR_Reply (s_monitor_bPending ? MONITOR_REPLY_ACK : MONITOR_REPLY_NAK);
+		break;
+	}
+}
+
+void MONITOR_Poll ()
+{
+	if (s_monitor_bPending)
+		return;
+
+	// After a release timeout, BUSY stays high until the host lets go of STROBE.
+	if (s_monitor_bStuck)
+	{
+		if (!(MONITOR_DIGITAL_IN_1 & MONITOR_STROBE_MASK))
+			return;
+		s_monitor_bStuck = false;
+	}
+
+	// Only take the first byte if the host is already strobing; after that, keep going as long as they come.
+	uint16_t budget = s_monitor_bytesPerPoll;
+	int16_t byte = MONITOR_ReadByte (0);
+	while (byte >= 0)
+	{
+		MONITOR_OnByte ((uint8_t)byte);
+		if (s_monitor_bPending || !--budget)
+			break;
+		byte = MONITOR_ReadByte (MONITOR_BYTE_SPINS);
+	}
+
+	// The packet lost a byte or gets one twice, so drop it; the host starts over when it gets no reply.
+	if (byte == MONITOR_READ_STUCK)
+	{
+		s_monitor_bStuck = true;
+		s_monitor_received = 0;
+		s_monitor_state = MONITOR_STATE_COMMAND;
+		return;
+	}
+
+	MONITOR_DIGITAL_OUT = s_monitor_bPending ? MONITOR_OUT_IDLE : MONITOR_OUT_READY;
+}
+
+bool MONITOR_Apply ()
+{
+	if (!s_monitor_bPending)
+		return false;
+
+	// Video ram is 16 bits wide, so copy words where we can.
+	const uint8_t* pSrc = s_monitor_buffer;
+	uint16_t nBytes = s_monitor_length;
+	if (!(s_monitor_address & 1) && !(nBytes & 1))
+	{
+		volatile uint16_t* pDest = (volatile uint16_t*)s_monitor_address;
+		for (uint16_t i=0; i<nBytes; i+=2, pSrc+=2)
+			*pDest++ = (pSrc[0] << 8) | pSrc[1];
+	}
+	else
+	{
+		volatile uint8_t* pDest = (volatile uint8_t*)s_monitor_address;
+		for (uint16_t i=0; i<nBytes; i++)
+			*pDest++ = *pSrc++;
+	}
+
+	s_monitor_nApplied++;
+	s_monitor_bPending = false;
+	MONITOR_DIGITAL_OUT = MONITOR_OUT_READY;
+	return true;
+}
+
+uint16_t MONITOR_GetApplied ()
+{
+	return s_monitor_nApplied;
+}
+
+void MONITOR_Install (uint16_t maxBytesPerPoll)
+{
+	s_monitor_bytesPerPoll = maxBytesPerPoll ? maxBytesPerPoll : 1;
+	s_monitor_state = MONITOR_STATE_COMMAND;
+	s_monitor_bPending = false;
+	s_monitor_bStuck = false;
+	MONITOR_DIGITAL_OUT = MONITOR_OUT_READY;
+	IRQ2_AddHandler (MONITOR_Poll, true);
+}
+
+void MONITOR_Uninstall ()
+{
+	IRQ2_RemoveHandler (MONITOR_Poll);
+	MONITOR_DIGITAL_OUT = MONITOR_OUT_IDLE;
+}
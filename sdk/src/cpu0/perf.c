@@ -0,0 +1,157 @@
+#include "irq.h"
+#include "perf.h"
+
+// Marks: 0 is PERF_BeginFrame, i+1 is PERF_EndSection (i).
+#define PERF_MAX_MARKS     (PERF_MAX_SECTIONS + 1)
+#define PERF_UNKNOWN       0xffff
+
+// The IRQ2 bands, in lines from line 223 (IRQ4): 223..64, 65..128, 129..192, 193..222.
+static const uint16_t s_perf_bandStart[4] = { 0, 104, 168, 232 };
+static const uint16_t s_perf_bandEnd[4] = { 104, 168, 232, PERF_FRAME_LINES };
+
+// Band 1 is what we calibrate on.
+#define PERF_CALIBRATION_LINES 64
+
+static PerfSection s_perf_sections[PERF_MAX_SECTIONS];
+static uint16_t s_perf_marks[PERF_MAX_MARKS];  // Last measured position of each mark.
+static uint8_t s_perf_nSections = 0;
+static uint8_t s_perf_probe = 0;               // The mark measured this frame.
+static uint8_t s_perf_probeInterval = 1;       // Frames from one measured mark to the next.
+static uint8_t s_perf_probeWait = 0;           // Frames left until the next one.
+static bool s_perf_bProbing = false;           // Whether s_perf_probe is measured this frame.
+static uint16_t s_perf_frame = 0;
+static uint16_t s_perf_calibrationLoops = 0;   // Loops in PERF_CALIBRATION_LINES.
+
+// The busy loop: counts until the band or frame changes. Calibration and measurement have to use the same one.
+static uint16_t PERF_Spin (uint8_t band, uint16_t frame)
+{
+	uint16_t loops = 0;
+	while (IRQ2_GetCounter () == band && IRQ4_GetCounter () == frame && loops != 0xffff)
+		loops++;
+	return loops;
+}
+
+static void PERF_Measure (uint8_t mark)
+{
+	// Both counters, without an interrupt in between.
+	uint16_t frame;
+	uint8_t band;
+	do
+	{
+		frame = IRQ4_GetCounter ();
+		band = IRQ2_GetCounter () & 3;
+	} while (frame != IRQ4_GetCounter ());
+
+	uint32_t left = (uint32_t)PERF_Spin (band, frame) * PERF_CALIBRATION_LINES * PERF_SUBLINES / s_perf_calibrationLoops;
+	uint16_t bandStart = s_perf_bandStart[band] * PERF_SUBLINES;
+	uint16_t bandEnd = s_perf_bandEnd[band] * PERF_SUBLINES;
+	uint16_t position = (left < bandEnd - bandStart) ? bandEnd - (uint16_t)left : bandStart;
+	position += (uint16_t)(frame - s_perf_frame) * PERF_FRAME_LINES * PERF_SUBLINES;
+	s_perf_marks[mark] = position;
+
+	if (mark < s_perf_nSections)
+		s_perf_sections[mark].start = position;
+
+	if (!mark || s_perf_marks[mark-1] == PERF_UNKNOWN || s_perf_marks[mark-1] > position)
+		return;
+
+	PerfSection* pSection = &s_perf_sections[mark-1];
+	uint16_t length = position - s_perf_marks[mark-1];
+	pSection->start = s_perf_marks[mark-1];
+	pSection->end = position;
+	if (length < pSection->minLength)
+		pSection->minLength = length;
+	if (length > pSection->maxLength)
+		pSection->maxLength = length;
+	if (pSection->nSamples == 0xffff)
+	{
+		pSection->sumLength >>= 1;
+		pSection->nSamples >>= 1;
+	}
+	pSection->sumLength += length;
+	pSection->nSamples++;
+}
+
+static void PERF_Mark (uint8_t mark)
+{
+	if (s_perf_bProbing && mark == s_perf_probe && s_perf_calibrationLoops)
+		PERF_Measure (mark);
+}
+
+void PERF_Init (const char* const* pNames, uint8_t nSections)
+{
+	s_perf_nSections = (nSections < PERF_MAX_SECTIONS) ? nSections : PERF_MAX_SECTIONS;
+	for (uint8_t i=0; i<s_perf_nSections; i++)
+		s_perf_sections[i].name = pNames[i];
+	PERF_ResetStats ();
+
+	// Band 1 has no IRQ4 work in it. Take the best of a few, in case something else got in.
+	s_perf_calibrationLoops = 0;
+	for (uint8_t i=0; i<4; i++)
+	{
+		while (IRQ2_Wait () != 1)
+			;
+		uint16_t loops = PERF_Spin (1, IRQ4_GetCounter ());
+		if (loops > s_perf_calibrationLoops)
+			s_perf_calibrationLoops = loops;
+	}
+}
+
+void PERF_BeginFrame ()
+{
+	s_perf_frame = IRQ4_GetCounter ();
+	s_perf_bProbing = !s_perf_probeWait;
+	if (!s_perf_bProbing)
+	{
+		s_perf_probeWait--;
+		return;
+	}
+
+	s_perf_probeWait = s_perf_probeInterval - 1;
+	if (++s_perf_probe > s_perf_nSections)
+		s_perf_probe = 0;
+	PERF_Mark (0);
+}
+
+void PERF_EndSection (uint8_t idx)
+{
+	if (idx < s_perf_nSections)
+		PERF_Mark (idx + 1);
+}
+
+void PERF_SetProbeInterval (uint8_t nFrames)
+{
+	s_perf_probeInterval = nFrames ? nFrames : 1;
+	s_perf_probeWait = 0;
+}
+
+void PERF_ResetStats ()
+{
+	for (uint8_t i=0; i<PERF_MAX_MARKS; i++)
+		s_perf_marks[i] = PERF_UNKNOWN;
+
+	for (uint8_t i=0; i<s_perf_nSections; i++)
+	{
+		PerfSection* pSection = &s_perf_sections[i];
+		pSection->start = pSection->end = 0;
+		pSection->minLength = 0xffff;
+		pSection->maxLength = 0;
+		pSection->sumLength = 0;
+		pSection->nSamples = 0;
+	}
+}
+
+uint8_t PERF_GetNumSections ()
+{
+	return s_perf_nSections;
+}
+
+const PerfSection* PERF_GetSection (uint8_t idx)
+{
+	return (idx < s_perf_nSections) ? &s_perf_sections[idx] : 0;
+}
+
+uint16_t PERF_GetAverage (const PerfSection* pSection)
+{
+	return pSection->nSamples ? (uint16_t)(pSection->sumLength / pSection->nSamples) : 0;
+}
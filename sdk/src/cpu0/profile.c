@@ -0,0 +1,100 @@
+#include "log.h"
+#include "profile.h"
+
+// From the linker script, and irq.s.
+extern const char _stext[];
+extern const char _etext[];
+extern ProfileHistogram* volatile _profile_histogram;
+
+void PROFILE_Start (ProfileHistogram* pHistogram, uint16_t nBuckets)
+{
+	_profile_histogram = 0;
+	if (!nBuckets)
+		return;
+
+	// Instructions start at even addresses, so a bucket is at least two bytes.
+	uint32_t base = (uint32_t)_stext;
+	uint32_t nBytes = (uint32_t)_etext - base;
+	uint8_t shift = 1;
+	while (shift < 16 && ((uint32_t)nBuckets << shift) < nBytes)
+		shift++;
+
+	pHistogram->base = base;
+	pHistogram->nBuckets = nBuckets;
+	pHistogram->shift = shift;
+	pHistogram->cpu = 0;
+	pHistogram->nOutside = 0;
+	pHistogram->sendCursor = 0;
+	for (uint16_t i=0; i<nBuckets; i++)
+		pHistogram->buckets[i] = 0;
+
+	// The handlers only look at the pointer, which is written in one go.
+	_profile_histogram = pHistogram;
+}
+
+void PROFILE_Stop ()
+{
+	_profile_histogram = 0;
+}
+
+// A single instruction, so the handlers can't count a sample in between the read and the write.
+static void PROFILE_Take (volatile uint16_t* pCount, uint16_t count)
+{
+	__asm__ volatile ("sub.w %1, %0" : "+m" (*pCount) : "d" (count));
+}
+
+uint8_t PROFILE_Send (volatile ProfileHistogram* pHistogram, uint8_t maxRecords)
+{
+	uint8_t record[PROFILE_RECORD_HEADER + PROFILE_MAX_PAIRS * 4];
+	uint32_t base = pHistogram->base;
+	record[0] = pHistogram->cpu;
+	record[1] = pHistogram->shift;
+	record[2] = base >> 24;
+	record[3] = base >> 16;
+	record[4] = base >> 8;
+	record[5] = base;
+
+	// At most one pass over the buckets, going on where the last call stopped. The cursor goes one past
+	// the last bucket, for nOutside.
+	uint16_t nBuckets = pHistogram->nBuckets;
+	uint16_t cursor = pHistogram->sendCursor;
+	uint8_t nRecords = 0;
+	for (uint16_t nVisited=0; nVisited<=nBuckets && nRecords<maxRecords; )
+	{
+		uint8_t nPairs = 0;
+		uint8_t* pPair = record + PROFILE_RECORD_HEADER;
+		for (; nVisited<=nBuckets && nPairs<PROFILE_MAX_PAIRS; nVisited++)
+		{
+			uint16_t bucket = cursor < nBuckets ? cursor : PROFILE_BUCKET_OUTSIDE;
+			uint16_t count = cursor < nBuckets ? pHistogram->buckets[cursor] : pHistogram->nOutside;
+			cursor = cursor < nBuckets ? cursor + 1 : 0;
+			if (!count)
+				continue;
+
+			*pPair++ = bucket >> 8;
+			*pPair++ = bucket;
+			*pPair++ = count >> 8;
+			*pPair++ = count;
+			nPairs++;
+		}
+
+		// Leave the rest for the next call rather than having records dropped.
+		uint8_t nBytes = PROFILE_RECORD_HEADER + nPairs * 4;
+		if (!nPairs || LOG_BUFFER_SIZE - 1 - LOG_GetPending () < LOG_HEADER_SIZE + nBytes || !LOG_Write (LOG_CHANNEL_PROFILE, record, nBytes))
+			break;
+
+		// Whatever was counted since we read the buckets stays for the next call.
+		pPair = record + PROFILE_RECORD_HEADER;
+		for (uint8_t i=0; i<nPairs; i++, pPair+=4)
+		{
+			uint16_t bucket = (pPair[0] << 8) | pPair[1];
+			uint16_t count = (pPair[2] << 8) | pPair[3];
+			PROFILE_Take (bucket == PROFILE_BUCKET_OUTSIDE ? &pHistogram->nOutside : &pHistogram->buckets[bucket], count);
+		}
+
+		pHistogram->sendCursor = cursor;
+		nRecords++;
+	}
+
+	return nRecords;
+}
@@ -0,0 +1,159 @@
+#include <stdbool.h>
+#include "sprite.h"
+
+#define SPRITE_SHADOW_WORDS   (SPRITE_LIMIT / 32)
+#define SPRITE_HIDDEN_WORD    0x4000  // Word 0 of a freed entry: Hidden, not EndOfList.
+#define SPRITE_END_WORD       0xffff
+
+static SpriteData s_sprite_shadow[SPRITE_LIMIT];
+static uint32_t s_sprite_used[SPRITE_SHADOW_WORDS];
+static uint32_t s_sprite_dirty[2][SPRITE_SHADOW_WORDS];    // One set per half of sprite RAM.
+static uint8_t s_sprite_terminator[2];                     // Where each half has its terminator, or SPRITE_SHADOW_NONE.
+static uint8_t s_sprite_back = 0;                          // The half the CPU writes to.
+static uint8_t s_sprite_end = 0;
+
+static inline bool SPRITE_TestBit (const uint32_t* pBits, uint8_t idx)
+{
+	return (pBits[idx >> 5] & (1UL << (idx & 31))) != 0;
+}
+
+static inline void SPRITE_SetBit (uint32_t* pBits, uint8_t idx)
+{
+	pBits[idx >> 5] |= 1UL << (idx & 31);
+}
+
+static inline void SPRITE_ClearBit (uint32_t* pBits, uint8_t idx)
+{
+	pBits[idx >> 5] &= ~(1UL << (idx & 31));
+}
+
+// Copies count entries with movem.l: three entries (48 bytes) a burst through 12 registers, then one at a time.
+static void SPRITE_CopyEntries (SpriteData* pDest, const SpriteData* pSrc, uint8_t count)
+{
+	for (; count >= 3; count -= 3)
+	{
+		__asm__ volatile (
+			"movem.l (%0)+, %%d0-%%d7/%%a2-%%a5\n\t"
+			"movem.l %%d0-%%d7/%%a2-%%a5, (%1)\n\t"
+			"lea (48,%1), %1"
+			: "+a" (pSrc), "+a" (pDest)
+			:
+			: "d0", "d1", "d2", "d3", "d4", "d5", "d6", "d7", "a2", "a3", "a4", "a5", "memory");
+	}
+
+	for (; count; count--)
+	{
+		__asm__ volatile (
+			"movem.l (%0)+, %%d0-%%d3\n\t"
+			"movem.l %%d0-%%d3, (%1)\n\t"
+			"lea (16,%1), %1"
+			: "+a" (pSrc), "+a" (pDest)
+			:
+			: "d0", "d1", "d2", "d3", "memory");
+	}
+}
+
+void SPRITE_ShadowInit ()
+{
+	for (uint8_t i=0; i<SPRITE_LIMIT; i++)
+		*((uint16_t*)&s_sprite_shadow[i]) = SPRITE_HIDDEN_WORD;
+
+	for (uint8_t i=0; i<SPRITE_SHADOW_WORDS; i++)
+	{
+		s_sprite_used[i] = 0;
+		s_sprite_dirty[0][i] = s_sprite_dirty[1][i] = 0xffffffff;
+	}
+
+	s_sprite_terminator[0] = s_sprite_terminator[1] = SPRITE_SHADOW_NONE;
+	s_sprite_end = 0;
+}
+
+uint8_t SPRITE_ShadowAlloc ()
+{
+	for (uint8_t word=0; word<SPRITE_SHADOW_WORDS; word++)
+	{
+		if (s_sprite_used[word] == 0xffffffff)
+			continue;
+
+		uint8_t idx = word << 5;
+		while (SPRITE_TestBit (s_sprite_used, idx))
+			idx++;
+
+		SPRITE_SetBit (s_sprite_used, idx);
+		if (idx >= s_sprite_end)
+			s_sprite_end = idx + 1;
+		return idx;
+	}
+	return SPRITE_SHADOW_NONE;
+}
+
+void SPRITE_ShadowFree (uint8_t idx)
+{
+	if (idx >= SPRITE_LIMIT || !SPRITE_TestBit (s_sprite_used, idx))
+		return;
+
+	*((uint16_t*)SPRITE_ShadowEdit (idx)) = SPRITE_HIDDEN_WORD;
+	SPRITE_ClearBit (s_sprite_used, idx);
+
+	// Pull the terminator back over the free entries at the top.
+	if (idx + 1 == s_sprite_end)
+	{
+		while (s_sprite_end && !SPRITE_TestBit (s_sprite_used, s_sprite_end - 1))
+			s_sprite_end--;
+	}
+}
+
+SpriteData* SPRITE_ShadowEdit (uint8_t idx)
+{
+	SPRITE_SetBit (s_sprite_dirty[0], idx);
+	SPRITE_SetBit (s_sprite_dirty[1], idx);
+	return &s_sprite_shadow[idx];
+}
+
+void SPRITE_ShadowCommit ()
+{
+	uint32_t* pDirty = s_sprite_dirty[s_sprite_back];
+	const uint8_t end = s_sprite_end;
+
+	// The old terminator was written over an entry that may be in the list now.
+	const uint8_t terminator = s_sprite_terminator[s_sprite_back];
+	if (terminator != end && terminator < SPRITE_LIMIT)
+		SPRITE_SetBit (pDirty, terminator);
+
+	// Runs of dirty entries up to the terminator. Dirty ones past it stay dirty until the list grows over them.
+	uint8_t idx = 0;
+	while (idx < end)
+	{
+		if (!pDirty[idx >> 5])
+		{
+			idx = (idx | 31) + 1;
+			continue;
+		}
+		if (!SPRITE_TestBit (pDirty, idx))
+		{
+			idx++;
+			continue;
+		}
+
+		const uint8_t first = idx;
+		do
+		{
+			SPRITE_ClearBit (pDirty, idx);
+			idx++;
+		} while (idx < end && SPRITE_TestBit (pDirty, idx));
+		SPRITE_CopyEntries (&SpriteList[first], &s_sprite_shadow[first], idx - first);
+	}
+
+	// A full list fills the buffer half, and has no room for one.
+	if (terminator != end && end < SPRITE_LIMIT)
+		*((volatile uint16_t*)&SpriteList[end]) = SPRITE_END_WORD;
+	s_sprite_terminator[s_sprite_back] = end;
+
+	s_sprite_back ^= 1;
+	SPRITE_SwapBuffers ();
+}
+
+uint8_t SPRITE_ShadowGetCount ()
+{
+	return s_sprite_end;
+}
@@ -1,5 +1,35 @@
+#include "irq.h"
 #include "tile.h"
 
+#define TILE_PAGE_TILES (TILE_PAGE_WIDTH * TILE_PAGE_HEIGHT)
+
+// A queued write. The queue moves pDest and pSrc along as it goes, so a write can be spread over frames.
+typedef struct
+{
+	volatile uint16_t* pDest;
+	const uint16_t* pSrc;     // 0 for a fill.
+	uint16_t count;           // Tiles still to write.
+	int16_t stride;           // In tiles: 1 for rows, +-TILE_PAGE_WIDTH for columns.
+	uint16_t tileIdx;         // For a fill.
+} TileQueueWrite;
+
+// From irq.s: called by the IRQ4 handler during vblank when set.
+extern void (* volatile _tile_queue_flush) (void);
+
+// Pushed by the program, written by the IRQ4 handler. Only the pusher moves the tail, and only the
+// handler the head, so neither has to disable interrupts.
+static TileQueueWrite s_tile_queue[TILE_QUEUE_SIZE];
+static volatile uint8_t s_tile_queueHead = 0;
+static volatile uint8_t s_tile_queueTail = 0;
+static uint16_t s_tile_queueBudget = 0;
+
+// Same for the counters; pending is pushed - written.
+static uint32_t s_tile_pushedWords = 0;
+static uint32_t s_tile_maxPendingWords = 0;
+static uint16_t s_tile_nRefused = 0;
+static volatile uint32_t s_tile_writtenWords = 0;
+static volatile uint16_t s_tile_nBusyFrames = 0;
+
 // Fills one of the 16 4kb tile pages.
 void TILE_FillPage (uint8_t pageIdx, uint16_t tileIdx)
 {
@@ -19,3 +49,142 @@ void TILE_Reset ()
 	// Fill one page with empty tiles. Take page 0 to match our completely clear registers.
 	TILE_FillPage (0, 0x20);
 }
+
+// Runs from the IRQ4 handler.
+static void TILE_QueueFlush ()
+{
+	uint16_t budget = s_tile_queueBudget;
+	uint8_t head = s_tile_queueHead;
+	while (head != s_tile_queueTail)
+	{
+		if (budget < TILE_QUEUE_CYCLES_PER_WRITE + TILE_QUEUE_CYCLES_PER_WORD)
+		{
+			s_tile_nBusyFrames++;
+			break;
+		}
+
+		TileQueueWrite* pWrite = &s_tile_queue[head];
+		uint16_t count = (budget - TILE_QUEUE_CYCLES_PER_WRITE) / TILE_QUEUE_CYCLES_PER_WORD;
+		if (count > pWrite->count)
+			count = pWrite->count;
+		budget -= TILE_QUEUE_CYCLES_PER_WRITE + count * TILE_QUEUE_CYCLES_PER_WORD;
+
+		volatile uint16_t* pDest = pWrite->pDest;
+		const int16_t stride = pWrite->stride;
+		if (!pWrite->pSrc)
+		{
+			const uint16_t tileIdx = pWrite->tileIdx;
+			for (uint16_t i=0; i<count; i++, pDest+=stride)
+				*pDest = tileIdx;
+		}
+		else
+		{
+			const uint16_t* pSrc = pWrite->pSrc;
+			for (uint16_t i=0; i<count; i++, pDest+=stride)
+				*pDest = *pSrc++;
+			pWrite->pSrc = pSrc;
+		}
+
+		pWrite->pDest = pDest;
+		pWrite->count -= count;
+		s_tile_writtenWords += count;
+		if (!pWrite->count)
+			head = (head + 1) % TILE_QUEUE_SIZE;
+	}
+
+	s_tile_queueHead = head;
+}
+
+static bool TILE_QueuePush (uint8_t pageIdx, uint16_t offset, const uint16_t* pSrc, uint16_t count, int16_t stride, uint16_t tileIdx)
+{
+	if (!count)
+		return true;
+
+	uint8_t tail = s_tile_queueTail;
+	uint8_t next = (tail + 1) % TILE_QUEUE_SIZE;
+	if (next == s_tile_queueHead)
+	{
+		s_tile_nRefused++;
+		return false;
+	}
+
+	TileQueueWrite* pWrite = &s_tile_queue[tail];
+	pWrite->pDest = TILE_GetPagePtr (pageIdx) + offset;
+	pWrite->pSrc = pSrc;
+	pWrite->count = count;
+	pWrite->stride = stride;
+	pWrite->tileIdx = tileIdx;
+
+	// The handler only looks at the write once the tail has moved past it.
+	s_tile_queueTail = next;
+
+	s_tile_pushedWords += count;
+	uint32_t pending = s_tile_pushedWords - s_tile_writtenWords;
+	if (pending > s_tile_maxPendingWords)
+		s_tile_maxPendingWords = pending;
+	return true;
+}
+
+// Refuses writes that would leave the page.
+static bool TILE_QueueFits (uint8_t x, uint8_t y, uint16_t count, uint16_t maxCount)
+{
+	bool bFits = x < TILE_PAGE_WIDTH && y < TILE_PAGE_HEIGHT && count <= maxCount;
+	s_tile_nRefused += !bFits;
+	return bFits;
+}
+
+void TILE_QueueInstall (uint16_t cyclesPerFrame)
+{
+	s_tile_queueBudget = cyclesPerFrame ? cyclesPerFrame : TILE_QUEUE_DEFAULT_BUDGET;
+	_tile_queue_flush = TILE_QueueFlush;
+}
+
+void TILE_QueueUninstall ()
+{
+	_tile_queue_flush = 0;
+}
+
+bool TILE_QueueFill (uint8_t pageIdx, uint8_t x, uint8_t y, uint16_t count, uint16_t tileIdx)
+{
+	uint16_t offset = y * TILE_PAGE_WIDTH + x;
+	return TILE_QueueFits (x, y, count, TILE_PAGE_TILES - offset) && TILE_QueuePush (pageIdx, offset, 0, count, 1, tileIdx);
+}
+
+bool TILE_QueueCopy (uint8_t pageIdx, uint8_t x, uint8_t y, const uint16_t* pSrc, uint16_t count)
+{
+	uint16_t offset = y * TILE_PAGE_WIDTH + x;
+	return TILE_QueueFits (x, y, count, TILE_PAGE_TILES - offset) && TILE_QueuePush (pageIdx, offset, pSrc, count, 1, 0);
+}
+
+bool TILE_QueueRow (uint8_t pageIdx, uint8_t x, uint8_t y, const uint16_t* pSrc, uint8_t count)
+{
+	return TILE_QueueFits (x, y, count, TILE_PAGE_WIDTH - x) && TILE_QueuePush (pageIdx, y * TILE_PAGE_WIDTH + x, pSrc, count, 1, 0);
+}
+
+bool TILE_QueueColumn (uint8_t pageIdx, uint8_t x, uint8_t y, const uint16_t* pSrc, uint8_t count, bool bUp)
+{
+	return TILE_QueueFits (x, y, count, bUp ? y + 1 : TILE_PAGE_HEIGHT - y) &&
+		TILE_QueuePush (pageIdx, y * TILE_PAGE_WIDTH + x, pSrc, count, bUp ? -TILE_PAGE_WIDTH : TILE_PAGE_WIDTH, 0);
+}
+
+uint16_t TILE_QueueGetFree ()
+{
+	return (s_tile_queueHead + TILE_QUEUE_SIZE - s_tile_queueTail - 1) % TILE_QUEUE_SIZE;
+}
+
+void TILE_QueueSync ()
+{
+	while (_tile_queue_flush && s_tile_queueHead != s_tile_queueTail)
+		IRQ4_Wait ();
+}
+
+void TILE_QueueGetStats (TileQueueStats* pStats)
+{
+	uint32_t written = s_tile_writtenWords;
+	pStats->nPending = (s_tile_queueTail + TILE_QUEUE_SIZE - s_tile_queueHead) % TILE_QUEUE_SIZE;
+	pStats->nPendingWords = s_tile_pushedWords - written;
+	pStats->maxPendingWords = s_tile_maxPendingWords;
+	pStats->nWordsWritten = written;
+	pStats->nBusyFrames = s_tile_nBusyFrames;
+	pStats->nRefused = s_tile_nRefused;
+}
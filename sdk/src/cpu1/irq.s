@@ -6,6 +6,8 @@
 	- IRQ waiting:        Wait for a flag to be reset upon interrupt from user code.
 	- User Handler:       User function (C) to be invoked upon interrupt. Optional.
 	- Clock:              Frame counter. Runs for about 1092 seconds, then wraps. Can be used as 60Hz clock.
+	- Scanline wait:      The interrupt line stays up for a whole scanline. The handler does its work in that
+	                      time and only waits out what is left of it, by returning through a resume stub.
 */
 
 /* Note: we need to force this object file into linking, unfortunately, by referencing it from startup.s */
@@ -18,6 +20,7 @@
 .global IRQ4_GetCounter
 .global IRQ4_Wait
 .global IRQ4_SetHandler
+.global _profile_histogram
 
 .bss
 
@@ -30,6 +33,16 @@ _irq4_wait_ack:
 _irq4_counter:
 .word 0
 
+/* Histogram of the PC sampling profiler, set by PROFILE_Start. */
+.align 4
+_profile_histogram:
+.int 0
+
+/* Where the interrupted code goes on, see _irq4_resume */
+.align 4
+_irq4_return_pc:
+.int 0
+
 /* User defined IRQ function */
 .align 4
 _irq4_userhandler:
@@ -39,35 +52,75 @@ _irq4_userhandler:
 
 __irq_4_handler:
 
+	/* Back while the line is still up. The line stays up for the rest of the scanline (654.8 cycles @ 10Mhz),
+	   so instead of waiting that out first, the handler does its work and returns through _irq4_resume.
+	   If the line is still up, the interrupt comes back right away with that as the PC, and we just return
+	   to it again; that's the wait, and it only takes what the work didn't. */
+	cmpi.l   #_irq4_resume, (2, %A7)
+	beq      _irq4_retrigger
+
+	/* Profiler; has to come before anything goes on the stack */
+	tst.l    _profile_histogram
+	beq      _irq4_sampled
+	bsr      _profile_sample
+_irq4_sampled:
+
 	/* Update counters */
 	addw #1, _irq4_counter
 
 	/* Reset wait */
 	clr.b    _irq4_wait_ack
-	
-	/* Wait out the rest of the scanline so the interrupt doesn't trigger twice.
-	   we have 262 scanlines @ 60fps = 15720 scanlines per second. So one scanline is 654,8 cycles @ 10Mhz.
-	   Since dbra takes at least 10 cycles, we can loop 66x to waste at least 660 cycles */
-	move.l   %D0, -(%A7)
-	clr.l    %D0
-	move.b   #66, %D0
-_irq4_wait:
-	dbra     %D0, _irq4_wait
-	/* We are now at scanline 224 (invisible) */
-	move.l   (%A7)+, %D0
-
-	/* Check for user function */
-	
-	/* Store registers on the stack */
-	/*movem.l %D0-%D7/%A0-%A6, -(%A7) */
 
-	/* Run user handlers */
-	/* ... */
+	/* User function, in the time we'd otherwise wait */
+	tst.l    _irq4_userhandler
+	beq      _irq4_done
+	movem.l  %D0-%D7/%A0-%A6, -(%A7)
+	move.l   _irq4_userhandler, %A0
+	jsr      (%A0)
+	movem.l  (%A7)+, %D0-%D7/%A0-%A6
+
+_irq4_done:
+	move.l   (2, %A7), _irq4_return_pc
+	move.l   #_irq4_resume, (2, %A7)
+_irq4_retrigger:
+	rte
 
-	/* Restore registers from the stack */
-	/* movem.l (%A7)+, %D0-%D7/%A0-%A6 */
+/* Goes on where the interrupt came in, without touching any registers or flags: subq to an address register
+   and movem leave the condition codes alone. */
+_irq4_resume:
+	subq.l   #4, %A7               /* Room for the return address */
+	movem.l  %A0, -(%A7)
+	movem.l  _irq4_return_pc, %A0
+	movem.l  %A0, (4, %A7)
+	movem.l  (%A7)+, %A0
+	rts
 
-	rte
+/* Adds the interrupted PC to the histogram at _profile_histogram (ProfileHistogram in profile.h).
+   Called first thing in a handler, so our return address is followed by the SR and PC of the exception frame. */
+_profile_sample:
+	movem.l  %D0-%D1/%A0, -(%A7)
+	movea.l  _profile_histogram, %A0
+	move.l   (18, %A7), %D0        /* 12 bytes of registers, the return address and the SR */
+	sub.l    (%A0), %D0            /* base */
+	bcs      _profile_sample_outside
+	move.b   (6, %A0), %D1         /* shift */
+	lsr.l    %D1, %D0
+	moveq    #0, %D1
+	move.w   (4, %A0), %D1         /* nBuckets */
+	cmp.l    %D1, %D0
+	bcc      _profile_sample_outside
+	add.l    %D0, %D0
+	addq.w   #1, (12, %A0, %D0.l)  /* buckets */
+	bcc      _profile_sample_done
+	subq.w   #1, (12, %A0, %D0.l)  /* Saturate */
+	bra      _profile_sample_done
+_profile_sample_outside:
+	addq.w   #1, (8, %A0)          /* nOutside */
+	bcc      _profile_sample_done
+	subq.w   #1, (8, %A0)
+_profile_sample_done:
+	movem.l  (%A7)+, %D0-%D1/%A0
+	rts
 
 __dummy_irq_handler:
 	rte
@@ -0,0 +1,37 @@
+#include "profile.h"
+
+// From the linker script, and irq.s.
+extern const char _stext[];
+extern const char _etext[];
+extern ProfileHistogram* volatile _profile_histogram;
+
+void PROFILE_Start (ProfileHistogram* pHistogram, uint16_t nBuckets)
+{
+	_profile_histogram = 0;
+	if (!nBuckets)
+		return;
+
+	// Instructions start at even addresses, so a bucket is at least two bytes.
+	uint32_t base = (uint32_t)_stext;
+	uint32_t nBytes = (uint32_t)_etext - base;
+	uint8_t shift = 1;
+	while (shift < 16 && ((uint32_t)nBuckets << shift) < nBytes)
+		shift++;
+
+	pHistogram->base = base;
+	pHistogram->nBuckets = nBuckets;
+	pHistogram->shift = shift;
+	pHistogram->cpu = 1;
+	pHistogram->nOutside = 0;
+	pHistogram->sendCursor = 0;
+	for (uint16_t i=0; i<nBuckets; i++)
+		pHistogram->buckets[i] = 0;
+
+	// The handler only looks at the pointer, which is written in one go.
+	_profile_histogram = pHistogram;
+}
+
+void PROFILE_Stop ()
+{
+	_profile_histogram = 0;
+}
@@ -0,0 +1,24 @@
+#!/bin/bash
+# Builds splitbin natively on Linux. Use splitbin.sln on Windows.
+
+CXX=${CXX:-g++}
+OUTPUT_PATH=output
+
+mkdir -p ${OUTPUT_PATH}
+
+if [ "$1" == "clean" ]; then
+  rm -vf ${OUTPUT_PATH}/*.o ${OUTPUT_PATH}/splitbin
+  exit 0
+fi
+
+echo "Compiling..."
+for filename in splitbin.cpp ../orboot/crc32.cpp ../orboot/platform.cpp; do
+  oname="${OUTPUT_PATH}/$(basename "${filename%.*}").o"
+  echo "Compiling $filename to $oname"
+  ${CXX} -c $filename -O2 -Wall -I../orboot -o $oname || exit 1
+done
+
+echo "Linking..."
+${CXX} ${OUTPUT_PATH}/*.o -o ${OUTPUT_PATH}/splitbin -lpthread || exit 1
+
+ls -sh ${OUTPUT_PATH}/splitbin
@@ -1,139 +1,625 @@
 #include <Platform.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "crc32.h"
 
-int main (int argc, char **argv)
+// SSE2 is there on every x64 CPU; anything else gets the plain loop.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPLITBIN_SSE2
+#include <emmintrin.h>
+#endif
+
+// One image, and the ROMs it is split into (or merged from).
+struct SplitJob
 {
-	if (argc < 5)
+	const char* imageFile;
+	uint32 romSize;
+	uint32 interleave;
+	std::vector<const char*> romNames;
+
+	SplitJob () : imageFile (NULL), romSize (0), interleave (0) {}
+};
+
+// Byte i of the data goes to lane i % interleave, at i / interleave. The lanes have to hold
+// nBytes / interleave bytes (rounded up).
+static void DeinterleaveScalar (const uint8* pData, uint32 nBytes, uint32 interleave, uint8* const* ppLanes, uint32 start)
+{
+	for (uint32 i=start; i<nBytes; i++)
+		ppLanes[i % interleave][i / interleave] = pData[i];
+}
+
+#ifdef SPLITBIN_SSE2
+
+// Two lanes, 32 bytes at a time: the even bytes are the low halves of the words, the odd ones the high halves.
+static uint32 Deinterleave2 (const uint8* pData, uint32 nBytes, uint8* const* ppLanes)
+{
+	const __m128i lowBytes = _mm_set1_epi16 (0x00ff);
+	uint32 i = 0;
+	for (; i+32<=nBytes; i+=32)
 	{
-		printf ("SplitBin - Splits a binary image in to separate (interleaved) (EP)ROM images.\n");
-		printf ("Usage: splitbin.exe <inputfile> <rom size> <interleave> <name1> [<name2> ...]\n");
-		printf ("Example: splitbin.exe maincpu.bin 65536 2 epr-10380b.133 epr-10382b.118\n");
-		printf ("Note: The file names should be supplied in interleaved order.\n");
-		return 0;
+		__m128i a = _mm_loadu_si128 ((const __m128i*)(pData + i));
+		__m128i b = _mm_loadu_si128 ((const __m128i*)(pData + i + 16));
+		__m128i even = _mm_packus_epi16 (_mm_and_si128 (a, lowBytes), _mm_and_si128 (b, lowBytes));
+		__m128i odd = _mm_packus_epi16 (_mm_srli_epi16 (a, 8), _mm_srli_epi16 (b, 8));
+		_mm_storeu_si128 ((__m128i*)(ppLanes[0] + i/2), even);
+		_mm_storeu_si128 ((__m128i*)(ppLanes[1] + i/2), odd);
 	}
+	return i;
+}
 
-	const char* inputFile = NULL; 
-	uint64 romSize = 0, interleave = 0;
-	List<const char*> romNames;
-	int argIdx = 1;
-	while (argIdx < argc)
+// Four lanes, 64 bytes at a time: shift each lane down to the low byte of the longs, then pack twice.
+static uint32 Deinterleave4 (const uint8* pData, uint32 nBytes, uint8* const* ppLanes)
+{
+	const __m128i lowByte = _mm_set1_epi32 (0xff);
+	uint32 i = 0;
+	for (; i+64<=nBytes; i+=64)
 	{
-		const char* arg = argv[argIdx];
-		if (arg[0] == '-')
+		__m128i v[4];
+		for (uint32 j=0; j<4; j++)
+			v[j] = _mm_loadu_si128 ((const __m128i*)(pData + i + j*16));
+
+		for (uint32 lane=0; lane<4; lane++)
 		{
-			// Handle options here.
-			printf ("Invalid option: '%s'.\n", arg);
-			return 1;
+			__m128i shift = _mm_cvtsi32_si128 (lane * 8);
+			__m128i w0 = _mm_packs_epi32 (_mm_and_si128 (_mm_srl_epi32 (v[0], shift), lowByte), _mm_and_si128 (_mm_srl_epi32 (v[1], shift), lowByte));
+			__m128i w1 = _mm_packs_epi32 (_mm_and_si128 (_mm_srl_epi32 (v[2], shift), lowByte), _mm_and_si128 (_mm_srl_epi32 (v[3], shift), lowByte));
+			_mm_storeu_si128 ((__m128i*)(ppLanes[lane] + i/4), _mm_packus_epi16 (w0, w1));
 		}
-		else if (!inputFile)
+	}
+	return i;
+}
+
+// The reverse of Deinterleave2: interleaves 16 bytes of each lane at a time.
+static uint32 Interleave2 (uint8* const* ppLanes, uint32 nBytes, uint8* pData)
+{
+	uint32 i = 0;
+	for (; i+32<=nBytes; i+=32)
+	{
+		__m128i a = _mm_loadu_si128 ((const __m128i*)(ppLanes[0] + i/2));
+		__m128i b = _mm_loadu_si128 ((const __m128i*)(ppLanes[1] + i/2));
+		_mm_storeu_si128 ((__m128i*)(pData + i), _mm_unpacklo_epi8 (a, b));
+		_mm_storeu_si128 ((__m128i*)(pData + i + 16), _mm_unpackhi_epi8 (a, b));
+	}
+	return i;
+}
+
+// The reverse of Deinterleave4: byte pairs from lanes 0/1 and 2/3, then pairs of those.
+static uint32 Interleave4 (uint8* const* ppLanes, uint32 nBytes, uint8* pData)
+{
+	uint32 i = 0;
+	for (; i+64<=nBytes; i+=64)
+	{
+		__m128i a = _mm_loadu_si128 ((const __m128i*)(ppLanes[0] + i/4));
+		__m128i b = _mm_loadu_si128 ((const __m128i*)(ppLanes[1] + i/4));
+		__m128i c = _mm_loadu_si128 ((const __m128i*)(ppLanes[2] + i/4));
+		__m128i d = _mm_loadu_si128 ((const __m128i*)(ppLanes[3] + i/4));
+		__m128i abLow = _mm_unpacklo_epi8 (a, b), abHigh = _mm_unpackhi_epi8 (a, b);
+		__m128i cdLow = _mm_unpacklo_epi8 (c, d), cdHigh = _mm_unpackhi_epi8 (c, d);
+		_mm_storeu_si128 ((__m128i*)(pData + i), _mm_unpacklo_epi16 (abLow, cdLow));
+		_mm_storeu_si128 ((__m128i*)(pData + i + 16), _mm_unpackhi_epi16 (abLow, cdLow));
+		_mm_storeu_si128 ((__m128i*)(pData + i + 32), _mm_unpacklo_epi16 (abHigh, cdHigh));
+		_mm_storeu_si128 ((__m128i*)(pData + i + 48), _mm_unpackhi_epi16 (abHigh, cdHigh));
+	}
+	return i;
+}
+
+#endif // SPLITBIN_SSE2
+
+// Splits the data over the lanes in one pass. 2 and 4 way interleaves, the ones the boards use, are vectorized.
+static void Deinterleave (const uint8* pData, uint32 nBytes, uint32 interleave, uint8* const* ppLanes)
+{
+	uint32 done = 0;
+#ifdef SPLITBIN_SSE2
+	if (interleave == 2)
+		done = Deinterleave2 (pData, nBytes, ppLanes);
+	else if (interleave == 4)
+		done = Deinterleave4 (pData, nBytes, ppLanes);
+#endif
+	DeinterleaveScalar (pData, nBytes, interleave, ppLanes, done);
+}
+
+// The reverse of Deinterleave: nBytes of data are gathered from the lanes.
+static void Interleave (uint8* const* ppLanes, uint32 nBytes, uint32 interleave, uint8* pData)
+{
+	uint32 i = 0;
+#ifdef SPLITBIN_SSE2
+	if (interleave == 2)
+		i = Interleave2 (ppLanes, nBytes, pData);
+	else if (interleave == 4)
+		i = Interleave4 (ppLanes, nBytes, pData);
+#endif
+	for (; i<nBytes; i++)
+		pData[i] = ppLanes[i % interleave][i / interleave];
+}
+
+// A file to checksum. Without pData, the thread maps fileName itself.
+struct CrcItem
+{
+	const char* fileName;
+	const uint8* pData;
+	uint32 nBytes;
+	uint32 crc;
+	bool bRead;
+};
+
+struct CrcThreadParams
+{
+	std::vector<CrcItem>* pItems;
+	uint32 first;
+	uint32 step;
+};
+
+static void CrcThread (void* pParam)
+{
+	const CrcThreadParams& params = *(const CrcThreadParams*)pParam;
+	std::vector<CrcItem>& items = *params.pItems;
+	for (size_t i=params.first; i<items.size(); i+=params.step)
+	{
+		CrcItem& item = items[i];
+		if (item.pData)
 		{
-			inputFile = arg;
+			item.crc = CRC32_Calc (item.pData, item.nBytes);
+			item.bRead = true;
+			continue;
 		}
-		else if (!romSize)
+
+		const uint8* pData = PLATFORM_MapFile (item.fileName, item.nBytes);
+		item.bRead = pData != NULL;
+		if (!item.bRead)
+			continue;
+
+		item.crc = CRC32_Calc (pData, item.nBytes);
+		PLATFORM_UnmapFile (pData, item.nBytes);
+	}
+}
+
+// Checksums the items spread over all CPUs. A set of EPROMs is a handful of files of the same size,
+// so every thread simply takes every n-th one.
+static void CalcCRCs (std::vector<CrcItem>& items)
+{
+	uint32 nThreads = PLATFORM_GetNumCPUs ();
+	if (nThreads > items.size())
+		nThreads = (uint32)items.size();
+	if (nThreads <= 1)
+	{
+		CrcThreadParams params = { &items, 0, 1 };
+		CrcThread (&params);
+		return;
+	}
+
+	std::vector<CrcThreadParams> params (nThreads);
+	std::vector<PlatformThread*> threads (nThreads);
+	for (uint32 t=0; t<nThreads; t++)
+	{
+		params[t].pItems = &items;
+		params[t].first = t;
+		params[t].step = nThreads;
+		threads[t] = PLATFORM_StartThread (CrcThread, &params[t]);
+	}
+	for (uint32 t=0; t<nThreads; t++)
+		PLATFORM_JoinThread (threads[t]);
+}
+
+// ROM names as in the romInfo table of the memtest sample: "epr-10380b.133" is "EPR-10380b" in IC 133.
+// Files without a numbered extension keep their name, and get IC 0.
+static void GetRomName (const char* fileName, std::string& name, uint32& ic)
+{
+	const char* pBase = fileName + strlen (fileName);
+	while (pBase > fileName && pBase[-1] != '/' && pBase[-1] != '\\')
+		pBase--;
+
+	name = pBase;
+	ic = 0;
+	size_t dot = name.find_last_of ('.');
+	if (dot != std::string::npos && dot + 1 < name.size() && strspn (name.c_str() + dot + 1, "0123456789") == name.size() - dot - 1)
+	{
+		ic = (uint32)strtoul (name.c_str() + dot + 1, NULL, 10);
+		name.erase (dot);
+	}
+
+	for (size_t i=0; i<name.size() && name[i] != '-'; i++)
+		name[i] = (char)toupper ((unsigned char)name[i]);
+}
+
+// Adds the ROMs of a job to the manifest, in romInfo table format.
+static void AddToManifest (std::string& manifest, const SplitJob& job, const std::vector<CrcItem>& items)
+{
+	char line[256];
+	snprintf (line, sizeof(line), "%s\t// %s\n", manifest.empty() ? "" : "\n", job.imageFile);
+	manifest += line;
+	for (size_t i=0; i<items.size(); i++)
+	{
+		std::string name;
+		uint32 ic;
+		GetRomName (items[i].fileName, name, ic);
+		snprintf (line, sizeof(line), "\t{ \"%s\", %u, 0x%08x },\n", name.c_str(), ic, items[i].crc);
+		manifest += line;
+	}
+}
+
+static bool ParseSize (const char* text, uint32& value)
+{
+	char* pEnd;
+	unsigned long parsed = strtoul (text, &pEnd, 0);
+	if (!*text || *pEnd || !parsed || parsed > 0x7fffffffUL)
+		return false;
+
+	value = (uint32)parsed;
+	return true;
+}
+
+static bool WriteFile (const char* fileName, const uint8* pData, uint32 nBytes)
+{
+	FILE* pFile = fopen (fileName, "wb");
+	if (!pFile)
+	{
+		printf ("Error creating output file '%s'.\n", fileName);
+		return false;
+	}
+
+	bool bWritten = fwrite (pData, 1, nBytes, pFile) == nBytes;
+	bWritten = fclose (pFile) == 0 && bWritten;
+	if (!bWritten)
+		printf ("Error writing to output file '%s'.\n", fileName);
+	return bWritten;
+}
+
+// Every ROM of the job is written, padded with zeros past the end of the image. With a manifest, the ROMs'
+// checksums are added to it.
+static bool Split (const SplitJob& job, std::string* pManifest)
+{
+	uint32 nImageBytes;
+	const uint8* pImage = PLATFORM_MapFile (job.imageFile, nImageBytes);
+	if (!pImage)
+	{
+		printf ("Input file '%s' not found.\n", job.imageFile);
+		return false;
+	}
+
+	const uint32 nRoms = (uint32)job.romNames.size();
+	const uint64 maxFileSize = (uint64)job.romSize * nRoms;
+	if (nImageBytes > maxFileSize)
+	{
+		printf ("Not enough output file names to accomodate input file size of %u.\n", nImageBytes);
+		PLATFORM_UnmapFile (pImage, nImageBytes);
+		return false;
+	}
+
+	// Each bank of 'interleave' ROMs takes the next romSize*interleave bytes of the image.
+	std::vector<uint8> roms ((size_t)maxFileSize, 0);
+	const uint32 bankBytes = job.romSize * job.interleave;
+	for (uint32 bank=0; bank*job.interleave<nRoms; bank++)
+	{
+		uint64 offset = (uint64)bank * bankBytes;
+		if (offset >= nImageBytes)
+			break;
+
+		std::vector<uint8*> lanes (job.interleave);
+		for (uint32 j=0; j<job.interleave; j++)
+			lanes[j] = &roms[(size_t)(bank*job.interleave + j) * job.romSize];
+
+		uint32 nBytes = nImageBytes - (uint32)offset < bankBytes ? nImageBytes - (uint32)offset : bankBytes;
+		Deinterleave (pImage + offset, nBytes, job.interleave, &lanes[0]);
+	}
+	PLATFORM_UnmapFile (pImage, nImageBytes);
+
+	for (uint32 i=0; i<nRoms; i++)
+	{
+		if (!WriteFile (job.romNames[i], &roms[(size_t)i * job.romSize], job.romSize))
+			return false;
+		printf ("Written '%s'.\n", job.romNames[i]);
+	}
+
+	if (pManifest)
+	{
+		std::vector<CrcItem> items (nRoms);
+		for (uint32 i=0; i<nRoms; i++)
 		{
-			if (sscanf (arg, "%I64u", &romSize) != 1 || romSize == 0)
-			{
-				printf ("Invalid ROM size: '%s'.\n", arg);
-				return 1;
-			}
+			items[i].fileName = job.romNames[i];
+			items[i].pData = &roms[(size_t)i * job.romSize];
+			items[i].nBytes = job.romSize;
+		}
+		CalcCRCs (items);
+		AddToManifest (*pManifest, job, items);
+	}
+
+	return true;
+}
+
+// The reverse of Split: re-interleaves the ROMs, which have to be romSize bytes each, into the image.
+static bool Merge (const SplitJob& job, std::string* pManifest)
+{
+	const uint32 nRoms = (uint32)job.romNames.size();
+	std::vector<CrcItem> items (nRoms);
+	bool bOK = true;
+	for (uint32 i=0; i<nRoms && bOK; i++)
+	{
+		items[i].fileName = job.romNames[i];
+		items[i].pData = PLATFORM_MapFile (job.romNames[i], items[i].nBytes);
+		if (!items[i].pData)
+		{
+			printf ("Input file '%s' not found.\n", job.romNames[i]);
+			bOK = false;
 		}
-		else if (!interleave)
+		else if (items[i].nBytes != job.romSize)
 		{
-			if (sscanf (arg, "%I64u", &interleave) != 1 || interleave == 0)
-			{
-				printf ("Invalid interleave value: '%s'.\n", arg);
-				return 1;
-			}
+			printf ("'%s' is %u bytes; expected %u.\n", job.romNames[i], items[i].nBytes, job.romSize);
+			bOK = false;
 		}
-		else // Output file names.
+	}
+
+	if (bOK)
+	{
+		std::vector<uint8> image ((size_t)job.romSize * nRoms);
+		const uint32 bankBytes = job.romSize * job.interleave;
+		for (uint32 bank=0; bank*job.interleave<nRoms; bank++)
 		{
-			romNames.Append(arg);
+			std::vector<uint8*> lanes (job.interleave);
+			for (uint32 j=0; j<job.interleave; j++)
+				lanes[j] = (uint8*)items[bank*job.interleave + j].pData;
+
+			Interleave (&lanes[0], bankBytes, job.interleave, &image[(size_t)bank * bankBytes]);
 		}
-		argIdx++;
+
+		bOK = WriteFile (job.imageFile, &image[0], (uint32)image.size());
+		if (bOK)
+			printf ("Written '%s'.\n", job.imageFile);
 	}
 
-	if (romNames.Empty())
+	if (bOK && pManifest)
 	{
-		printf ("No output file names specified.\n");
-		return 1;
+		CalcCRCs (items);
+		AddToManifest (*pManifest, job, items);
 	}
 
-	if ((romNames.Size() % interleave) != 0)
+	for (uint32 i=0; i<nRoms; i++)
+		if (items[i].pData)
+			PLATFORM_UnmapFile (items[i].pData, items[i].nBytes);
+	return bOK;
+}
+
+struct RomInfo
+{
+	std::string name;
+	uint32 ic;
+	uint32 crc;
+};
+
+// Reads the entries of a romInfo table; anything that doesn't look like one (comments, braces) is skipped.
+static bool LoadManifest (const char* fileName, std::vector<RomInfo>& romInfo)
+{
+	FILE* pFile = fopen (fileName, "r");
+	if (!pFile)
 	{
-		printf ("Mismatching number of output file names; expected a multiple of the interleave value.\n");
-		return 1;
+		printf ("Couldn't open manifest '%s'!\n", fileName);
+		return false;
 	}
 
-	HANDLE hFile = CreateFile (inputFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
-	if (hFile == INVALID_HANDLE_VALUE)
+	char line[512];
+	while (fgets (line, sizeof(line), pFile))
 	{
-		printf ("Input file '%s' not found.\n", inputFile);
-		return 1;
+		char name[256];
+		unsigned int ic, crc;
+		if (sscanf (line, " { \"%255[^\"]\" , %u , %x", name, &ic, &crc) != 3)
+			continue;
+
+		RomInfo info;
+		info.name = name;
+		info.ic = ic;
+		info.crc = crc;
+		romInfo.push_back (info);
 	}
+	fclose (pFile);
 
-	uint64 maxFileSize = romSize * romNames.Size();
-	LARGE_INTEGER fileSize;
-	if (!GetFileSizeEx (hFile, &fileSize))
+	if (romInfo.empty())
 	{
-		printf ("Can't get file size for input file '%s'.\n", inputFile);
-		return 1;
+		printf ("Manifest '%s' has no ROMs!\n", fileName);
+		return false;
 	}
 
-	if ((uint64)fileSize.QuadPart > maxFileSize)
+	return true;
+}
+
+// Checks the dumps against the manifest, like ValidateRom in the memtest sample checks the ROMs on the board:
+// a dump is good when its checksum belongs to the ROM for the IC its name says it came from (or, without an IC
+// number, the ROM of that name). Dumps that aren't in the manifest only have to match any of its ROMs.
+static bool Verify (const char* manifestFile, const std::vector<const char*>& dumps)
+{
+	std::vector<RomInfo> romInfo;
+	if (!LoadManifest (manifestFile, romInfo))
+		return false;
+
+	std::vector<CrcItem> items (dumps.size());
+	for (size_t i=0; i<dumps.size(); i++)
 	{
-		printf ("Not enough output file names to accomodate input file size of %I64u.\n", fileSize.QuadPart);
-		return 1;
+		items[i].fileName = dumps[i];
+		items[i].pData = NULL;
 	}
+	CalcCRCs (items);
 
-	uint8* data = new uint8[(size_t)(romSize * interleave)];
-	uint8* romData = new uint8[(size_t)romSize];
-	List<const char*>::ConstCursor c = romNames.First();
-	DWORD dataSize = 0;
-	for (;;)
+	uint32 nBad = 0;
+	for (size_t i=0; i<items.size(); i++)
 	{
-		if (!ReadFile (hFile, data, (DWORD)(romSize*interleave), &dataSize, NULL))
+		const CrcItem& item = items[i];
+		if (!item.bRead)
+		{
+			printf ("%s: couldn't read the file.\n", item.fileName);
+			nBad++;
+			continue;
+		}
+
+		std::string name;
+		uint32 ic;
+		GetRomName (item.fileName, name, ic);
+		const RomInfo* pExpected = NULL;
+		const RomInfo* pFound = NULL;
+		for (size_t r=0; r<romInfo.size(); r++)
+		{
+			bool bExpected = ic ? romInfo[r].ic == ic : stricmp (romInfo[r].name.c_str(), name.c_str()) == 0;
+			if (bExpected && !pExpected)
+				pExpected = &romInfo[r];
+			if (romInfo[r].crc == item.crc && (!pFound || bExpected))
+				pFound = &romInfo[r];
+		}
+
+		if (pFound && (!pExpected || pFound->crc == pExpected->crc))
+		{
+			printf ("%s: OK, %s (IC %u).\n", item.fileName, pFound->name.c_str(), pFound->ic);
+			continue;
+		}
+
+		nBad++;
+		if (pFound)
+			printf ("%s: CRC 0x%08x is %s (IC %u), not %s (IC %u).\n", item.fileName, item.crc, pFound->name.c_str(), pFound->ic, pExpected->name.c_str(), pExpected->ic);
+		else if (pExpected)
+			printf ("%s: CRC 0x%08x doesn't match; expected 0x%08x.\n", item.fileName, item.crc, pExpected->crc);
+		else
+			printf ("%s: unknown CRC 0x%08x.\n", item.fileName, item.crc);
+	}
+
+	printf ("%u of %u dumps verified.\n", (uint32)(items.size() - nBad), (uint32)items.size());
+	return nBad == 0;
+}
+
+int main (int argc, char **argv)
+{
+	if (argc < 4)
+	{
+		printf ("SplitBin - Splits a binary image in to separate (interleaved) (EP)ROM images.\n");
+		printf ("Usage: splitbin [-merge] [-manifest <file>] <image> <rom size> <interleave> <name1> [<name2> ...] [-- <image> ...]\n");
+		printf ("       splitbin -verify <manifest> <dump1> [<dump2> ...]\n");
+		printf ("Example: splitbin maincpu.bin 65536 2 epr-10380b.133 epr-10382b.118 -- subcpu.bin 65536 2 epr-10327a.76 epr-10329a.58\n");
+		printf ("Note: The file names should be supplied in interleaved order. Separate images with --, to split\n");
+		printf ("      the main and sub CPU images in one go.\n");
+		printf ("Options:\n");
+		printf ("  -merge            Re-interleave the ROMs in to the image instead, e.g. to rebuild it from chip dumps.\n");
+		printf ("  -manifest <file>  Write the CRC32 of each ROM to a romInfo table, as in samples/memtest/test.c.\n");
+		printf ("  -verify <file>    Check chip dumps against such a table.\n");
+		return 0;
+	}
+
+	bool bMerge = false;
+	const char* manifestFile = NULL;
+	const char* verifyFile = NULL;
+	int argIdx = 1;
+	for (; argIdx<argc && argv[argIdx][0] == '-' && strcmp (argv[argIdx], "--") != 0; argIdx++)
+	{
+		const char* arg = argv[argIdx];
+		if (stricmp (arg, "-merge") == 0)
+		{
+			bMerge = true;
+		}
+		else if (stricmp (arg, "-manifest") == 0 && argIdx + 1 < argc)
 		{
-			printf ("Error reading input file '%s'.\n", inputFile);
-			CloseHandle (hFile);
+			manifestFile = argv[++argIdx];
+		}
+		else if (stricmp (arg, "-verify") == 0 && argIdx + 1 < argc)
+		{
+			verifyFile = argv[++argIdx];
+		}
+		else
+		{
+			printf ("Invalid option: '%s'.\n", arg);
 			return 1;
 		}
+	}
 
-		for (uint64 j=0; j<interleave; j++)
+	if (verifyFile)
+	{
+		if (bMerge || manifestFile)
 		{
-			uint64 romUsage = 0;
-			for (uint64 i=j; i<dataSize; i+=interleave)
-				romData[romUsage++] = data[i];
-			for (uint64 i=romUsage; i<romSize; i++)
-				romData[i] = 0; // Zero out the rest.
+			printf ("-verify can't be combined with -merge or -manifest.\n");
+			return 1;
+		}
 
-			HANDLE hOutFile = CreateFile (c.GetValue(), GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, NULL);
-			if (hOutFile == INVALID_HANDLE_VALUE)
+		std::vector<const char*> dumps (argv + argIdx, argv + argc);
+		if (dumps.empty())
+		{
+			printf ("No dumps to verify.\n");
+			return 1;
+		}
+		return Verify (verifyFile, dumps) ? 0 : 1;
+	}
+
+	std::vector<SplitJob> jobs (1);
+	for (; argIdx<argc; argIdx++)
+	{
+		const char* arg = argv[argIdx];
+		SplitJob& job = jobs.back();
+		if (strcmp (arg, "--") == 0)
+		{
+			jobs.push_back (SplitJob());
+			continue;
+		}
+
+		if (arg[0] == '-')
+		{
+			printf ("Invalid option: '%s'; options go before the first image.\n", arg);
+			return 1;
+		}
+		else if (!job.imageFile)
+		{
+			job.imageFile = arg;
+		}
+		else if (!job.romSize)
+		{
+			if (!ParseSize (arg, job.romSize))
 			{
-				printf ("Error creating output file '%s' (%u).", c.GetValue(), GetLastError());
-				CloseHandle (hFile);
+				printf ("Invalid ROM size: '%s'.\n", arg);
 				return 1;
 			}
-
-			DWORD bytesWritten;
-			if (!WriteFile (hOutFile, romData, (DWORD)romSize, &bytesWritten, NULL) || romSize != bytesWritten)
+		}
+		else if (!job.interleave)
+		{
+			if (!ParseSize (arg, job.interleave))
 			{
-				printf ("Error writing to output file '%s' (%u).", c.GetValue(), GetLastError());
-				CloseHandle (hOutFile);
-				CloseHandle (hFile);
+				printf ("Invalid interleave value: '%s'.\n", arg);
 				return 1;
 			}
+		}
+		else // ROM file names.
+		{
+			job.romNames.push_back (arg);
+		}
+	}
 
-			CloseHandle (hOutFile);
-			printf ("Written '%s'.\n", c.GetValue());
-			c++;
+	for (size_t i=0; i<jobs.size(); i++)
+	{
+		const SplitJob& job = jobs[i];
+		if (!job.interleave)
+		{
+			printf ("Expected an image, a ROM size and an interleave value before the file names.\n");
+			return 1;
 		}
 
-		if (dataSize < romSize*interleave)
-			break; // EOF, done.
+		if (job.romNames.empty())
+		{
+			printf ("No ROM file names specified for %s.\n", job.imageFile);
+			return 1;
+		}
+
+		if ((job.romNames.size() % job.interleave) != 0)
+		{
+			printf ("Mismatching number of ROM file names; expected a multiple of the interleave value.\n");
+			return 1;
+		}
 	}
 
-	delete[] data;
-	delete[] romData;
+	std::string manifest;
+	for (size_t i=0; i<jobs.size(); i++)
+		if (!(bMerge ? Merge (jobs[i], manifestFile ? &manifest : NULL) : Split (jobs[i], manifestFile ? &manifest : NULL)))
+			return 1;
+
+	if (manifestFile)
+	{
+		if (!WriteFile (manifestFile, (const uint8*)manifest.c_str(), (uint32)manifest.size()))
+			return 1;
+		printf ("Written '%s'.\n", manifestFile);
+	}
 
-	CloseHandle (hFile);
 	return 0;
 }